@@ -12,13 +12,21 @@
       ],
       'sources': [
         'src/zoom.cc',
+        'src/cache.cc',
+        'src/driver.cc',
+        'src/worker.cc',
         'src/query.cc',
+        'src/transform.cc',
+        'src/prepared.cc',
         'src/record.cc',
+        'src/columns.cc',
         'src/errors.cc',
         'src/records.cc',
         'src/options.cc',
         'src/resultset.cc',
-        'src/connection.cc'
+        'src/connection.cc',
+        'src/federation.cc',
+        'src/pool.cc'
       ]
     }
   ]
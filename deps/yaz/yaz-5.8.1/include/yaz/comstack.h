@@ -126,6 +126,30 @@ YAZ_EXPORT COMSTACK cs_create_host_proxy(const char *vhost,
 YAZ_EXPORT void cs_get_host_args(const char *type_and_host, const char **args);
 YAZ_EXPORT int cs_complete_auto_head(const char *buf, int len);
 YAZ_EXPORT int cs_complete_auto(const char *buf, int len);
+
+/** \brief where cs_complete_auto_r left off in a buffer being filled */
+struct cs_complete_state {
+    int kind;        /* 0: not known yet, HTTP or BER */
+    int pos;         /* BER: next TLV; HTTP: content or unfinished chunk */
+    int depth;       /* BER: open TLVs of indefinite length */
+    int content_len; /* HTTP */
+    int chunked;     /* HTTP */
+};
+
+/** \brief prepares state for a new PDU */
+YAZ_EXPORT void cs_complete_reset(struct cs_complete_state *st);
+
+/** \brief cs_complete_auto that resumes from the previous call
+    \param st state; reset before the first call for each PDU
+    \param buf buffer; same data as previous call followed by more data
+    \param len length of buffer
+    \returns as cs_complete_auto
+
+    Costs time proportional to the new data only, except for HTTP
+    headers which are scanned again until complete.
+*/
+YAZ_EXPORT int cs_complete_auto_r(struct cs_complete_state *st,
+                                  const char *buf, int len);
 YAZ_EXPORT void *cs_get_ssl(COMSTACK cs)
 #ifdef __GNUC__
     __attribute__ ((deprecated))
@@ -138,6 +162,7 @@ YAZ_EXPORT int cs_set_ssl_ctx(COMSTACK cs, void *ctx)
     ;
 YAZ_EXPORT int cs_set_ssl_certificate_file(COMSTACK cs, const char *fname);
 YAZ_EXPORT int cs_get_peer_certificate_x509(COMSTACK cs, char **buf, int *len);
+YAZ_EXPORT int cs_get_partial(COMSTACK cs, const char **buf);
 YAZ_EXPORT void cs_set_max_recv_bytes(COMSTACK cs, int max_recv_bytes);
 YAZ_EXPORT void cs_print_session_info(COMSTACK cs);
 
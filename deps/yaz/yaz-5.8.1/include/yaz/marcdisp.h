@@ -78,6 +78,8 @@ YAZ_EXPORT void yaz_marc_xml(yaz_marc_t mt, int xmlmode);
 #define YAZ_MARC_TURBOMARC 7
 /** \brief Output format: JSON */
 #define YAZ_MARC_JSON      8
+/** \brief Output format: JSON on a single line, without whitespace */
+#define YAZ_MARC_JSON_COMPACT 9
 
 /** \brief set iconv handle for character set conversion */
 YAZ_EXPORT void yaz_marc_iconv(yaz_marc_t mt, yaz_iconv_t cd);
@@ -161,6 +163,55 @@ int atoi_n_check(const char *buf, int size, int *val);
 YAZ_EXPORT int yaz_marc_read_iso2709(yaz_marc_t mt,
                                      const char *buf, int bsize);
 
+/** \brief flat index of ISO2709 records over the bytes of their buffer
+
+    Offsets are relative to the buffer records were indexed from. Record
+    r has fields record_field[r] .. record_field[r + 1] - 1 and field f has
+    subfields field_subfield[f] .. field_subfield[f + 1] - 1. Control
+    fields have no subfields. A subfield offset is that of its code, which
+    the data follows; its length covers both.
+*/
+struct yaz_marc_index {
+    int num_records;
+    int num_fields;
+    int num_subfields;
+    int *record_offset;   /**< leader offset; -1 if the record is bad */
+    int *record_field;    /**< first field; num_records + 1 entries */
+    short *field_tag;     /**< tag as number; -1 if not all digits */
+    int *field_offset;    /**< field data, starting with indicators */
+    int *field_length;    /**< field data length, excluding separator */
+    int *field_subfield;  /**< first subfield; num_fields + 1 entries */
+    int *subfield_offset;
+    int *subfield_length;
+    int max_records;
+    int max_fields;
+    int max_subfields;
+};
+
+typedef struct yaz_marc_index *yaz_marc_index_t;
+
+/** \brief creates empty ISO2709 index */
+YAZ_EXPORT yaz_marc_index_t yaz_marc_index_create(void);
+
+/** \brief destroys ISO2709 index */
+YAZ_EXPORT void yaz_marc_index_destroy(yaz_marc_index_t idx);
+
+/** \brief removes all records from ISO2709 index, keeping its memory */
+YAZ_EXPORT void yaz_marc_index_reset(yaz_marc_index_t idx);
+
+/** \brief adds ISO2709 record to index without building MARC nodes
+    \param idx index
+    \param buf buffer that offsets are relative to
+    \param offset offset of record in buffer
+    \param bsize bytes of buffer from offset (-1 for unlimited size)
+    \retval -1 ERROR (the record is still added, with offset -1)
+    \retval >0 OK (length)
+
+    Fields and subfields are the ones yaz_marc_read_iso2709 would read.
+*/
+YAZ_EXPORT int yaz_marc_index_iso2709(yaz_marc_index_t idx, const char *buf,
+                                      int offset, int bsize);
+
 /** \brief read MARC lineformat from stream
     \param mt handle
     \param getbyte get one byte handler
@@ -271,6 +322,46 @@ int yaz_marc_write_xml(yaz_marc_t mt, xmlNode **root_ptr,
 YAZ_EXPORT
 int yaz_marc_write_json(yaz_marc_t mt, WRBUF w);
 
+/** \brief writes MARC record in compact JSON represenation
+    \param mt handle
+    \param w WRBUF for output
+    \retval 0 Creation successful
+    \retval -1 ERROR
+
+    Same structure as yaz_marc_write_json (MARC-in-JSON) on a single line
+    without any whitespace between tokens.
+*/
+YAZ_EXPORT
+int yaz_marc_write_json_compact(yaz_marc_t mt, WRBUF w);
+
+/** \brief callbacks for yaz_marc_visit
+
+    Strings are converted with the character set of the handle (except
+    leader, tags and indicators) and are only valid during the call.
+    A NULL callback is skipped.
+*/
+struct yaz_marc_visitor {
+    void (*leader)(void *data, const char *leader);
+    void (*controlfield)(void *data, const char *tag,
+                         const char *value, size_t value_len);
+    void (*datafield)(void *data, const char *tag, const char *indicator);
+    void (*subfield)(void *data, const char *code, size_t code_len,
+                     const char *value, size_t value_len);
+};
+
+/** \brief walks MARC record nodes without producing any output
+    \param mt handle
+    \param v callbacks
+    \param data user data passed to callbacks
+    \retval 0 OK
+    \retval -1 ERROR (no leader or invalid identifier length)
+
+    Visits the same fields, in the same order, as yaz_marc_write_json.
+*/
+YAZ_EXPORT
+int yaz_marc_visit(yaz_marc_t mt, const struct yaz_marc_visitor *v,
+                   void *data);
+
 /** \brief sets leader spec (for modifying bytes in 24 byte leader)
     \param mt handle
     \param leader_spec
@@ -51,6 +51,7 @@ YAZ_BEGIN_CDECL
 
     txml; charset=marc-8
     xml; charset=utf-8
+    json; charset=marc-8; format=compact
     txml; charset=marc-8; base64=/rec/my/text()
 */
 YAZ_EXPORT
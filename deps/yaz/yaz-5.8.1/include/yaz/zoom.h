@@ -48,6 +48,7 @@ ZOOM_BEGIN_CDECL
 /* the types we use */
 
 typedef struct ZOOM_options_p *ZOOM_options;
+typedef const struct ZOOM_options_key_p *ZOOM_options_key;
 typedef struct ZOOM_query_p *ZOOM_query;
 typedef struct ZOOM_connection_p *ZOOM_connection;
 typedef struct ZOOM_resultset_p *ZOOM_resultset;
@@ -55,6 +56,8 @@ typedef struct ZOOM_record_p *ZOOM_record;
 typedef struct ZOOM_facet_field_p *ZOOM_facet_field;
 typedef struct ZOOM_scanset_p *ZOOM_scanset;
 typedef struct ZOOM_package_p *ZOOM_package;
+typedef struct ZOOM_cql_transform_p *ZOOM_cql_transform;
+typedef struct ZOOM_prepared_p *ZOOM_prepared;
 
 typedef const char *(*ZOOM_options_callback)(void *handle, const char *name);
 
@@ -97,6 +100,11 @@ ZOOM_API(void)
 ZOOM_connection_option_setl(ZOOM_connection c, const char *key,
                             const char *val, int len);
 
+/* replace the options a connection inherits from, e.g. when an
+   established connection is handed on to another user */
+ZOOM_API(void)
+ZOOM_connection_set_options_parent(ZOOM_connection c, ZOOM_options parent);
+
 /* return error code (0 == success, failure otherwise). cp
    holds error string on failure, addinfo holds addititional info (if any)
 */
@@ -183,6 +191,14 @@ ZOOM_resultset_destroy(ZOOM_resultset r);
 ZOOM_API(void)
 ZOOM_resultset_release(ZOOM_resultset r);
 
+/** \brief determines if result set was released from its connection
+    \param r result set
+    \retval 1 released, or its connection destroyed
+    \retval 0 still retrieves from its connection
+*/
+ZOOM_API(int)
+ZOOM_resultset_is_released(ZOOM_resultset r);
+
 /* result set option */
 ZOOM_API(const char *)
 ZOOM_resultset_option_get(ZOOM_resultset r, const char *key);
@@ -206,10 +222,37 @@ ZOOM_resultset_record(ZOOM_resultset s, size_t pos);
 ZOOM_API(ZOOM_record)
 ZOOM_resultset_record_immediate(ZOOM_resultset s, size_t pos);
 
+/* like ZOOM_resultset_record_immediate - but returns a reference which
+   shares the cached record instead of a copy. The result set is kept
+   alive until the reference is freed with ZOOM_record_destroy */
+ZOOM_API(ZOOM_record)
+ZOOM_resultset_record_ref(ZOOM_resultset s, size_t pos);
+
+/* take another reference to result set; released by ZOOM_resultset_destroy */
+ZOOM_API(void)
+ZOOM_resultset_addref(ZOOM_resultset r);
+
 /* reset record cache for result set */
 ZOOM_API(void)
 ZOOM_resultset_cache_reset(ZOOM_resultset r);
 
+/* configure in-process record cache shared by all connections.
+   Least recently used records are evicted beyond max_bytes; 0 disables
+   the cache (default) */
+ZOOM_API(void)
+ZOOM_cache_configure(size_t max_bytes);
+
+/* keep hit counts of searches in the in-process cache for ttl seconds
+   (default 600), so repeated searches need no search request. Cached
+   records expire along with them. 0 caches records only, without expiry */
+ZOOM_API(void)
+ZOOM_cache_configure_search(int ttl);
+
+/* get in-process cache statistics. Any pointer may be NULL */
+ZOOM_API(void)
+ZOOM_cache_stat(size_t *entries, size_t *bytes,
+                size_t *hits, size_t *misses);
+
 
 /* retrieve facet field */
 ZOOM_API(ZOOM_facet_field)
@@ -287,6 +330,18 @@ ZOOM_query_cql(ZOOM_query s, const char *str);
 /* CQL translated client-side into RPN: `conn' is optional for diagnostics */
 ZOOM_API(int)
 ZOOM_query_cql2rpn(ZOOM_query s, const char *str, ZOOM_connection conn);
+/* CQL translated client-side with a transform from ZOOM_cql_transform_open */
+ZOOM_API(int)
+ZOOM_query_cql2rpn_transform(ZOOM_query s, const char *str,
+                             ZOOM_cql_transform t, ZOOM_connection conn);
+/* get compiled CQL transform for file. Transforms are cached process-wide
+   by file name and modification time and may be shared between threads.
+   Returns NULL if the file cannot be read or parsed (errno set) */
+ZOOM_API(ZOOM_cql_transform)
+ZOOM_cql_transform_open(const char *fname);
+/* release transform returned by ZOOM_cql_transform_open */
+ZOOM_API(void)
+ZOOM_cql_transform_destroy(ZOOM_cql_transform t);
 /* CCL translated client-side into RPN: `conn' is optional for diagnostics */
 ZOOM_API(int)
 ZOOM_query_ccl2rpn(ZOOM_query s, const char *query_str,
@@ -295,6 +350,28 @@ ZOOM_query_ccl2rpn(ZOOM_query s, const char *query_str,
 /* PQF */
 ZOOM_API(int)
 ZOOM_query_prefix(ZOOM_query s, const char *str);
+/* prepare query of type "prefix" or "cql" with $name placeholders, each
+   standing for a whole term. Returns NULL on syntax error */
+ZOOM_API(ZOOM_prepared)
+ZOOM_prepared_create(const char *type, const char *str);
+/* number of distinct placeholders of prepared query */
+ZOOM_API(int)
+ZOOM_prepared_num_params(ZOOM_prepared p);
+/* name, without the $, of placeholder i; NULL if out of range */
+ZOOM_API(const char *)
+ZOOM_prepared_param_name(ZOOM_prepared p, int i);
+/* create query from prepared one with values for the named placeholders.
+   Returns NULL if a placeholder has no value */
+ZOOM_API(ZOOM_query)
+ZOOM_prepared_bind(ZOOM_prepared p, const char **names,
+                   const char **values, int num);
+/* destroy prepared query. Queries bound from it stay valid */
+ZOOM_API(void)
+ZOOM_prepared_destroy(ZOOM_prepared p);
+/* get string identifying query and sort criteria, such as for caching.
+   Valid until the query is changed or destroyed */
+ZOOM_API(const char *)
+ZOOM_query_get_key(ZOOM_query s);
 /* specify sort criteria for search */
 ZOOM_API(int)
 ZOOM_query_sortby(ZOOM_query s, const char *criteria);
@@ -383,6 +460,10 @@ ZOOM_API(ZOOM_options)
 ZOOM_options_create_with_parent2(ZOOM_options parent1,
                                  ZOOM_options parent2);
 
+/* replace first parent of options */
+ZOOM_API(void)
+ZOOM_options_set_parent(ZOOM_options opt, ZOOM_options parent);
+
 ZOOM_API(ZOOM_options)
 ZOOM_options_dup(ZOOM_options src);
 
@@ -411,6 +492,20 @@ ZOOM_options_get_int(ZOOM_options opt, const char *name, int defa);
 ZOOM_API(void)
 ZOOM_options_set_int(ZOOM_options opt, const char *name, int value);
 
+/* option names are interned. A key looked up once may be used for any
+   number of gets and sets, saving the name lookup of each. Keys are
+   valid until exit and never freed. lenp of ZOOM_options_getk may be
+   NULL */
+ZOOM_API(ZOOM_options_key)
+ZOOM_options_key_get(const char *name);
+
+ZOOM_API(const char *)
+ZOOM_options_getk(ZOOM_options opt, ZOOM_options_key key, int *lenp);
+
+ZOOM_API(void)
+ZOOM_options_setk(ZOOM_options opt, ZOOM_options_key key, const char *value,
+                  int len);
+
 /** \brief select/poll socket mask: read */
 #define ZOOM_SELECT_READ 1
 /** \brief select/poll socket mask: write */
@@ -441,6 +536,15 @@ ZOOM_event(int no, ZOOM_connection *cs);
 ZOOM_API(int)
 ZOOM_connection_is_idle(ZOOM_connection c);
 
+/** \brief releases all result sets of connection
+    \param c connection
+
+    Result sets the application still holds can no longer retrieve over
+    c, so the session may be handed on to another user.
+*/
+ZOOM_API(void)
+ZOOM_connection_release_resultsets(ZOOM_connection c);
+
 
 /** \brief process one event for one of connections given
     \param no number of connections (size of cs)
@@ -53,7 +53,7 @@ static int get_form(const char *charset)
 
 static char *set_form(Odr_oid *encoding)
 {
-    static char *charset = 0;
+    char *charset = 0;
     if ( oid_oidlen(encoding) != 6)
         return 0;
     if (encoding[5] == 2)
@@ -12,7 +12,12 @@
 
 #include <string.h>
 #include <errno.h>
+#if YAZ_POSIX_THREADS
+#include <pthread.h>
+#endif
 
+#include <yaz/errno.h>
+#include <yaz/xmalloc.h>
 #include <yaz/yaz-iconv.h>
 #include <yaz/log.h>
 #include <yaz/comstack.h>
@@ -33,16 +38,59 @@ static const char *cs_errlist[] =
     "Too large incoming buffer"
 };
 
+#define CS_ERRMSG_MAX 250
+
+/* cs_errmsg formats into a buffer of its own for each thread */
+#if YAZ_POSIX_THREADS
+static pthread_key_t errmsg_key;
+static pthread_once_t errmsg_once = PTHREAD_ONCE_INIT;
+
+static void errmsg_destroy(void *p)
+{
+    xfree(p);
+}
+
+static void errmsg_init(void)
+{
+    pthread_key_create(&errmsg_key, errmsg_destroy);
+}
+
+static char *errmsg_buf(void)
+{
+    char *buf;
+
+    pthread_once(&errmsg_once, errmsg_init);
+    buf = (char *) pthread_getspecific(errmsg_key);
+    if (!buf)
+    {
+        buf = (char *) xmalloc(CS_ERRMSG_MAX);
+        pthread_setspecific(errmsg_key, buf);
+    }
+    return buf;
+}
+#else
+static char *errmsg_buf(void)
+{
+    static char buf[CS_ERRMSG_MAX];
+    return buf;
+}
+#endif
+
 const char *cs_errmsg(int n)
 {
-    static char buf[250];
+    char *buf;
 
     if (n < CSNONE || n > CSLASTERROR) {
+        buf = errmsg_buf();
         sprintf(buf, "unknown comstack error %d", n);
         return buf;
     }
     if (n == CSYSERR) {
-        sprintf(buf, "%s: %s", cs_errlist[n], strerror(errno));
+        char msg[128];
+
+        yaz_strerror(msg, sizeof(msg)); /* before errno is clobbered */
+        buf = errmsg_buf();
+        sprintf(buf, "%s: %s", cs_errlist[n], msg);
         return buf;
     }
     return cs_errlist[n];
@@ -247,12 +295,16 @@ static int skip_crlf(const char *buf, int len, int *i)
 
 #define CHUNK_DEBUG 0
 
-static int cs_read_chunk(const char *buf, int i, int len)
+/* reads chunked body from *ip. When incomplete, *ip is left at the
+   chunk that was not complete, so a later call may resume from there */
+static int cs_read_chunk(const char *buf, int *ip, int len)
 {
+    int i = *ip;
     /* inside chunked body .. */
     while (1)
     {
         int chunk_len = 0;
+        *ip = i;
 #if CHUNK_DEBUG
         if (i < len-2)
         {
@@ -323,11 +375,15 @@ static int cs_read_chunk(const char *buf, int i, int len)
     return 0;
 }
 
-static int cs_complete_http(const char *buf, int len, int head_only)
+/* scans HTTP header. Returns offset of content and sets content_len
+   (-1: until close) and chunked, or 0 if header is incomplete */
+static int cs_http_head(const char *buf, int len, int head_only,
+                        int *content_len, int *chunked)
 {
-    /* deal with HTTP request/response */
-    int i, content_len = 0, chunked = 0;
+    int i;
 
+    *content_len = 0;
+    *chunked = 0;
     /* need at least one line followed by \n or \r .. */
     for (i = 0; ; i++)
         if (i == len)
@@ -350,7 +406,7 @@ static int cs_complete_http(const char *buf, int len, int head_only)
                 else if (!memcmp(buf + j, "304", 3))
                     ;
                 else
-                    content_len = -1;
+                    *content_len = -1;
                 break;
             }
     }
@@ -363,26 +419,15 @@ static int cs_complete_http(const char *buf, int len, int head_only)
     {
         if (i > 8192)
         {
-            return i;  /* do not allow more than 8K HTTP header */
+            /* do not allow more than 8K HTTP header */
+            *content_len = 0;
+            *chunked = 0;
+            return i;
         }
         if (skip_crlf(buf, len, &i))
         {
             if (skip_crlf(buf, len, &i))
-            {
-                /* inside content */
-                if (chunked)
-                    return cs_read_chunk(buf, i, len);
-                else
-                {   /* not chunked ; inside body */
-                    if (content_len == -1)
-                        return 0;   /* no content length */
-                    else if (len >= i + content_len)
-                    {
-                        return i + content_len;
-                    }
-                }
-                break;
-            }
+                return i; /* inside content */
             else if (i < len - 20 &&
                      !yaz_strncasecmp((const char *) buf+i,
                                       "Transfer-Encoding:", 18))
@@ -392,7 +437,7 @@ static int cs_complete_http(const char *buf, int len, int head_only)
                     i++;
                 if (i < len - 8)
                     if (!yaz_strncasecmp((const char *) buf+i, "chunked", 7))
-                        chunked = 1;
+                        *chunked = 1;
             }
             else if (i < len - 17 &&
                      !yaz_strncasecmp((const char *)buf+i,
@@ -401,11 +446,11 @@ static int cs_complete_http(const char *buf, int len, int head_only)
                 i+= 15;
                 while (buf[i] == ' ')
                     i++;
-                content_len = 0;
+                *content_len = 0;
                 while (i <= len-4 && yaz_isdigit(buf[i]))
-                    content_len = content_len*10 + (buf[i++] - '0');
-                if (content_len < 0) /* prevent negative offsets */
-                    content_len = 0;
+                    *content_len = *content_len*10 + (buf[i++] - '0');
+                if (*content_len < 0) /* prevent negative offsets */
+                    *content_len = 0;
             }
             else
                 i++;
@@ -416,11 +461,40 @@ static int cs_complete_http(const char *buf, int len, int head_only)
     return 0;
 }
 
+static int cs_http_content(const char *buf, int len, int *pos,
+                           int content_len, int chunked)
+{
+    if (chunked)
+        return cs_read_chunk(buf, pos, len);
+    /* not chunked ; inside body */
+    if (content_len == -1)
+        return 0;   /* no content length */
+    if (len >= *pos + content_len)
+        return *pos + content_len;
+    return 0;
+}
+
+static int cs_complete_http(const char *buf, int len, int head_only)
+{
+    /* deal with HTTP request/response */
+    int content_len, chunked;
+    int i = cs_http_head(buf, len, head_only, &content_len, &chunked);
+
+    if (!i)
+        return 0;
+    return cs_http_content(buf, len, &i, content_len, chunked);
+}
+
+static int cs_is_http(const char *buf, int len)
+{
+    return len > 5 && buf[0] >= 0x20 && buf[0] < 0x7f
+        && buf[1] >= 0x20 && buf[1] < 0x7f
+        && buf[2] >= 0x20 && buf[2] < 0x7f;
+}
+
 static int cs_complete_auto_x(const char *buf, int len, int head_only)
 {
-    if (len > 5 && buf[0] >= 0x20 && buf[0] < 0x7f
-                && buf[1] >= 0x20 && buf[1] < 0x7f
-                && buf[2] >= 0x20 && buf[2] < 0x7f)
+    if (cs_is_http(buf, len))
     {
         int r = cs_complete_http(buf, len, head_only);
         return r;
@@ -439,6 +513,89 @@ int cs_complete_auto_head(const char *buf, int len)
     return cs_complete_auto_x(buf, len, 1);
 }
 
+#define CS_COMPLETE_HTTP 1
+#define CS_COMPLETE_BER 2
+
+void cs_complete_reset(struct cs_complete_state *st)
+{
+    st->kind = 0;
+    st->pos = 0;
+    st->depth = 0;
+    st->content_len = 0;
+    st->chunked = 0;
+}
+
+/* same as completeBER, walking the TLVs of indefinite length iteratively
+   from where the previous call stopped */
+static int cs_complete_ber_r(struct cs_complete_state *st,
+                             const char *buf, int len)
+{
+    while (1)
+    {
+        int res, ll, zclass, tag, cons;
+        int pos = st->pos;
+
+        if (st->depth > 1000)
+            return len;  /* error */
+        if (len - pos < 2)
+            return 0;
+        if (!buf[pos] && !buf[pos + 1])
+        {
+            if (!st->depth)
+                return len;  /* error */
+            /* end of contents of innermost indefinite TLV */
+            st->pos = pos + 2;
+            if (--st->depth == 0)
+                return st->pos;
+            continue;
+        }
+        if ((res = ber_dectag(buf + pos, &zclass, &tag, &cons,
+                              len - pos)) <= 0)
+            return 0;
+        pos += res;
+        res = ber_declen(buf + pos, &ll, len - pos);
+        if (res == -2)
+            return len;  /* error */
+        if (res == -1)
+            return 0;    /* incomplete length */
+        pos += res;
+        if (ll >= 0)
+        {   /* definite length */
+            if (len - pos < ll)
+                return 0;
+            st->pos = pos + ll;
+            if (!st->depth)
+                return st->pos;
+        }
+        else if (!cons)
+            return len;  /* indefinite primitive: error */
+        else
+        {   /* descend into children */
+            st->pos = pos;
+            st->depth++;
+        }
+    }
+}
+
+int cs_complete_auto_r(struct cs_complete_state *st, const char *buf, int len)
+{
+    if (!st->kind)
+    {
+        if (len <= 5)
+            return cs_complete_auto(buf, len);
+        st->kind = cs_is_http(buf, len) ? CS_COMPLETE_HTTP : CS_COMPLETE_BER;
+    }
+    if (st->kind == CS_COMPLETE_BER)
+        return cs_complete_ber_r(st, buf, len);
+    if (!st->pos)
+    {
+        st->pos = cs_http_head(buf, len, 0, &st->content_len, &st->chunked);
+        if (!st->pos)
+            return 0;
+    }
+    return cs_http_content(buf, len, &st->pos, st->content_len, st->chunked);
+}
+
 void cs_set_max_recv_bytes(COMSTACK cs, int max_recv_bytes)
 {
     cs->max_recv_bytes = max_recv_bytes;
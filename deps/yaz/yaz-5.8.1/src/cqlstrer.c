@@ -10,7 +10,51 @@
 #include <config.h>
 #endif
 
+#include <stdio.h>
+#if YAZ_POSIX_THREADS
+#include <pthread.h>
+#endif
+
 #include <yaz/cql.h>
+#include <yaz/xmalloc.h>
+
+#define CQL_ERRMSG_MAX 80
+
+/* unknown codes are formatted into a buffer of its own for each thread */
+#if YAZ_POSIX_THREADS
+static pthread_key_t errmsg_key;
+static pthread_once_t errmsg_once = PTHREAD_ONCE_INIT;
+
+static void errmsg_destroy(void *p)
+{
+    xfree(p);
+}
+
+static void errmsg_init(void)
+{
+    pthread_key_create(&errmsg_key, errmsg_destroy);
+}
+
+static char *errmsg_buf(void)
+{
+    char *buf;
+
+    pthread_once(&errmsg_once, errmsg_init);
+    buf = (char *) pthread_getspecific(errmsg_key);
+    if (!buf)
+    {
+        buf = (char *) xmalloc(CQL_ERRMSG_MAX);
+        pthread_setspecific(errmsg_key, buf);
+    }
+    return buf;
+}
+#else
+static char *errmsg_buf(void)
+{
+    static char buf[CQL_ERRMSG_MAX];
+    return buf;
+}
+#endif
 
 /*
  * The error-messages associated with these codes are taken from
@@ -18,7 +62,7 @@
  *      http://www.loc.gov/standards/sru/diagnostics-list.html
  */
 const char *cql_strerror(int code) {
-    static char buf[80];
+    char *buf;
     switch (code) {
     case 10: return "Illegal query";
     case 11: return "Unsupported query type (XCQL vs CQL)";
@@ -59,6 +103,7 @@ const char *cql_strerror(int code) {
     default: break;
     }
 
+    buf = errmsg_buf();
     sprintf(buf, "Unknown CQL error #%d", code);
     return buf;
 }
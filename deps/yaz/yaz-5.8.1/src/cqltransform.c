@@ -38,10 +38,29 @@ struct cql_prop_entry {
     char *value;
     Z_AttributeList attr_list;
     struct cql_prop_entry *next;
+    struct cql_prop_entry *hash_next;  /* same bucket in ct->hash */
+    struct cql_prop_entry *cat_next;   /* same category, in file order */
+    struct cql_prop_entry *set_next;   /* next set or set.prefix entry */
+};
+
+/* entries sharing the pattern prefix up to the first dot, e.g. "index." */
+struct cql_prop_cat {
+    char *name;
+    size_t len;
+    struct cql_prop_entry *entry;
+    struct cql_prop_entry **last;
+    struct cql_prop_cat *next;
 };
 
 struct cql_transform_t_ {
     struct cql_prop_entry *entry;
+    struct cql_prop_entry **last;
+    struct cql_prop_entry **hash;      /* first entry for each pattern */
+    size_t hash_size;
+    size_t num_entries;
+    struct cql_prop_cat *cat;
+    struct cql_prop_entry *set_entry;
+    struct cql_prop_entry **set_last;
     yaz_tok_cfg_t tok_cfg;
     int error;
     WRBUF addinfo;
@@ -56,10 +75,111 @@ cql_transform_t cql_transform_create(void)
     ct->error = 0;
     ct->addinfo = wrbuf_alloc();
     ct->entry = 0;
+    ct->last = &ct->entry;
+    ct->hash = 0;
+    ct->hash_size = 0;
+    ct->num_entries = 0;
+    ct->cat = 0;
+    ct->set_entry = 0;
+    ct->set_last = &ct->set_entry;
     ct->nmem = nmem_create();
     return ct;
 }
 
+/* case-insensitive like cql_strcmp */
+static unsigned prop_hash(const char *s)
+{
+    unsigned h = 2166136261U; /* FNV-1a */
+
+    for (; *s; s++)
+    {
+        int c = *s;
+        if (c >= 'A' && c <= 'Z')
+            c = c + ('a' - 'A');
+        h ^= (unsigned char) c;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static void prop_hash_insert(cql_transform_t ct, struct cql_prop_entry *e)
+{
+    struct cql_prop_entry **ep = &ct->hash[prop_hash(e->pattern)
+                                           % ct->hash_size];
+
+    for (; *ep; ep = &(*ep)->hash_next)
+        if (!cql_strcmp((*ep)->pattern, e->pattern))
+            return; /* first definition wins */
+    e->hash_next = 0;
+    *ep = e;
+}
+
+static void prop_hash_grow(cql_transform_t ct)
+{
+    struct cql_prop_entry *e;
+    size_t i;
+
+    xfree(ct->hash);
+    ct->hash_size = ct->hash_size ? 2 * ct->hash_size : 64;
+    ct->hash = (struct cql_prop_entry **)
+        xmalloc(ct->hash_size * sizeof(*ct->hash));
+    for (i = 0; i < ct->hash_size; i++)
+        ct->hash[i] = 0;
+    for (e = ct->entry; e; e = e->next)
+        prop_hash_insert(ct, e);
+}
+
+static struct cql_prop_cat *prop_cat_get(cql_transform_t ct,
+                                         const char *name, size_t len,
+                                         int create)
+{
+    struct cql_prop_cat *cat;
+
+    for (cat = ct->cat; cat; cat = cat->next)
+        if (cat->len == len && !memcmp(cat->name, name, len))
+            return cat;
+    if (!create)
+        return 0;
+    cat = (struct cql_prop_cat *) nmem_malloc(ct->nmem, sizeof(*cat));
+    cat->name = nmem_strdupn(ct->nmem, name, len);
+    cat->len = len;
+    cat->entry = 0;
+    cat->last = &cat->entry;
+    cat->next = ct->cat;
+    ct->cat = cat;
+    return cat;
+}
+
+static void prop_add(cql_transform_t ct, struct cql_prop_entry *e)
+{
+    const char *dot = strchr(e->pattern, '.');
+    struct cql_prop_cat *cat;
+
+    e->next = 0;
+    *ct->last = e;
+    ct->last = &e->next;
+
+    if (++(ct->num_entries) > ct->hash_size)
+        prop_hash_grow(ct);
+    else
+        prop_hash_insert(ct, e);
+
+    e->cat_next = 0;
+    if (dot)
+    {
+        cat = prop_cat_get(ct, e->pattern, dot + 1 - e->pattern, 1);
+        *cat->last = e;
+        cat->last = &e->cat_next;
+    }
+
+    e->set_next = 0;
+    if (!cql_strncmp(e->pattern, "set.", 4) || !cql_strcmp(e->pattern, "set"))
+    {
+        *ct->set_last = e;
+        ct->set_last = &e->set_next;
+    }
+}
+
 static int cql_transform_parse_tok_line(cql_transform_t ct,
                                         const char *pattern,
                                         yaz_tok_parse_t tp)
@@ -167,30 +287,28 @@ static int cql_transform_parse_tok_line(cql_transform_t ct,
     }
     if (ret == 0) /* OK? */
     {
-        struct cql_prop_entry **pp = &ct->entry;
-        while (*pp)
-            pp = &(*pp)->next;
-        *pp = (struct cql_prop_entry *) xmalloc(sizeof(**pp));
-        (*pp)->pattern = xstrdup(pattern);
-        (*pp)->value = xstrdup(wrbuf_cstr(w));
-
-        (*pp)->attr_list.num_attributes = ae_num;
+        struct cql_prop_entry *e = (struct cql_prop_entry *)
+            xmalloc(sizeof(*e));
+        e->pattern = xstrdup(pattern);
+        e->value = xstrdup(wrbuf_cstr(w));
+
+        e->attr_list.num_attributes = ae_num;
         if (ae_num == 0)
-            (*pp)->attr_list.attributes = 0;
+            e->attr_list.attributes = 0;
         else
         {
-            (*pp)->attr_list.attributes = (Z_AttributeElement **)
+            e->attr_list.attributes = (Z_AttributeElement **)
                 nmem_malloc(ct->nmem,
                             ae_num * sizeof(Z_AttributeElement *));
-            memcpy((*pp)->attr_list.attributes, ae,
+            memcpy(e->attr_list.attributes, ae,
                    ae_num * sizeof(Z_AttributeElement *));
         }
-        (*pp)->next = 0;
+        prop_add(ct, e);
 
         if (0)
         {
             ODR pr = odr_createmem(ODR_PRINT);
-            Z_AttributeList *alp = &(*pp)->attr_list;
+            Z_AttributeList *alp = &e->attr_list;
             odr_setprint_noclose(pr, yaz_log_file());
             z_AttributeList(pr, &alp, 0, 0);
             odr_destroy(pr);
@@ -266,6 +384,7 @@ void cql_transform_close(cql_transform_t ct)
         xfree(pe);
         pe = pe_next;
     }
+    xfree(ct->hash);
     wrbuf_destroy(ct->addinfo);
     yaz_tok_cfg_destroy(ct->tok_cfg);
     nmem_destroy(ct->nmem);
@@ -297,25 +416,71 @@ struct Z_AttributeElement {
 };
 #endif
 
+/* returns 0 if a and b would encode the same */
 static int compare_attr(Z_AttributeElement *a, Z_AttributeElement *b)
 {
-    ODR odr_a = odr_createmem(ODR_ENCODE);
-    ODR odr_b = odr_createmem(ODR_ENCODE);
-    int len_a, len_b;
-    char *buf_a, *buf_b;
-    int ret;
+    int i;
 
-    z_AttributeElement(odr_a, &a, 0, 0);
-    z_AttributeElement(odr_b, &b, 0, 0);
+    if (*a->attributeType != *b->attributeType || a->which != b->which)
+        return 1;
+    if (a->attributeSet || b->attributeSet)
+    {
+        if (!a->attributeSet || !b->attributeSet
+            || oid_oidcmp(a->attributeSet, b->attributeSet))
+            return 1;
+    }
+    if (a->which == Z_AttributeValue_numeric)
+        return *a->value.numeric != *b->value.numeric;
+    else if (a->which == Z_AttributeValue_complex)
+    {
+        Z_ComplexAttribute *ca = a->value.complex;
+        Z_ComplexAttribute *cb = b->value.complex;
 
-    buf_a = odr_getbuf(odr_a, &len_a, 0);
-    buf_b = odr_getbuf(odr_b, &len_b, 0);
+        if (ca->num_list != cb->num_list
+            || ca->num_semanticAction != cb->num_semanticAction)
+            return 1;
+        for (i = 0; i < ca->num_list; i++)
+        {
+            Z_StringOrNumeric *sa = ca->list[i];
+            Z_StringOrNumeric *sb = cb->list[i];
+
+            if (sa->which != sb->which)
+                return 1;
+            if (sa->which == Z_StringOrNumeric_string)
+            {
+                if (strcmp(sa->u.string, sb->u.string))
+                    return 1;
+            }
+            else if (*sa->u.numeric != *sb->u.numeric)
+                return 1;
+        }
+        for (i = 0; i < ca->num_semanticAction; i++)
+            if (*ca->semanticAction[i] != *cb->semanticAction[i])
+                return 1;
+    }
+    return 0;
+}
 
-    ret = yaz_memcmp(buf_a, buf_b, len_a, len_b);
+/* all attributes of entry e are in attributes */
+static int match_attr(struct cql_prop_entry *e, Z_AttributeList *attributes)
+{
+    int i;
 
-    odr_destroy(odr_a);
-    odr_destroy(odr_b);
-    return ret;
+    for (i = 0; i < e->attr_list.num_attributes; i++)
+    {
+        /* entry attribute */
+        Z_AttributeElement *e_ae = e->attr_list.attributes[i];
+        int j;
+        for (j = 0; j < attributes->num_attributes; j++)
+        {
+            /* actual attribute */
+            if (compare_attr(e_ae, attributes->attributes[j]) == 0)
+                break;
+        }
+        if (j == attributes->num_attributes)
+            return 0; /* i was not found at all.. */
+    }
+    return 1;
 }
 
 const char *cql_lookup_reverse(cql_transform_t ct,
@@ -324,33 +489,22 @@ const char *cql_lookup_reverse(cql_transform_t ct,
 {
     struct cql_prop_entry *e;
     size_t clen = strlen(category);
-    for (e = ct->entry; e; e = e->next)
-    {
-        if (!strncmp(e->pattern, category, clen))
-        {
-            /* category matches.. See if attributes in pattern value
-               are all listed in actual attributes */
-            int i;
-            for (i = 0; i < e->attr_list.num_attributes; i++)
-            {
-                /* entry attribute */
-                Z_AttributeElement *e_ae = e->attr_list.attributes[i];
-                int j;
-                for (j = 0; j < attributes->num_attributes; j++)
-                {
-                    /* actual attribute */
-                    Z_AttributeElement *a_ae = attributes->attributes[j];
-                    int r = compare_attr(e_ae, a_ae);
-                    if (r == 0)
-                        break;
-                }
-                if (j == attributes->num_attributes)
-                    break; /* i was not found at all.. try next pattern */
+    const char *dot = strchr(category, '.');
 
-            }
-            if (i == e->attr_list.num_attributes)
+    if (dot && dot[1] == '\0')
+    {   /* whole category such as "index.": only walk its entries */
+        struct cql_prop_cat *cat = prop_cat_get(ct, category, clen, 0);
+        for (e = cat ? cat->entry : 0; e; e = e->cat_next)
+            if (match_attr(e, attributes))
                 return e->pattern + clen;
-        }
+        return 0;
+    }
+    for (e = ct->entry; e; e = e->next)
+    {
+        /* category matches.. See if attributes in pattern value
+           are all listed in actual attributes */
+        if (!strncmp(e->pattern, category, clen) && match_attr(e, attributes))
+            return e->pattern + clen;
     }
     return 0;
 }
@@ -373,7 +527,10 @@ static const char *cql_lookup_property(cql_transform_t ct,
     else
         return 0;
 
-    for (e = ct->entry; e; e = e->next)
+    if (!ct->hash_size)
+        return 0;
+    for (e = ct->hash[prop_hash(pattern) % ct->hash_size]; e;
+         e = e->hash_next)
     {
         if (!cql_strcmp(e->pattern, pattern))
             return e->value;
@@ -393,11 +550,11 @@ int cql_pr_attr_uri(cql_transform_t ct, WRBUF addinfo, const char *category,
 
     if (uri)
     {
+        struct cql_prop_cat *cat = prop_cat_get(ct, "set.", 4, 0);
         struct cql_prop_entry *e;
 
-        for (e = ct->entry; e; e = e->next)
-            if (!memcmp(e->pattern, "set.", 4) && e->value &&
-                !strcmp(e->value, uri))
+        for (e = cat ? cat->entry : 0; e; e = e->cat_next)
+            if (e->value && !strcmp(e->value, uri))
             {
                 prefix = e->pattern+4;
                 break;
@@ -933,7 +1090,7 @@ int cql_transform_r(cql_transform_t ct, struct cql_node *cn,
     NMEM nmem = nmem_create();
     int r;
 
-    for (e = ct->entry; e ; e = e->next)
+    for (e = ct->set_entry; e ; e = e->set_next)
     {
         if (!cql_strncmp(e->pattern, "set.", 4))
             cql_apply_prefix(nmem, cn, e->pattern+4, e->value);
@@ -49,6 +49,7 @@ struct yaz_iconv_encoder_s {
                            char **outbuf, size_t *outbytesleft);
     void (*init_handle)(yaz_iconv_encoder_t e);
     void (*destroy_handle)(yaz_iconv_encoder_t e);
+    int utf8;  /* stateless UTF-8 output; decoders may write it directly */
 };
 
 yaz_iconv_encoder_t yaz_marc8_encoder(const char *name,
@@ -86,6 +87,11 @@ struct yaz_iconv_decoder_s {
     unsigned long (*read_handle)(yaz_iconv_t cd, yaz_iconv_decoder_t d,
                                  unsigned char *inbuf,
                                  size_t inbytesleft, size_t *no_read);
+    /* optional: converts as much input as it can straight to UTF-8,
+       leaving the rest to read_handle. Returns number of bytes read */
+    size_t (*bulk_utf8_handle)(yaz_iconv_t cd, yaz_iconv_decoder_t d,
+                               unsigned char **inbuf, size_t *inbytesleft,
+                               char **outbuf, size_t *outbytesleft);
     void (*destroy_handle)(yaz_iconv_decoder_t d);
 };
 
@@ -123,6 +123,122 @@ static unsigned long read_marc8s(yaz_iconv_t cd, yaz_iconv_decoder_t d,
     return x;
 }
 
+/* ANSEL (G1) characters 0x80-0xFF that are not combining and always
+   consume one byte, as yaz_marc8_45_conv returns them. 0 for the rest,
+   which are left to the trie */
+static const unsigned short ansel_g1[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0x0098, 0x009C, 0, 0, 0, 0x200D, 0x200C, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0x0141, 0x00D8, 0x0110, 0x00DE, 0x00C6, 0x0152, 0x02B9,
+    0x00B7, 0x266D, 0x00AE, 0x00B1, 0x01A0, 0x01AF, 0x02BC, 0,
+    0x02BB, 0x0142, 0x00F8, 0x0111, 0x00FE, 0x00E6, 0x0153, 0x02BA,
+    0x0131, 0x00A3, 0x00F0, 0, 0x01A1, 0x01B0, 0, 0,
+    0x00B0, 0x2113, 0x2117, 0x00A9, 0x266F, 0x00BF, 0x00A1, 0x00DF,
+    0x20AC, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0
+};
+
+#define WORD_ONES ((size_t) -1 / 255)
+#define WORD_HIGH (WORD_ONES * 0x80)
+
+/* whether all bytes of w are printable ASCII (0x20-0x7E) */
+static int plain_word(size_t w)
+{
+    size_t del = w ^ (WORD_ONES * 0x7f);
+    return !((w | ((w - WORD_ONES * 0x20) & ~w)
+              | ((del - WORD_ONES) & ~del)) & WORD_HIGH);
+}
+
+/* Converts runs of characters that decode on their own: printable ASCII
+   with G0 ASCII, copied a word at a time, and the plain ANSEL characters
+   with G1 ANSEL. Stops at anything else (escapes, combining characters,
+   other sets, control characters) and leaves it to read_marc8 */
+static size_t bulk_marc8(yaz_iconv_t cd, yaz_iconv_decoder_t d,
+                         unsigned char **inbuf, size_t *inbytesleft,
+                         char **outbuf, size_t *outbytesleft)
+{
+    struct decoder_data *data = (struct decoder_data *) d->data;
+    unsigned char *inp = *inbuf;
+    unsigned char *outp = (unsigned char *) *outbuf;
+    size_t inleft = *inbytesleft;
+    size_t outleft = *outbytesleft;
+    int g0_ascii = data->g0_mode == 'B' || data->g0_mode == 's';
+    int g1_ansel = data->g1_mode == 'E';
+
+    if (data->comb_offset < data->comb_size)
+        return 0;
+    while (inleft > 0)
+    {
+        unsigned long x = *inp;
+
+        if (g0_ascii)
+        {
+            size_t w;
+            while (inleft >= sizeof(w) && outleft >= sizeof(w))
+            {
+                memcpy(&w, inp, sizeof(w));
+                if (!plain_word(w))
+                    break;
+                memcpy(outp, &w, sizeof(w));
+                inp += sizeof(w);
+                outp += sizeof(w);
+                inleft -= sizeof(w);
+                outleft -= sizeof(w);
+            }
+            if (inleft == 0)
+                break;
+            x = *inp;
+        }
+        if (x >= 0x80)
+        {
+            if (!g1_ansel || !(x = ansel_g1[x - 0x80]))
+                break;
+        }
+        else if (!g0_ascii || x < 0x20 || x == 0x7f)
+            break;
+
+        if (x < 0x80)
+        {
+            if (outleft < 1)
+                break;
+            *outp++ = (unsigned char) x;
+            outleft--;
+        }
+        else if (x < 0x800)
+        {
+            if (outleft < 2)
+                break;
+            *outp++ = (unsigned char) ((x >> 6) | 0xc0);
+            *outp++ = (unsigned char) ((x & 0x3f) | 0x80);
+            outleft -= 2;
+        }
+        else
+        {
+            if (outleft < 3)
+                break;
+            *outp++ = (unsigned char) ((x >> 12) | 0xe0);
+            *outp++ = (unsigned char) (((x >> 6) & 0x3f) | 0x80);
+            *outp++ = (unsigned char) ((x & 0x3f) | 0x80);
+            outleft -= 3;
+        }
+        inp++;
+        inleft--;
+    }
+    *outbuf = (char *) outp;
+    *outbytesleft = outleft;
+    *inbytesleft = inleft;
+    inleft = inp - *inbuf;
+    *inbuf = inp;
+    return inleft;
+}
+
 static unsigned long yaz_read_marc8_comb(yaz_iconv_t cd,
                                          struct decoder_data *data,
                                          unsigned char *inp,
@@ -280,16 +396,19 @@ yaz_iconv_decoder_t yaz_marc8_decoder(const char *fromcode,
     {
         d->read_handle = read_marc8;
         d->init_handle = init_marc8;
+        d->bulk_utf8_handle = bulk_marc8;
     }
     else if (!yaz_matchstr(fromcode, "MARC8s"))
     {
         d->read_handle = read_marc8s;
         d->init_handle = init_marc8;
+        d->bulk_utf8_handle = bulk_marc8;
     }
     else if (!yaz_matchstr(fromcode, "MARC8c"))
     {
         d->read_handle = read_marc8;
         d->init_handle = init_marc8c;
+        d->bulk_utf8_handle = bulk_marc8;
     }
     else
         return 0;
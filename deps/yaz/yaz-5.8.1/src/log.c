@@ -229,8 +229,10 @@ void yaz_log_init_level(int level)
         yaz_log(YLOG_LOGLVL, "Setting log level to %d = 0x%08x",
                 l_level, l_level);
         /* determine size of mask_names (locked) */
+        yaz_log_lock();
         for (sz = 0; mask_names[sz].name; sz++)
             ;
+        yaz_log_unlock();
         /* second pass without lock */
         for (i = 0; i < sz; i++)
             if (mask_names[i].mask && *mask_names[i].name)
@@ -536,47 +538,64 @@ static char *clean_name(const char *name, size_t len, char *namebuf, size_t bufl
     return start;
 }
 
+/* mask_names only grows, under log_mutex. Entries never change once
+   added, so entries counted with the lock held may be read without it */
 static int define_module_bit(const char *name)
 {
     size_t i;
+    int mask = 0;
+    char *copy;
 
+    yaz_log_lock();
     for (i = 0; mask_names[i].name; i++)
         if (0 == strcmp(mask_names[i].name, name))
         {
-            return mask_names[i].mask;
+            mask = mask_names[i].mask;
+            yaz_log_unlock();
+            return mask;
         }
-    if ( (i>=MAX_MASK_NAMES) || (next_log_bit & (1U<<31) ))
+    if ( (i>=MAX_MASK_NAMES-1) || (next_log_bit & (1U<<31) ))
     {
+        yaz_log_unlock();
         yaz_log(YLOG_WARN, "No more log bits left, not logging '%s'", name);
         return 0;
     }
-    mask_names[i].mask = (int) next_log_bit; /* next_log_bit can hold int */
+    copy = (char *) malloc(strlen(name)+1);
+    strcpy(copy, name);
+    mask = (int) next_log_bit; /* next_log_bit can hold int */
     next_log_bit = next_log_bit<<1;
-    mask_names[i].name = (char *) malloc(strlen(name)+1);
-    strcpy(mask_names[i].name, name);
     mask_names[i+1].name = NULL;
     mask_names[i+1].mask = 0;
-    return mask_names[i].mask;
+    mask_names[i].mask = mask;
+    mask_names[i].name = copy;
+    yaz_log_unlock();
+    return mask;
 }
 
 int yaz_log_module_level(const char *name)
 {
     int i;
+    int mask = 0, found = 0;
     char clean[255];
     char *n = clean_name(name, strlen(name), clean, sizeof(clean));
     yaz_init_globals();
 
+    yaz_log_lock();
     for (i = 0; mask_names[i].name; i++)
         if (0==strcmp(n, mask_names[i].name))
         {
-            yaz_log(YLOG_LOGLVL, "returning log bit 0x%x for '%s' %s",
-                    mask_names[i].mask, n,
-                    strcmp(n,name) ? name : "");
-            return mask_names[i].mask;
+            mask = mask_names[i].mask;
+            found = 1;
+            break;
         }
-    yaz_log(YLOG_LOGLVL, "returning NO log bit for '%s' %s", n,
-            strcmp(n, name) ? name : "" );
-    return 0;
+    yaz_log_unlock();
+    if (found)
+        yaz_log(YLOG_LOGLVL, "returning log bit 0x%x for '%s' %s",
+                mask, n, strcmp(n,name) ? name : "");
+    else
+        yaz_log(YLOG_LOGLVL, "returning NO log bit for '%s' %s", n,
+                strcmp(n, name) ? name : "" );
+    return mask;
 }
 
 int yaz_log_mask_str(const char *str)
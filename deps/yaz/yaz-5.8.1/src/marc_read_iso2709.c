@@ -20,6 +20,7 @@
 #include <string.h>
 #include <yaz/marcdisp.h>
 #include <yaz/wrbuf.h>
+#include <yaz/xmalloc.h>
 #include <yaz/yaz-util.h>
 
 int yaz_marc_read_iso2709(yaz_marc_t mt, const char *buf, int bsize)
@@ -223,6 +224,235 @@ int yaz_marc_read_iso2709(yaz_marc_t mt, const char *buf, int bsize)
     return record_length;
 }
 
+yaz_marc_index_t yaz_marc_index_create(void)
+{
+    yaz_marc_index_t idx = (yaz_marc_index_t) xmalloc(sizeof(*idx));
+
+    idx->max_records = 16;
+    idx->max_fields = 512;
+    idx->max_subfields = 2048;
+    idx->record_offset = (int *) xmalloc(idx->max_records * sizeof(int));
+    idx->record_field = (int *) xmalloc((idx->max_records + 1) * sizeof(int));
+    idx->field_tag = (short *) xmalloc(idx->max_fields * sizeof(short));
+    idx->field_offset = (int *) xmalloc(idx->max_fields * sizeof(int));
+    idx->field_length = (int *) xmalloc(idx->max_fields * sizeof(int));
+    idx->field_subfield = (int *) xmalloc((idx->max_fields + 1) * sizeof(int));
+    idx->subfield_offset = (int *) xmalloc(idx->max_subfields * sizeof(int));
+    idx->subfield_length = (int *) xmalloc(idx->max_subfields * sizeof(int));
+    yaz_marc_index_reset(idx);
+    return idx;
+}
+
+void yaz_marc_index_destroy(yaz_marc_index_t idx)
+{
+    if (idx)
+    {
+        xfree(idx->record_offset);
+        xfree(idx->record_field);
+        xfree(idx->field_tag);
+        xfree(idx->field_offset);
+        xfree(idx->field_length);
+        xfree(idx->field_subfield);
+        xfree(idx->subfield_offset);
+        xfree(idx->subfield_length);
+        xfree(idx);
+    }
+}
+
+void yaz_marc_index_reset(yaz_marc_index_t idx)
+{
+    idx->num_records = idx->num_fields = idx->num_subfields = 0;
+    idx->record_field[0] = 0;
+    idx->field_subfield[0] = 0;
+}
+
+static void index_add_field(yaz_marc_index_t idx, const char *tag,
+                            int offset)
+{
+    int f = idx->num_fields;
+
+    if (f == idx->max_fields)
+    {
+        idx->max_fields *= 2;
+        idx->field_tag = (short *)
+            xrealloc(idx->field_tag, idx->max_fields * sizeof(short));
+        idx->field_offset = (int *)
+            xrealloc(idx->field_offset, idx->max_fields * sizeof(int));
+        idx->field_length = (int *)
+            xrealloc(idx->field_length, idx->max_fields * sizeof(int));
+        idx->field_subfield = (int *)
+            xrealloc(idx->field_subfield,
+                     (idx->max_fields + 1) * sizeof(int));
+    }
+    if (yaz_isdigit(tag[0]) && yaz_isdigit(tag[1]) && yaz_isdigit(tag[2]))
+        idx->field_tag[f] = (short)
+            ((tag[0] - '0') * 100 + (tag[1] - '0') * 10 + tag[2] - '0');
+    else
+        idx->field_tag[f] = -1;
+    idx->field_offset[f] = offset;
+    idx->field_length[f] = 0;
+}
+
+static void index_add_subfield(yaz_marc_index_t idx, int offset, int length)
+{
+    int s = idx->num_subfields;
+
+    if (s == idx->max_subfields)
+    {
+        idx->max_subfields *= 2;
+        idx->subfield_offset = (int *)
+            xrealloc(idx->subfield_offset, idx->max_subfields * sizeof(int));
+        idx->subfield_length = (int *)
+            xrealloc(idx->subfield_length, idx->max_subfields * sizeof(int));
+    }
+    idx->subfield_offset[s] = offset;
+    idx->subfield_length[s] = length;
+    idx->num_subfields++;
+}
+
+/* the part of yaz_marc_set_leader the directory and data depend on */
+static void index_leader(const char *leader, int *indicator_length,
+                         int *base_address, int *length_data_entry,
+                         int *length_starting)
+{
+    if (!atoi_n_check(leader + 10, 1, indicator_length)
+        || *indicator_length == 0)
+        *indicator_length = 2;
+    if (!atoi_n_check(leader + 12, 5, base_address))
+        *base_address = 0;
+    if (!atoi_n_check(leader + 20, 1, length_data_entry)
+        || *length_data_entry < 3)
+        *length_data_entry = 4;
+    if (!atoi_n_check(leader + 21, 1, length_starting) || *length_starting < 4)
+        *length_starting = 5;
+}
+
+/* Same checks as yaz_marc_read_iso2709, but only offsets are recorded */
+int yaz_marc_index_iso2709(yaz_marc_index_t idx, const char *buf,
+                           int offset, int bsize)
+{
+    int entry_p;
+    int end_of_directory;
+    int record_length;
+    int indicator_length;
+    int base_address;
+    int length_data_entry;
+    int length_starting;
+    int r = idx->num_records;
+    int ret = -1;
+
+    if (r == idx->max_records)
+    {
+        idx->max_records *= 2;
+        idx->record_offset = (int *)
+            xrealloc(idx->record_offset, idx->max_records * sizeof(int));
+        idx->record_field = (int *)
+            xrealloc(idx->record_field,
+                     (idx->max_records + 1) * sizeof(int));
+    }
+    idx->record_offset[r] = -1;
+    idx->num_records++;
+
+    buf += offset;
+    if ((bsize != -1 && bsize < 25) || !atoi_n_check(buf, 5, &record_length)
+        || record_length < 25 || (bsize != -1 && record_length > bsize))
+        goto out;
+    index_leader(buf, &indicator_length, &base_address,
+                 &length_data_entry, &length_starting);
+
+    /* directory first: a record without FS is bad even when its data
+       would be given up on before the end of the directory */
+    for (entry_p = 24; buf[entry_p] != ISO2709_FS; )
+    {
+        int l = 3 + length_data_entry + length_starting;
+
+        if (entry_p + l >= record_length)
+            goto out; /* missing FS char */
+        while (--l >= 3)
+            if (!yaz_isdigit(buf[entry_p + l]))
+                break;
+        if (l >= 3)
+            break;
+        entry_p += 3 + length_data_entry + length_starting;
+    }
+    end_of_directory = entry_p;
+
+    for (entry_p = 24; entry_p != end_of_directory; )
+    {
+        int data_length, data_offset, end_offset, i;
+        int identifier_flag = 0;
+        const char *tag = buf + entry_p;
+
+        data_length = atoi_n(buf + entry_p + 3, length_data_entry);
+        data_offset = atoi_n(buf + entry_p + 3 + length_data_entry,
+                             length_starting);
+        entry_p += 3 + length_data_entry + length_starting;
+
+        i = data_offset + base_address;
+        end_offset = i + data_length - 1;
+        if (data_length <= 0 || data_offset < 0 || end_offset >= record_length)
+            break;
+
+        if (memcmp(tag, "00", 2))
+            identifier_flag = 1;
+        else if (indicator_length < 4 && indicator_length > 0)
+        {
+            if (buf[i + indicator_length] == ISO2709_IDFS)
+                identifier_flag = 1;
+            else if (buf[i + indicator_length + 1] == ISO2709_IDFS)
+                identifier_flag = 2;
+        }
+
+        if (identifier_flag)
+        {
+            i += identifier_flag - 1;
+            if (indicator_length)
+            {
+                int j;
+                for (j = indicator_length; --j >= 0; )
+                    if (buf[j + i] < ' ')
+                    {
+                        j++;
+                        i += j;
+                        end_offset += j;
+                        break;
+                    }
+            }
+            index_add_field(idx, tag, offset + i);
+            i += indicator_length;
+            while (i < end_offset &&
+                   buf[i] != ISO2709_RS && buf[i] != ISO2709_FS)
+            {
+                int code_offset = i + 1;
+
+                i++;
+                while (i < end_offset &&
+                       buf[i] != ISO2709_RS && buf[i] != ISO2709_IDFS &&
+                       buf[i] != ISO2709_FS)
+                    i++;
+                if (i > code_offset)
+                    index_add_subfield(idx, offset + code_offset,
+                                       i - code_offset);
+            }
+        }
+        else
+        {
+            index_add_field(idx, tag, offset + i);
+            while (i < end_offset &&
+                   buf[i] != ISO2709_RS && buf[i] != ISO2709_FS)
+                i++;
+        }
+        idx->field_length[idx->num_fields] =
+            offset + i - idx->field_offset[idx->num_fields];
+        idx->field_subfield[++idx->num_fields] = idx->num_subfields;
+    }
+    idx->record_offset[r] = offset;
+    ret = record_length;
+out:
+    idx->record_field[r + 1] = idx->num_fields;
+    return ret;
+}
+
 /*
  * Local variables:
  * c-basic-offset: 4
@@ -634,6 +634,8 @@ int yaz_marc_write_mode(yaz_marc_t mt, WRBUF wr)
         return yaz_marc_write_check(mt, wr);
     case YAZ_MARC_JSON:
         return yaz_marc_write_json(mt, wr);
+    case YAZ_MARC_JSON_COMPACT:
+        return yaz_marc_write_json_compact(mt, wr);
     }
     return -1;
 }
@@ -1326,6 +1328,203 @@ int yaz_marc_write_json(yaz_marc_t mt, WRBUF w)
     return 0;
 }
 
+/* output size of yaz_marc_write_json_compact when nothing is escaped or
+   converted; reserved up front so the writer rarely grows the buffer */
+static size_t json_compact_size(struct yaz_marc_node *nodes)
+{
+    struct yaz_marc_node *n;
+    size_t sz = 32;
+
+    for (n = nodes; n; n = n->next)
+    {
+        struct yaz_marc_subfield *s;
+        switch (n->which)
+        {
+        case YAZ_MARC_LEADER:
+            sz += strlen(n->u.leader);
+            break;
+        case YAZ_MARC_CONTROLFIELD:
+            sz += strlen(n->u.controlfield.tag)
+                + strlen(n->u.controlfield.data) + 10;
+            break;
+        case YAZ_MARC_DATAFIELD:
+            sz += strlen(n->u.datafield.tag) + 24
+                + 10 * strlen(n->u.datafield.indicator);
+            for (s = n->u.datafield.subfields; s; s = s->next)
+                sz += strlen(s->code_data) + 8;
+            break;
+        default:
+            break;
+        }
+    }
+    return sz;
+}
+
+int yaz_marc_write_json_compact(yaz_marc_t mt, WRBUF w)
+{
+    int identifier_length;
+    struct yaz_marc_node *n;
+    const char *leader = 0;
+    const char *sep = "";
+    size_t sz;
+
+    for (n = mt->nodes; n; n = n->next)
+        if (n->which == YAZ_MARC_LEADER)
+            leader = n->u.leader;
+
+    if (!leader)
+        return -1;
+
+    if (!atoi_n_check(leader+11, 1, &identifier_length))
+        return -1;
+
+    sz = json_compact_size(mt->nodes);
+    if (wrbuf_len(w) + sz >= w->size)
+        wrbuf_grow(w, sz);
+
+    wrbuf_puts(w, "{\"leader\":\"");
+    wrbuf_json_puts(w, leader);
+    wrbuf_puts(w, "\",\"fields\":[");
+    for (n = mt->nodes; n; n = n->next)
+    {
+        struct yaz_marc_subfield *s;
+        const char *s_sep = "";
+        int i;
+        switch (n->which)
+        {
+        case YAZ_MARC_CONTROLFIELD:
+            wrbuf_puts(w, sep);
+            sep = ",";
+            wrbuf_puts(w, "{\"");
+            wrbuf_iconv_json_puts(w, mt->iconv_cd, n->u.controlfield.tag);
+            wrbuf_puts(w, "\":\"");
+            wrbuf_iconv_json_puts(w, mt->iconv_cd, n->u.controlfield.data);
+            wrbuf_puts(w, "\"}");
+            break;
+        case YAZ_MARC_DATAFIELD:
+            wrbuf_puts(w, sep);
+            sep = ",";
+            wrbuf_puts(w, "{\"");
+            wrbuf_json_puts(w, n->u.datafield.tag);
+            wrbuf_puts(w, "\":{\"subfields\":[");
+            for (s = n->u.datafield.subfields; s; s = s->next)
+            {
+                size_t using_code_len = get_subfield_len(mt, s->code_data,
+                                                         identifier_length);
+                wrbuf_puts(w, s_sep);
+                s_sep = ",";
+                wrbuf_puts(w, "{\"");
+                wrbuf_iconv_json_write(w, mt->iconv_cd,
+                                       s->code_data, using_code_len);
+                wrbuf_puts(w, "\":\"");
+                wrbuf_iconv_json_puts(w, mt->iconv_cd,
+                                      s->code_data + using_code_len);
+                wrbuf_puts(w, "\"}");
+            }
+            wrbuf_putc(w, ']');
+            for (i = 0; n->u.datafield.indicator[i]; i++)
+            {
+                wrbuf_puts(w, ",\"ind");
+                wrbuf_putc(w, '1' + i);
+                wrbuf_puts(w, "\":\"");
+                wrbuf_json_write(w, n->u.datafield.indicator + i, 1);
+                wrbuf_putc(w, '"');
+            }
+            wrbuf_puts(w, "}}");
+            break;
+        default:
+            break;
+        }
+    }
+    wrbuf_puts(w, "]}");
+    return 0;
+}
+
+static const char *marc_visit_conv(yaz_marc_t mt, WRBUF w,
+                                   const char *buf, size_t len)
+{
+    if (!mt->iconv_cd)
+        return buf;
+    wrbuf_rewind(w);
+    wrbuf_iconv_write(w, mt->iconv_cd, buf, len);
+    wrbuf_iconv_reset(w, mt->iconv_cd);
+    return wrbuf_cstr(w);
+}
+
+int yaz_marc_visit(yaz_marc_t mt, const struct yaz_marc_visitor *v,
+                   void *data)
+{
+    int identifier_length;
+    struct yaz_marc_node *n;
+    const char *leader = 0;
+    WRBUF w_code, w_value;
+
+    for (n = mt->nodes; n; n = n->next)
+        if (n->which == YAZ_MARC_LEADER)
+            leader = n->u.leader;
+
+    if (!leader)
+        return -1;
+
+    if (!atoi_n_check(leader+11, 1, &identifier_length))
+        return -1;
+
+    if (v->leader)
+        v->leader(data, leader);
+
+    w_code = wrbuf_alloc();
+    w_value = wrbuf_alloc();
+    for (n = mt->nodes; n; n = n->next)
+    {
+        struct yaz_marc_subfield *s;
+        const char *value;
+        size_t len;
+
+        switch (n->which)
+        {
+        case YAZ_MARC_LEADER:
+        case YAZ_MARC_COMMENT:
+            break;
+        case YAZ_MARC_CONTROLFIELD:
+            if (!v->controlfield)
+                break;
+            len = strlen(n->u.controlfield.data);
+            value = marc_visit_conv(mt, w_value, n->u.controlfield.data, len);
+            if (mt->iconv_cd)
+                len = wrbuf_len(w_value);
+            v->controlfield(data, n->u.controlfield.tag, value, len);
+            break;
+        case YAZ_MARC_DATAFIELD:
+            if (v->datafield)
+                v->datafield(data, n->u.datafield.tag,
+                             n->u.datafield.indicator);
+            if (!v->subfield)
+                break;
+            for (s = n->u.datafield.subfields; s; s = s->next)
+            {
+                size_t using_code_len = get_subfield_len(mt, s->code_data,
+                                                         identifier_length);
+                size_t code_len = using_code_len;
+                const char *code =
+                    marc_visit_conv(mt, w_code, s->code_data, code_len);
+
+                if (mt->iconv_cd)
+                    code_len = wrbuf_len(w_code);
+                len = strlen(s->code_data + using_code_len);
+                value = marc_visit_conv(mt, w_value,
+                                        s->code_data + using_code_len, len);
+                if (mt->iconv_cd)
+                    len = wrbuf_len(w_value);
+                v->subfield(data, code, code_len, value, len);
+            }
+            break;
+        }
+    }
+    wrbuf_destroy(w_code);
+    wrbuf_destroy(w_value);
+    return 0;
+}
+
 int yaz_marc_decode_wrbuf(yaz_marc_t mt, const char *buf, int bsize, WRBUF wr)
 {
     int s, r = yaz_marc_read_iso2709(mt, buf, bsize);
@@ -1457,6 +1656,8 @@ int yaz_marc_decode_formatstr(const char *arg)
         mode = YAZ_MARC_LINE;
     if (!strcmp(arg, "json"))
         mode = YAZ_MARC_JSON;
+    if (!strcmp(arg, "json-compact"))
+        mode = YAZ_MARC_JSON_COMPACT;
     return mode;
 }
 
@@ -7,9 +7,11 @@
  * \file nmem.c
  * \brief Implements Nibble Memory
  *
- * This is a simple and fairly wasteful little module for nibble memory
- * allocation.
- *
+ * Memory is handed out from blocks that are released all at once by
+ * nmem_reset or nmem_destroy. Blocks of the common sizes (size classes
+ * of 4K, 16K and 64K) are kept on per-thread free lists for reuse, so
+ * that repeated decoding does not go through malloc for every block.
+ * test/bench_nmem counts the blocks that still do.
  */
 #if HAVE_CONFIG_H
 #include <config.h>
@@ -20,12 +22,22 @@
 #include <string.h>
 #include <errno.h>
 #include <stddef.h>
+#if YAZ_POSIX_THREADS
+#include <pthread.h>
+#endif
 #include <yaz/xmalloc.h>
 #include <yaz/nmem.h>
 #include <yaz/log.h>
 
 #define NMEM_CHUNK (4*1024)
 
+/* block sizes NMEM_CHUNK << (2 * class) for each class */
+#define NMEM_CLASSES 3
+#define NMEM_CLASS_MAX (NMEM_CHUNK << (2 * (NMEM_CLASSES - 1)))
+
+/* max bytes of free blocks kept per size class and thread */
+#define NMEM_POOL_MAX (256*1024)
+
 struct nmem_block
 {
     char *buf;              /* memory allocated in this block */
@@ -37,10 +49,17 @@ struct nmem_block
 struct nmem_control
 {
     size_t total;
+    size_t chunk;           /* size of next block to allocate */
     struct nmem_block *blocks;
     struct nmem_control *next;
 };
 
+struct nmem_pool
+{
+    struct nmem_block *blocks[NMEM_CLASSES];
+    size_t size[NMEM_CLASSES];
+};
+
 struct align {
     char x;
     union {
@@ -58,36 +77,137 @@ struct align {
 
 #define NMEM_ALIGN (offsetof(struct align, u))
 
+/* block header is stored in front of its buffer */
+#define NMEM_HEAD \
+    ((sizeof(struct nmem_block) + NMEM_ALIGN - 1) & ~(NMEM_ALIGN - 1))
+
 static int log_level = 0;
 static int log_level_initialized = 0;
 
+#ifdef WIN32
+/* no pooling: blocks go straight back to the heap */
+static struct nmem_pool *get_pool(void)
+{
+    return 0;
+}
+#elif YAZ_POSIX_THREADS
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void pool_destroy(void *p)
+{
+    struct nmem_pool *pool = (struct nmem_pool *) p;
+    int i;
+
+    for (i = 0; i < NMEM_CLASSES; i++)
+    {
+        while (pool->blocks[i])
+        {
+            struct nmem_block *t = pool->blocks[i];
+            pool->blocks[i] = t->next;
+            xfree(t);
+        }
+    }
+    xfree(pool);
+}
+
+static void pool_init(void)
+{
+    pthread_key_create(&pool_key, pool_destroy);
+}
+
+static struct nmem_pool *get_pool(void)
+{
+    struct nmem_pool *pool;
+
+    pthread_once(&pool_once, pool_init);
+    pool = (struct nmem_pool *) pthread_getspecific(pool_key);
+    if (!pool)
+    {
+        pool = (struct nmem_pool *) xmalloc(sizeof(*pool));
+        memset(pool, 0, sizeof(*pool));
+        pthread_setspecific(pool_key, pool);
+    }
+    return pool;
+}
+#else
+static struct nmem_pool static_pool;
+
+static struct nmem_pool *get_pool(void)
+{
+    return &static_pool;
+}
+#endif
+
+/* size class for buffers of size bytes or -1 if larger than all classes */
+static int size_class(size_t size)
+{
+    int i;
+
+    for (i = 0; i < NMEM_CLASSES; i++)
+        if (size <= ((size_t) NMEM_CHUNK << (2 * i)))
+            return i;
+    return -1;
+}
+
 static void free_block(struct nmem_block *p)
 {
-    xfree(p->buf);
-    xfree(p);
+    int cls = size_class(p->size);
+    struct nmem_pool *pool;
+
     if (log_level)
         yaz_log(log_level, "nmem free_block p=%p", p);
+    if (cls >= 0 && (pool = get_pool())
+        && pool->size[cls] + p->size <= NMEM_POOL_MAX)
+    {
+        p->next = pool->blocks[cls];
+        pool->blocks[cls] = p;
+        pool->size[cls] += p->size;
+        return;
+    }
+    xfree(p);
 }
 
 /*
  * acquire a block with a minimum of size free bytes.
+ * Each new block for n is larger than the one before, up to the largest
+ * size class, so a big BER payload needs few blocks. nmem_reset starts
+ * over at NMEM_CHUNK.
  */
-static struct nmem_block *get_block(size_t size)
+static struct nmem_block *get_block(NMEM n, size_t size)
 {
-    struct nmem_block *r;
-    size_t get = NMEM_CHUNK;
+    struct nmem_block *r = 0;
+    size_t get = n->chunk;
+    int cls;
 
     if (log_level)
         yaz_log(log_level, "nmem get_block size=%ld", (long) size);
 
     if (get < size)
         get = size;
-    if (log_level)
-        yaz_log(log_level, "nmem get_block alloc new block size=%ld",
-                (long) get);
+    cls = size_class(get);
+    if (cls >= 0)
+    {
+        struct nmem_pool *pool = get_pool();
 
-    r = (struct nmem_block *) xmalloc(sizeof(*r));
-    r->buf = (char *)xmalloc(r->size = get);
+        get = (size_t) NMEM_CHUNK << (2 * cls);
+        if (pool && (r = pool->blocks[cls]))
+        {
+            pool->blocks[cls] = r->next;
+            pool->size[cls] -= get;
+        }
+    }
+    if (n->chunk < NMEM_CLASS_MAX)
+        n->chunk <<= 2;
+    if (!r)
+    {
+        if (log_level)
+            yaz_log(log_level, "nmem get_block alloc new block size=%ld",
+                    (long) get);
+        r = (struct nmem_block *) xmalloc(NMEM_HEAD + get);
+        r->buf = (char *) r + NMEM_HEAD;
+        r->size = get;
+    }
     r->top = 0;
     return r;
 }
@@ -106,6 +226,7 @@ void nmem_reset(NMEM n)
         free_block(t);
     }
     n->total = 0;
+    n->chunk = NMEM_CHUNK;
 }
 
 void *nmem_malloc(NMEM n, size_t size)
@@ -121,7 +242,7 @@ void *nmem_malloc(NMEM n, size_t size)
     p = n->blocks;
     if (!p || p->size < size + p->top)
     {
-        p = get_block(size);
+        p = get_block(n, size);
         p->next = n->blocks;
         n->blocks = p;
     }
@@ -150,6 +271,7 @@ NMEM nmem_create(void)
 
     r->blocks = 0;
     r->total = 0;
+    r->chunk = NMEM_CHUNK;
     r->next = 0;
 
     return r;
@@ -13,7 +13,11 @@
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#if YAZ_POSIX_THREADS
+#include <pthread.h>
+#endif
 
+#include <yaz/xmalloc.h>
 #include <yaz/marcdisp.h>
 #include <yaz/record_render.h>
 #include <yaz/yaz-iconv.h>
@@ -27,7 +31,202 @@
 #include <libxml/xpathInternals.h>
 #endif
 
-static yaz_iconv_t iconv_create_charset(const char *record_charset,
+/* type_spec as parsed by parse_type_spec */
+struct render_spec {
+    char type[40];
+    char charset[40];
+    char format[10];
+    char *base64_xpath;
+};
+
+struct render_spec_entry {
+    char *type_spec;
+    struct render_spec spec;
+    struct render_spec_entry *next;
+};
+
+struct render_conv {
+    char *to_set;
+    char *from_set;
+    yaz_iconv_t cd;
+    int in_use;
+    struct render_conv *next;
+};
+
+/* max entries of each cache before it is emptied */
+#define RENDER_MAX_SPECS 32
+#define RENDER_MAX_CONVS 8
+
+/* per-thread state kept between renders: parsed type specs, converters
+   and a MARC handle. Not used when busy (nested renders for base64=) */
+struct render_context {
+    NMEM nmem;
+    struct render_spec_entry *specs;
+    struct render_conv *convs;
+    int num_specs;
+    int num_convs;
+    yaz_marc_t mt;
+    int busy;
+};
+
+static void render_context_flush(struct render_context *ctx)
+{
+    while (ctx->convs)
+    {
+        struct render_conv *c = ctx->convs;
+        ctx->convs = c->next;
+        yaz_iconv_close(c->cd);
+    }
+    nmem_reset(ctx->nmem);
+    ctx->specs = 0;
+    ctx->num_specs = ctx->num_convs = 0;
+}
+
+#ifdef WIN32
+/* no context: every render sets up its own state */
+static struct render_context *get_context(void)
+{
+    return 0;
+}
+#else
+static struct render_context *render_context_create(void)
+{
+    struct render_context *ctx = (struct render_context *)
+        xmalloc(sizeof(*ctx));
+    ctx->nmem = nmem_create();
+    ctx->specs = 0;
+    ctx->convs = 0;
+    ctx->num_specs = ctx->num_convs = 0;
+    ctx->mt = 0;
+    ctx->busy = 0;
+    return ctx;
+}
+
+#if YAZ_POSIX_THREADS
+static pthread_key_t context_key;
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+
+static void render_context_destroy(void *p)
+{
+    struct render_context *ctx = (struct render_context *) p;
+
+    render_context_flush(ctx);
+    nmem_destroy(ctx->nmem);
+    yaz_marc_destroy(ctx->mt);
+    xfree(ctx);
+}
+
+static void context_init(void)
+{
+    pthread_key_create(&context_key, render_context_destroy);
+}
+
+static struct render_context *get_context(void)
+{
+    struct render_context *ctx;
+
+    pthread_once(&context_once, context_init);
+    ctx = (struct render_context *) pthread_getspecific(context_key);
+    if (!ctx)
+    {
+        ctx = render_context_create();
+        pthread_setspecific(context_key, ctx);
+    }
+    return ctx;
+}
+#else
+static struct render_context *static_context;
+
+static struct render_context *get_context(void)
+{
+    if (!static_context)
+        static_context = render_context_create();
+    return static_context;
+}
+#endif
+#endif
+
+/* context for one render or 0 if renders must set up their own state */
+static struct render_context *render_context_get(void)
+{
+    struct render_context *ctx = get_context();
+
+    if (!ctx || ctx->busy)
+        return 0;
+    if (ctx->num_specs >= RENDER_MAX_SPECS
+        || ctx->num_convs >= RENDER_MAX_CONVS)
+        render_context_flush(ctx);
+    ctx->busy = 1;
+    return ctx;
+}
+
+static yaz_iconv_t render_iconv_open(struct render_context *ctx,
+                                     const char *to_set,
+                                     const char *from_set)
+{
+    struct render_conv *c;
+    yaz_iconv_t cd;
+
+    if (!ctx)
+        return yaz_iconv_open(to_set, from_set);
+    for (c = ctx->convs; c; c = c->next)
+        if (!c->in_use && !strcmp(c->to_set, to_set)
+            && !strcmp(c->from_set, from_set))
+        {
+            yaz_iconv(c->cd, 0, 0, 0, 0); /* reset state of last use */
+            c->in_use = 1;
+            return c->cd;
+        }
+    cd = yaz_iconv_open(to_set, from_set);
+    if (cd)
+    {
+        c = (struct render_conv *) nmem_malloc(ctx->nmem, sizeof(*c));
+        c->to_set = nmem_strdup(ctx->nmem, to_set);
+        c->from_set = nmem_strdup(ctx->nmem, from_set);
+        c->cd = cd;
+        c->in_use = 1;
+        c->next = ctx->convs;
+        ctx->convs = c;
+        ctx->num_convs++;
+    }
+    return cd;
+}
+
+static void render_iconv_close(struct render_context *ctx, yaz_iconv_t cd)
+{
+    struct render_conv *c;
+
+    if (!cd)
+        return;
+    if (!ctx)
+        yaz_iconv_close(cd);
+    else
+    {
+        for (c = ctx->convs; c; c = c->next)
+            if (c->cd == cd)
+                c->in_use = 0;
+    }
+}
+
+static yaz_marc_t render_marc_create(struct render_context *ctx)
+{
+    if (!ctx)
+        return yaz_marc_create();
+    if (!ctx->mt)
+        ctx->mt = yaz_marc_create();
+    yaz_marc_reset(ctx->mt);
+    yaz_marc_iconv(ctx->mt, 0);
+    return ctx->mt;
+}
+
+static void render_marc_destroy(struct render_context *ctx, yaz_marc_t mt)
+{
+    if (!ctx)
+        yaz_marc_destroy(mt);
+}
+
+static yaz_iconv_t iconv_create_charset(struct render_context *ctx,
+                                        const char *record_charset,
                                         yaz_iconv_t *cd2,
                                         const char *marc_buf,
                                         int sz)
@@ -67,26 +266,27 @@ static yaz_iconv_t iconv_create_charset(const char *record_charset,
     {
         if (yaz_marc_check_marc21_coding(from_set1, marc_buf, sz))
             from_set1 = "utf-8";
-        cd = yaz_iconv_open(to_set, from_set1);
+        cd = render_iconv_open(ctx, to_set, from_set1);
     }
     if (cd2)
     {
         if (from_set2)
-            *cd2 = yaz_iconv_open(to_set, from_set2);
+            *cd2 = render_iconv_open(ctx, to_set, from_set2);
         else
             *cd2 = 0;
     }
     return cd;
 }
 
-static const char *return_marc_record(WRBUF wrbuf,
+static const char *return_marc_record(struct render_context *ctx,
+                                      WRBUF wrbuf,
                                       int marc_type,
                                       int *len,
                                       const char *buf, int sz,
                                       const char *record_charset)
 {
-    yaz_iconv_t cd = iconv_create_charset(record_charset, 0, buf, sz);
-    yaz_marc_t mt = yaz_marc_create();
+    yaz_iconv_t cd = iconv_create_charset(ctx, record_charset, 0, buf, sz);
+    yaz_marc_t mt = render_marc_create(ctx);
     const char *ret_string = 0;
 
     if (cd)
@@ -97,13 +297,13 @@ static const char *return_marc_record(WRBUF wrbuf,
         *len = wrbuf_len(wrbuf);
         ret_string = wrbuf_cstr(wrbuf);
     }
-    yaz_marc_destroy(mt);
-    if (cd)
-        yaz_iconv_close(cd);
+    render_marc_destroy(ctx, mt);
+    render_iconv_close(ctx, cd);
     return ret_string;
 }
 
-static const char *return_opac_record(WRBUF wrbuf,
+static const char *return_opac_record(struct render_context *ctx,
+                                      WRBUF wrbuf,
                                       int marc_type,
                                       int *len,
                                       Z_OPACRecord *opac_rec,
@@ -112,7 +312,7 @@ static const char *return_opac_record(WRBUF wrbuf,
     yaz_iconv_t cd, cd2;
     const char *marc_buf = 0;
     int marc_sz = 0;
-    yaz_marc_t mt = yaz_marc_create();
+    yaz_marc_t mt = render_marc_create(ctx);
 
     if (opac_rec->bibliographicRecord)
     {
@@ -123,7 +323,7 @@ static const char *return_opac_record(WRBUF wrbuf,
             marc_sz = ext->u.octet_aligned->len;
         }
     }
-    cd = iconv_create_charset(record_charset, &cd2, marc_buf, marc_sz);
+    cd = iconv_create_charset(ctx, record_charset, &cd2, marc_buf, marc_sz);
 
     if (cd)
         yaz_marc_iconv(mt, cd);
@@ -134,22 +334,20 @@ static const char *return_opac_record(WRBUF wrbuf,
     else
         yaz_opac_decode_wrbuf(mt, opac_rec, wrbuf);
 
-    yaz_marc_destroy(mt);
-
-    if (cd)
-        yaz_iconv_close(cd);
-    if (cd2)
-        yaz_iconv_close(cd2);
+    render_marc_destroy(ctx, mt);
+    render_iconv_close(ctx, cd);
+    render_iconv_close(ctx, cd2);
     *len = wrbuf_len(wrbuf);
     return wrbuf_cstr(wrbuf);
 }
 
-static const char *return_string_record(WRBUF wrbuf,
+static const char *return_string_record(struct render_context *ctx,
+                                        WRBUF wrbuf,
                                         int *len,
                                         const char *buf, int sz,
                                         const char *record_charset)
 {
-    yaz_iconv_t cd = iconv_create_charset(record_charset, 0, 0, 0);
+    yaz_iconv_t cd = iconv_create_charset(ctx, record_charset, 0, 0, 0);
 
     if (cd)
     {
@@ -158,13 +356,14 @@ static const char *return_string_record(WRBUF wrbuf,
 
         buf = wrbuf_cstr(wrbuf);
         sz = wrbuf_len(wrbuf);
-        yaz_iconv_close(cd);
+        render_iconv_close(ctx, cd);
     }
     *len = sz;
     return buf;
 }
 
-static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
+static const char *return_record_wrbuf(struct render_context *ctx,
+                                       WRBUF wrbuf, int *len,
                                        Z_NamePlusRecord *npr,
                                        int marctype, const char *charset)
 {
@@ -175,11 +374,11 @@ static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
     /* render bibliographic record .. */
     if (r->which == Z_External_OPAC)
     {
-        return return_opac_record(wrbuf, marctype, len,
+        return return_opac_record(ctx, wrbuf, marctype, len,
                                   r->u.opac, charset);
     }
     if (r->which == Z_External_sutrs)
-        return return_string_record(wrbuf, len,
+        return return_string_record(ctx, wrbuf, len,
                                     (char*) r->u.sutrs->buf,
                                     r->u.sutrs->len,
                                     charset);
@@ -191,7 +390,7 @@ static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
             && oid_oidcmp(oid, yaz_oid_recsyn_html))
         {
             const char *ret_buf = return_marc_record(
-                wrbuf, marctype, len,
+                ctx, wrbuf, marctype, len,
                 (const char *) r->u.octet_aligned->buf,
                 r->u.octet_aligned->len,
                 charset);
@@ -201,7 +400,7 @@ static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
             if (yaz_oid_is_iso2709(oid) && marctype != YAZ_MARC_ISO2709)
                 return 0;
         }
-        return return_string_record(wrbuf, len,
+        return return_string_record(ctx, wrbuf, len,
                                     (const char *) r->u.octet_aligned->buf,
                                     r->u.octet_aligned->len,
                                     charset);
@@ -209,7 +408,7 @@ static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
     else if (r->which == Z_External_grs1)
     {
         yaz_display_grs1(wrbuf, r->u.grs1, 0);
-        return return_string_record(wrbuf, len,
+        return return_string_record(ctx, wrbuf, len,
                                     wrbuf_buf(wrbuf),
                                     wrbuf_len(wrbuf),
                                     charset);
@@ -217,12 +416,14 @@ static const char *return_record_wrbuf(WRBUF wrbuf, int *len,
     return 0;
 }
 
-static const char *get_record_format(WRBUF wrbuf, int *len,
+static const char *get_record_format(struct render_context *ctx,
+                                     WRBUF wrbuf, int *len,
                                      Z_NamePlusRecord *npr,
                                      int marctype, const char *charset,
                                      const char *format)
 {
-    const char *res = return_record_wrbuf(wrbuf, len, npr, marctype, charset);
+    const char *res = return_record_wrbuf(ctx, wrbuf, len, npr, marctype,
+                                          charset);
 #if YAZ_HAVE_XML2
     if (*format == '1')
     {
@@ -352,29 +553,19 @@ static const char *base64_render(NMEM nmem, WRBUF wrbuf,
     return buf;
 }
 
-const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
-                              WRBUF wrbuf,
-                              const char *type_spec, int *len)
+static void parse_type_spec(const char *type_spec, struct render_spec *spec,
+                            NMEM nmem)
 {
-    const char *ret = 0;
-    NMEM nmem = 0;
-    char *base64_xpath = 0;
     size_t i;
-    char type[40];
-    char charset[40];
-    char format[3];
     const char *cp = type_spec;
-    int len0;
 
-    if (!len)
-        len = &len0;
-
-    for (i = 0; cp[i] && cp[i] != ';' && cp[i] != ' ' && i < sizeof(type)-1;
-         i++)
-        type[i] = cp[i];
-    type[i] = '\0';
-    charset[0] = '\0';
-    format[0] = '\0';
+    for (i = 0; cp[i] && cp[i] != ';' && cp[i] != ' '
+             && i < sizeof(spec->type)-1; i++)
+        spec->type[i] = cp[i];
+    spec->type[i] = '\0';
+    spec->charset[0] = '\0';
+    spec->format[0] = '\0';
+    spec->base64_xpath = 0;
     while (1)
     {
         while (cp[i] == ' ')
@@ -392,10 +583,10 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
                 i++;
             for (j = 0; cp[i] && cp[i] != ';' && cp[i] != ' '; i++)
             {
-                if (j < sizeof(charset)-1)
-                    charset[j++] = cp[i];
+                if (j < sizeof(spec->charset)-1)
+                    spec->charset[j++] = cp[i];
             }
-            charset[j] = '\0';
+            spec->charset[j] = '\0';
         }
         else if (!strncmp(cp + i, "format=", 7))
         {
@@ -405,10 +596,10 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
                 i++;
             for (j = 0; cp[i] && cp[i] != ';' && cp[i] != ' '; i++)
             {
-                if (j < sizeof(format)-1)
-                    format[j++] = cp[i];
+                if (j < sizeof(spec->format)-1)
+                    spec->format[j++] = cp[i];
             }
-            format[j] = '\0';
+            spec->format[j] = '\0';
         }
         else if (!strncmp(cp + i, "base64=", 7))
         {
@@ -420,10 +611,56 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
             while (cp[i] && cp[i] != ';')
                 i++;
 
-            nmem = nmem_create();
-            base64_xpath = nmem_strdupn(nmem, cp + i0, i - i0);
+            spec->base64_xpath = nmem_strdupn(nmem, cp + i0, i - i0);
         }
     }
+}
+
+static struct render_spec *render_spec_get(struct render_context *ctx,
+                                           const char *type_spec)
+{
+    struct render_spec_entry *e;
+
+    for (e = ctx->specs; e; e = e->next)
+        if (!strcmp(e->type_spec, type_spec))
+            return &e->spec;
+    e = (struct render_spec_entry *) nmem_malloc(ctx->nmem, sizeof(*e));
+    e->type_spec = nmem_strdup(ctx->nmem, type_spec);
+    parse_type_spec(type_spec, &e->spec, ctx->nmem);
+    e->next = ctx->specs;
+    ctx->specs = e;
+    ctx->num_specs++;
+    return &e->spec;
+}
+
+const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
+                              WRBUF wrbuf,
+                              const char *type_spec, int *len)
+{
+    const char *ret = 0;
+    NMEM nmem = 0;
+    struct render_context *ctx = render_context_get();
+    struct render_spec spec_buf;
+    struct render_spec *spec = &spec_buf;
+    const char *type;
+    const char *charset;
+    const char *format;
+    int len0;
+
+    if (!len)
+        len = &len0;
+
+    if (ctx)
+        spec = render_spec_get(ctx, type_spec);
+    else
+    {
+        nmem = nmem_create();
+        parse_type_spec(type_spec, spec, nmem);
+    }
+    type = spec->type;
+    charset = spec->charset;
+    format = spec->format;
+
     if (!strcmp(type, "database"))
     {
         *len = (npr->databaseName ? strlen(npr->databaseName) : 0);
@@ -451,27 +688,29 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
         ;
     else if (!strcmp(type, "render"))
     {
-        ret = get_record_format(wrbuf, len, npr, YAZ_MARC_LINE, charset, format);
+        ret = get_record_format(ctx, wrbuf, len, npr, YAZ_MARC_LINE, charset,
+                                format);
     }
     else if (!strcmp(type, "xml"))
     {
-        ret = get_record_format(wrbuf, len, npr, YAZ_MARC_MARCXML, charset,
-                                format);
+        ret = get_record_format(ctx, wrbuf, len, npr, YAZ_MARC_MARCXML,
+                                charset, format);
     }
     else if (!strcmp(type, "txml"))
     {
-        ret = get_record_format(wrbuf, len, npr, YAZ_MARC_TURBOMARC, charset,
-                                format);
+        ret = get_record_format(ctx, wrbuf, len, npr, YAZ_MARC_TURBOMARC,
+                                charset, format);
     }
     else if (!strcmp(type, "json"))
     {
-        ret = get_record_format(wrbuf, len, npr, YAZ_MARC_JSON, charset,
-                                format);
+        ret = get_record_format(ctx, wrbuf, len, npr,
+                                strcmp(format, "compact") ? YAZ_MARC_JSON
+                                : YAZ_MARC_JSON_COMPACT, charset, format);
     }
     else if (!strcmp(type, "raw"))
     {
-        ret = get_record_format(wrbuf, len, npr, YAZ_MARC_ISO2709, charset,
-                                format);
+        ret = get_record_format(ctx, wrbuf, len, npr, YAZ_MARC_ISO2709,
+                                charset, format);
     }
     else if (!strcmp(type, "ext"))
     {
@@ -481,13 +720,14 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
     else if (!strcmp(type, "opac"))
     {
         if (npr->u.databaseRecord->which == Z_External_OPAC)
-            ret = get_record_format(wrbuf, len, npr, YAZ_MARC_MARCXML, charset,
-                                    format);
+            ret = get_record_format(ctx, wrbuf, len, npr, YAZ_MARC_MARCXML,
+                                    charset, format);
     }
 
-    if (base64_xpath && *len != -1)
+    if (spec->base64_xpath && *len != -1)
     {
-        char *type_spec = nmem_malloc(nmem,
+        NMEM b_nmem = nmem_create();
+        char *type_spec = nmem_malloc(b_nmem,
                                       strlen(type) + strlen(charset) + 11);
         strcpy(type_spec, type);
         if (*charset)
@@ -495,8 +735,12 @@ const char *yaz_record_render(Z_NamePlusRecord *npr, const char *schema,
             strcat(type_spec, "; charset=");
             strcat(type_spec, charset);
         }
-        ret = base64_render(nmem, wrbuf, ret, len, base64_xpath, type_spec);
+        ret = base64_render(b_nmem, wrbuf, ret, len, spec->base64_xpath,
+                            type_spec);
+        nmem_destroy(b_nmem);
     }
+    if (ctx)
+        ctx->busy = 0;
     nmem_destroy(nmem);
     return ret;
 }
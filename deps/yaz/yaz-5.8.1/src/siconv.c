@@ -101,9 +101,11 @@ yaz_iconv_t yaz_iconv_open(const char *tocode, const char *fromcode)
     cd->encoder.flush_handle = 0;
     cd->encoder.init_handle = 0;
     cd->encoder.destroy_handle = 0;
+    cd->encoder.utf8 = 0;
 
     cd->decoder.data = 0;
     cd->decoder.read_handle = 0;
+    cd->decoder.bulk_utf8_handle = 0;
     cd->decoder.init_handle = 0;
     cd->decoder.destroy_handle = 0;
 
@@ -117,6 +119,8 @@ yaz_iconv_t yaz_iconv_open(const char *tocode, const char *fromcode)
     {
         prepare_encoders(cd, tocode);
         prepare_decoders(cd, fromcode);
+        if (!cd->encoder.utf8)
+            cd->decoder.bulk_utf8_handle = 0;
     }
     if (cd->decoder.read_handle && cd->encoder.write_handle)
     {
@@ -239,6 +243,11 @@ size_t yaz_iconv(yaz_iconv_t cd, char **inbuf, size_t *inbytesleft,
         }
         else
         {
+            if (cd->decoder.bulk_utf8_handle && *inbytesleft)
+                (*cd->decoder.bulk_utf8_handle)(
+                    cd, &cd->decoder,
+                    (unsigned char **) inbuf, inbytesleft,
+                    outbuf, outbytesleft);
             if (*inbytesleft == 0)
             {
                 r = *inbuf - inbuf0;
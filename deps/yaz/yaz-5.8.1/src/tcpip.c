@@ -127,6 +127,7 @@ typedef struct tcpip_state
     int written;  /* -1 if we aren't writing */
     int towrite;  /* to verify against user input */
     int (*complete)(const char *buf, int len); /* length/complete. */
+    struct cs_complete_state complete_state; /* for cs_complete_auto */
 #if HAVE_GETADDRINFO
     struct addrinfo *ai;
     struct addrinfo *ai_connect;
@@ -182,6 +183,7 @@ static struct tcpip_state *tcpip_state_create(void)
     sp->altsize = sp->altlen = 0;
     sp->towrite = sp->written = -1;
     sp->complete = cs_complete_auto;
+    cs_complete_reset(&sp->complete_state);
 
 #if HAVE_GETADDRINFO
     sp->ai = 0;
@@ -627,13 +629,6 @@ void *tcpip_straddr(COMSTACK h, const char *str)
 }
 #endif
 
-int tcpip_more(COMSTACK h)
-{
-    tcpip_state *sp = (tcpip_state *)h->cprivate;
-
-    return sp->altlen && (*sp->complete)(sp->altbuf, sp->altlen);
-}
-
 static int cont_connect(COMSTACK h)
 {
 #if HAVE_GETADDRINFO
@@ -1064,6 +1059,46 @@ COMSTACK tcpip_accept(COMSTACK h)
 
 #define CS_TCPIP_BUFCHUNK 4096
 
+/* checks buf for a complete PDU. cs_complete_auto resumes where the
+   previous call for the same PDU stopped rather than starting over */
+static int tcpip_complete(tcpip_state *sp, const char *buf, int len)
+{
+    if (sp->complete == cs_complete_auto)
+        return cs_complete_auto_r(&sp->complete_state, buf, len);
+    return (*sp->complete)(buf, len);
+}
+
+/* keeps an incomplete PDU for the next get: the buffers are swapped
+   rather than copied, so a PDU arriving in many reads is not copied
+   once for each */
+static void tcpip_keep_partial(tcpip_state *sp, char **buf, int *bufsize,
+                               int hasread)
+{
+    char *tmpc = sp->altbuf;
+    int tmpi = sp->altsize;
+
+    sp->altbuf = *buf;
+    sp->altsize = *bufsize;
+    sp->altlen = hasread;
+    *buf = tmpc;
+    *bufsize = tmpi;
+}
+
+/* the state in altbuf is that of its PDU so far: a partial PDU left by
+   tcpip_keep_partial, or the start of surplus data with a fresh state */
+int tcpip_more(COMSTACK h)
+{
+    tcpip_state *sp = (tcpip_state *)h->cprivate;
+    int berlen;
+
+    if (!sp->altlen)
+        return 0;
+    berlen = tcpip_complete(sp, sp->altbuf, sp->altlen);
+    if (berlen) /* the state is past the PDU now; tcpip_get scans it anew */
+        cs_complete_reset(&sp->complete_state);
+    return berlen;
+}
+
 /*
  * Return: -1 error, >1 good, len of buffer, ==1 incomplete buffer,
  * 0=connection closed.
@@ -1089,8 +1124,10 @@ int tcpip_get(COMSTACK h, char **buf, int *bufsize)
         sp->altbuf = tmpc;
         sp->altsize = tmpi;
     }
+    if (!hasread)
+        cs_complete_reset(&sp->complete_state);
     h->io_pending = 0;
-    while (!(berlen = (*sp->complete)(*buf, hasread)))
+    while (!(berlen = tcpip_complete(sp, *buf, hasread)))
     {
         if (!*bufsize)
         {
@@ -1164,7 +1201,14 @@ int tcpip_get(COMSTACK h, char **buf, int *bufsize)
     }
     TRC(fprintf(stderr, "  Out of read loop with hasread=%d, berlen=%d\n",
                 hasread, berlen));
-    /* move surplus buffer (or everything if we didn't get a BER rec.) */
+    if (!berlen)
+    {
+        if (hasread)
+            tcpip_keep_partial(sp, buf, bufsize, hasread);
+        return 1;
+    }
+    cs_complete_reset(&sp->complete_state);
+    /* move surplus buffer */
     if (hasread > berlen)
     {
         tomove = req = hasread - berlen;
@@ -1190,7 +1234,7 @@ int tcpip_get(COMSTACK h, char **buf, int *bufsize)
     }
     if (berlen < CS_TCPIP_BUFCHUNK - 1)
         *(*buf + berlen) = '\0';
-    return berlen ? berlen : 1;
+    return berlen;
 }
 
 
@@ -1220,8 +1264,10 @@ int ssl_get(COMSTACK h, char **buf, int *bufsize)
         sp->altbuf = tmpc;
         sp->altsize = tmpi;
     }
+    if (!hasread)
+        cs_complete_reset(&sp->complete_state);
     h->io_pending = 0;
-    while (!(berlen = (*sp->complete)(*buf, hasread)))
+    while (!(berlen = tcpip_complete(sp, *buf, hasread)))
     {
         if (!*bufsize)
         {
@@ -1248,7 +1294,14 @@ int ssl_get(COMSTACK h, char **buf, int *bufsize)
     }
     TRC (fprintf (stderr, "  Out of read loop with hasread=%d, berlen=%d\n",
         hasread, berlen));
-    /* move surplus buffer (or everything if we didn't get a BER rec.) */
+    if (!berlen)
+    {
+        if (hasread)
+            tcpip_keep_partial(sp, buf, bufsize, hasread);
+        return 1;
+    }
+    cs_complete_reset(&sp->complete_state);
+    /* move surplus buffer */
     if (hasread > berlen)
     {
         tomove = req = hasread - berlen;
@@ -1268,7 +1321,7 @@ int ssl_get(COMSTACK h, char **buf, int *bufsize)
     }
     if (berlen < CS_TCPIP_BUFCHUNK - 1)
         *(*buf + berlen) = '\0';
-    return berlen ? berlen : 1;
+    return berlen;
 }
 #endif
 
@@ -1683,6 +1736,18 @@ int cs_set_ssl_certificate_file(COMSTACK cs, const char *fname)
     return 0;
 }
 
+/* data received but not returned by cs_get yet; for an incomplete
+   package this is what arrived of it so far */
+int cs_get_partial(COMSTACK cs, const char **buf)
+{
+    struct tcpip_state *sp = (struct tcpip_state *) cs->cprivate;
+
+    if (cs->type != tcpip_type && cs->type != ssl_type)
+        return 0;
+    *buf = sp->altbuf;
+    return sp->altlen;
+}
+
 int cs_get_peer_certificate_x509(COMSTACK cs, char **buf, int *len)
 {
 
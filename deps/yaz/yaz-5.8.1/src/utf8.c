@@ -223,6 +223,7 @@ yaz_iconv_encoder_t yaz_utf8_encoder(const char *tocode,
     if (!yaz_matchstr(tocode, "UTF8"))
     {
         e->write_handle = write_UTF8;
+        e->utf8 = 1;
         return e;
     }
     return 0;
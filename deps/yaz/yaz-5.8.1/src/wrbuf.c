@@ -17,6 +17,12 @@
 #include <string.h>
 #include <stdarg.h>
 #include <assert.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WRBUF_SSE2 1
+#endif
 
 #include <yaz/wrbuf.h>
 #include <yaz/snprintf.h>
@@ -118,6 +124,110 @@ void wrbuf_chop_right(WRBUF b)
     }
 }
 
+/* characters that wrbuf_xmlputs_n and wrbuf_json_write do not copy as is:
+   bit 1: XML (all ASCII CTRL and <>&"'), bit 2: JSON (CTRL but NUL, "\\) */
+#define ESC_XML 1
+#define ESC_JSON 2
+
+static const unsigned char esc_class[256] = {
+    1, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    0, 0, 3, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    /* 128-255: UTF-8 and other 8-bit data is copied as is */
+};
+
+#if defined(__AVX2__) || WRBUF_SSE2
+static int first_bit(unsigned m)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(m);
+#else
+    int i = 0;
+    while (!(m & 1))
+    {
+        m >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+#endif
+
+/* length of the prefix of cp that needs no escaping for class esc.
+   Scans 32 (AVX2) or 16 (SSE2) bytes at a time where available */
+static size_t esc_span(const char *cp, size_t sz, int esc)
+{
+    const unsigned char *p = (const unsigned char *) cp;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i ctrl = _mm256_set1_epi8(0x1f);
+    const __m256i quot = _mm256_set1_epi8('"');
+    for (; i + 32 <= sz; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+        /* c <= 0x1f: max(c, 0x1f) == 0x1f */
+        __m256i m = _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl);
+        unsigned bits;
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, quot));
+        if (esc == ESC_JSON)
+        {
+            m = _mm256_andnot_si256(
+                _mm256_cmpeq_epi8(v, _mm256_setzero_si256()), m);
+            m = _mm256_or_si256(
+                m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        }
+        else
+        {
+            m = _mm256_or_si256(
+                m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+            m = _mm256_or_si256(
+                m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+            m = _mm256_or_si256(
+                m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&')));
+            m = _mm256_or_si256(
+                m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')));
+        }
+        bits = (unsigned) _mm256_movemask_epi8(m);
+        if (bits)
+            return i + first_bit(bits);
+    }
+#elif WRBUF_SSE2
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    const __m128i quot = _mm_set1_epi8('"');
+    for (; i + 16 <= sz; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+        /* c <= 0x1f: max(c, 0x1f) == 0x1f */
+        __m128i m = _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl);
+        unsigned bits;
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, quot));
+        if (esc == ESC_JSON)
+        {
+            m = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()), m);
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        }
+        else
+        {
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+        }
+        bits = (unsigned) _mm_movemask_epi8(m);
+        if (bits)
+            return i + first_bit(bits);
+    }
+#endif
+    while (i < sz && !(esc_class[p[i]] & esc))
+        i++;
+    return i;
+}
+
 void wrbuf_xmlputs(WRBUF b, const char *cp)
 {
     wrbuf_xmlputs_n(b, cp, strlen(cp));
@@ -125,36 +235,44 @@ void wrbuf_xmlputs(WRBUF b, const char *cp)
 
 void wrbuf_xmlputs_n(WRBUF b, const char *cp, size_t size)
 {
-    for (; size; size--)
+    while (size)
     {
-        /* only TAB,CR,LF of ASCII CTRL are allowed in XML 1.0! */
-        if (*cp >= 0 && *cp <= 31)
-            if (*cp != 9 && *cp != 10 && *cp != 13)
-            {
-                cp++;  /* we silently ignore (delete) these.. */
-                continue;
-            }
+        size_t n = esc_span(cp, size, ESC_XML);
+
+        wrbuf_write(b, cp, n);
+        cp += n;
+        size -= n;
+        if (!size)
+            break;
         switch(*cp)
         {
         case '<':
-            wrbuf_puts(b, "&lt;");
+            wrbuf_write(b, "&lt;", 4);
             break;
         case '>':
-            wrbuf_puts(b, "&gt;");
+            wrbuf_write(b, "&gt;", 4);
             break;
         case '&':
-            wrbuf_puts(b, "&amp;");
+            wrbuf_write(b, "&amp;", 5);
             break;
         case '"':
-            wrbuf_puts(b, "&quot;");
+            wrbuf_write(b, "&quot;", 6);
             break;
         case '\'':
-            wrbuf_puts(b, "&apos;");
+            wrbuf_write(b, "&apos;", 6);
             break;
-        default:
+        case 9:
+        case 10:
+        case 13:
             wrbuf_putc(b, *cp);
+            break;
+        default:
+            /* only TAB,CR,LF of ASCII CTRL are allowed in XML 1.0!
+               we silently ignore (delete) the rest */
+            break;
         }
         cp++;
+        size--;
     }
 }
 
@@ -301,37 +419,32 @@ void wrbuf_write_escaped(WRBUF b, const char *str, size_t len)
 
 void wrbuf_json_write(WRBUF b, const char *cp, size_t sz)
 {
-    size_t i;
-    for (i = 0; i < sz; i++)
+    while (sz)
     {
-        if (cp[i] > 0 && cp[i] < 32)
-        {
-            wrbuf_putc(b, '\\');
-            switch (cp[i])
-            {
-            case '\b': wrbuf_putc(b, 'b'); break;
-            case '\f': wrbuf_putc(b, 'f'); break;
-            case '\n': wrbuf_putc(b, 'n'); break;
-            case '\r': wrbuf_putc(b, 'r'); break;
-            case '\t': wrbuf_putc(b, 't'); break;
-            default:
-                wrbuf_printf(b, "u%04x", cp[i]);
-            }
-        }
-        else if (cp[i] == '"')
-        {
-            wrbuf_putc(b, '\\'); wrbuf_putc(b, '"');
-        }
-        else if (cp[i] == '\\')
+        size_t n = esc_span(cp, sz, ESC_JSON);
+
+        /* leave encoding as raw UTF-8 */
+        wrbuf_write(b, cp, n);
+        cp += n;
+        sz -= n;
+        if (!sz)
+            break;
+        wrbuf_putc(b, '\\');
+        switch (*cp)
         {
-            wrbuf_putc(b, '\\'); wrbuf_putc(b, '\\');
-        }
-        else
-        {   /* leave encoding as raw UTF-8 */
-            wrbuf_putc(b, cp[i]);
+        case '"': wrbuf_putc(b, '"'); break;
+        case '\\': wrbuf_putc(b, '\\'); break;
+        case '\b': wrbuf_putc(b, 'b'); break;
+        case '\f': wrbuf_putc(b, 'f'); break;
+        case '\n': wrbuf_putc(b, 'n'); break;
+        case '\r': wrbuf_putc(b, 'r'); break;
+        case '\t': wrbuf_putc(b, 't'); break;
+        default:
+            wrbuf_printf(b, "u%04x", *cp);
         }
+        cp++;
+        sz--;
     }
-
 }
 
 void wrbuf_json_puts(WRBUF b, const char *str)
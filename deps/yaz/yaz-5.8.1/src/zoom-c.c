@@ -170,6 +170,12 @@ ZOOM_API(int) ZOOM_connection_is_idle(ZOOM_connection c)
     return c->tasks ? 0 : 1;
 }
 
+ZOOM_API(void) ZOOM_connection_release_resultsets(ZOOM_connection c)
+{
+    while (c->resultsets)
+        ZOOM_resultset_release(c->resultsets);
+}
+
 ZOOM_task ZOOM_connection_insert_task(ZOOM_connection c, int which)
 {
     ZOOM_task task = (ZOOM_task) xmalloc(sizeof(*task));
@@ -188,6 +194,9 @@ void ZOOM_connection_remove_task(ZOOM_connection c)
 
     if (task)
     {
+        /* responses still due would be taken for those of later tasks */
+        if (c->num_presents)
+            ZOOM_connection_close(c);
         c->tasks = task->next;
         switch (task->which)
         {
@@ -281,9 +290,16 @@ ZOOM_API(ZOOM_connection)
 
     c->maximum_record_size = 0;
     c->preferred_message_size = 0;
+    c->message_size = 0;
 
     c->odr_in = odr_createmem(ODR_DECODE);
     c->odr_out = odr_createmem(ODR_ENCODE);
+    c->stream_records = c->stream_pos = c->stream_end = 0;
+    c->stream_start = 0;
+    c->pipeline = c->concurrent_ops = 0;
+    c->write_pending = 0;
+    c->present_refid = c->num_presents = 0;
+    c->request_time = c->response_time = 0.0;
     c->odr_print = 0;
     c->odr_save = 0;
 
@@ -324,7 +340,7 @@ char **ZOOM_connection_get_databases(ZOOM_connection con, ZOOM_options options,
                                      int *num, ODR odr)
 {
     char **databaseNames;
-    const char *cp = ZOOM_options_get(options, "databaseName");
+    const char *cp = ZOOM_options_getk(options, ZOOM_OPT(databaseName), 0);
 
     if ((!cp || !*cp) && con->host_port)
         cs_get_host_args(con->host_port, &cp);
@@ -528,7 +544,11 @@ ZOOM_API(void)
     c->preferred_message_size =
         ZOOM_options_get_int(c->options, "preferredMessageSize", 64*1024*1024);
 
-    c->async = ZOOM_options_get_bool(c->options, "async", 0);
+    c->async = ZOOM_options_get_boolk(c->options, ZOOM_OPT(async), 0);
+
+    c->pipeline = ZOOM_options_get_int(c->options, "pipeline", 0);
+    if (c->pipeline > ZOOM_PIPELINE_MAX)
+        c->pipeline = ZOOM_PIPELINE_MAX;
 
     yaz_cookies_destroy(c->cookies);
     c->cookies = yaz_cookies_create();
@@ -602,6 +622,11 @@ ZOOM_API(void) ZOOM_resultset_release(ZOOM_resultset r)
     }
 }
 
+ZOOM_API(int) ZOOM_resultset_is_released(ZOOM_resultset r)
+{
+    return r->connection ? 0 : 1;
+}
+
 ZOOM_API(void)
     ZOOM_connection_destroy(ZOOM_connection c)
 {
@@ -647,7 +672,8 @@ ZOOM_API(void)
     xfree(c);
 }
 
-void ZOOM_resultset_addref(ZOOM_resultset r)
+ZOOM_API(void)
+    ZOOM_resultset_addref(ZOOM_resultset r)
 {
     if (r)
     {
@@ -659,6 +685,23 @@ void ZOOM_resultset_addref(ZOOM_resultset r)
     }
 }
 
+/* If "presentChunk" is defined use that; otherwise "step" */
+static void resultset_set_step(ZOOM_resultset r)
+{
+    const char *cp = ZOOM_options_getk(r->options, ZOOM_OPT(presentChunk), 0);
+
+    r->step = ZOOM_options_get_intk(r->options,
+                                    (cp != 0 ? ZOOM_OPT(presentChunk) :
+                                     ZOOM_OPT(step)), 0);
+    r->step_auto = 0;
+    if (cp && !strcmp(cp, "auto"))
+    {
+        r->step_auto = 1;
+        r->step = ZOOM_PRESENT_CHUNK_AUTO;
+        ZOOM_options_set_int(r->options, "presentChunkSize", r->step);
+    }
+}
+
 static int g_resultsets = 0;
 static YAZ_MUTEX g_resultset_mutex = 0;
 
@@ -694,6 +737,8 @@ ZOOM_resultset ZOOM_resultset_create(void)
     r->piggyback = 1;
     r->setname = 0;
     r->step = 0;
+    r->step_auto = 0;
+    r->present_rtt = r->present_rate = r->record_bytes = 0.0;
     for (i = 0; i<RECORD_HASH_SIZE; i++)
         r->record_hash[i] = 0;
     r->r_sort_spec = 0;
@@ -746,19 +791,14 @@ ZOOM_API(ZOOM_resultset)
 
     r->options = ZOOM_options_create_with_parent(c->options);
 
-    r->req_facets = odr_strdup_null(r->odr,
-                                    ZOOM_options_get(r->options, "facets"));
-    start = ZOOM_options_get_int(r->options, "start", 0);
-    count = ZOOM_options_get_int(r->options, "count", 0);
-    {
-        /* If "presentChunk" is defined use that; otherwise "step" */
-        const char *cp = ZOOM_options_get(r->options, "presentChunk");
-        r->step = ZOOM_options_get_int(r->options,
-                                       (cp != 0 ? "presentChunk": "step"), 0);
-    }
-    r->piggyback = ZOOM_options_get_bool(r->options, "piggyback", 1);
-    r->setname = odr_strdup_null(r->odr,
-                                 ZOOM_options_get(r->options, "setname"));
+    r->req_facets = odr_strdup_null(
+        r->odr, ZOOM_options_getk(r->options, ZOOM_OPT(facets), 0));
+    start = ZOOM_options_get_intk(r->options, ZOOM_OPT(start), 0);
+    count = ZOOM_options_get_intk(r->options, ZOOM_OPT(count), 0);
+    resultset_set_step(r);
+    r->piggyback = ZOOM_options_get_boolk(r->options, ZOOM_OPT(piggyback), 1);
+    r->setname = odr_strdup_null(
+        r->odr, ZOOM_options_getk(r->options, ZOOM_OPT(setname), 0));
     r->databaseNames = ZOOM_connection_get_databases(c, c->options,
                                                      &r->num_databaseNames,
                                                      r->odr);
@@ -787,12 +827,14 @@ ZOOM_API(ZOOM_resultset)
     task->u.search.start = start;
     task->u.search.count = count;
 
-    syntax = ZOOM_options_get(r->options, "preferredRecordSyntax");
+    syntax = ZOOM_options_getk(r->options, ZOOM_OPT(preferredRecordSyntax),
+                               0);
     task->u.search.syntax = syntax ? xstrdup(syntax) : 0;
-    elementSetName = ZOOM_options_get(r->options, "elementSetName");
+    elementSetName = ZOOM_options_getk(r->options, ZOOM_OPT(elementSetName),
+                                       0);
     task->u.search.elementSetName = elementSetName ?
         xstrdup(elementSetName) : 0;
-    schema = ZOOM_options_get(r->options, "schema");
+    schema = ZOOM_options_getk(r->options, ZOOM_OPT(schema), 0);
     task->u.search.schema = schema ? xstrdup(schema) : 0;
 
     ZOOM_resultset_addref(r);
@@ -954,13 +996,15 @@ static void ZOOM_resultset_retrieve(ZOOM_resultset r,
     task->u.search.start = start;
     task->u.search.count = count;
 
-    syntax = ZOOM_options_get(r->options, "preferredRecordSyntax");
+    syntax = ZOOM_options_getk(r->options, ZOOM_OPT(preferredRecordSyntax),
+                               0);
     task->u.search.syntax = syntax ? xstrdup(syntax) : 0;
-    elementSetName = ZOOM_options_get(r->options, "elementSetName");
+    elementSetName = ZOOM_options_getk(r->options, ZOOM_OPT(elementSetName),
+                                       0);
     task->u.search.elementSetName = elementSetName
         ? xstrdup(elementSetName) : 0;
 
-    cp = ZOOM_options_get(r->options, "schema");
+    cp = ZOOM_options_getk(r->options, ZOOM_OPT(schema), 0);
     task->u.search.schema = cp ? xstrdup(cp) : 0;
 
     ZOOM_resultset_addref(r);
@@ -1141,11 +1185,11 @@ ZOOM_API(ZOOM_record)
     ZOOM_resultset_record_immediate(ZOOM_resultset s,size_t pos)
 {
     const char *syntax =
-        ZOOM_options_get(s->options, "preferredRecordSyntax");
+        ZOOM_options_getk(s->options, ZOOM_OPT(preferredRecordSyntax), 0);
     const char *elementSetName =
-        ZOOM_options_get(s->options, "elementSetName");
+        ZOOM_options_getk(s->options, ZOOM_OPT(elementSetName), 0);
     const char *schema =
-        ZOOM_options_get(s->options, "schema");
+        ZOOM_options_getk(s->options, ZOOM_OPT(schema), 0);
 
     return ZOOM_record_cache_lookup_i(s, pos, syntax, elementSetName, schema);
 }
@@ -1642,6 +1686,7 @@ static void handle_http(ZOOM_connection c, Z_HTTP_Response *hres)
 }
 #endif
 
+/* returns 1 if another complete PDU is already buffered */
 static int do_read(ZOOM_connection c)
 {
     int r, more;
@@ -1654,7 +1699,14 @@ static int do_read(ZOOM_connection c)
     more = cs_more(c->cs);
     yaz_log(c->log_details, "%p do_read len=%d more=%d", c, r, more);
     if (r == 1)
+    {
+        const char *buf;
+        int len = cs_get_partial(c->cs, &buf);
+
+        if (len > 0 && c->proto == PROTO_Z3950)
+            ZOOM_handle_Z3950_partial(c, buf, len);
         return 0;
+    }
     if (r <= 0)
     {
         if (!ZOOM_test_reconnect(c))
@@ -1711,7 +1763,8 @@ static int do_read(ZOOM_connection c)
             }
         }
     }
-    return 1;
+    c->stream_records = c->stream_pos = c->stream_end = 0;
+    return r > 0 && more;
 }
 
 static zoom_ret do_write_ex(ZOOM_connection c, char *buf_out, int len_out)
@@ -1745,12 +1798,14 @@ static zoom_ret do_write_ex(ZOOM_connection c, char *buf_out, int len_out)
         if (c->cs->io_pending & CS_WANT_READ)
             mask += ZOOM_SELECT_READ;
         ZOOM_connection_set_mask(c, mask);
+        c->write_pending = 1;
         yaz_log(c->log_details, "%p do_write_ex write incomplete mask=%d",
                 c, c->mask);
     }
     else
     {
         ZOOM_connection_set_mask(c, ZOOM_SELECT_READ|ZOOM_SELECT_EXCEPT);
+        c->write_pending = 0;
         yaz_log(c->log_details, "%p do_write_ex write complete mask=%d",
                 c, c->mask);
     }
@@ -1825,6 +1880,13 @@ ZOOM_API(void)
     ZOOM_options_setl(c->options, key, val, len);
 }
 
+ZOOM_API(void)
+    ZOOM_connection_set_options_parent(ZOOM_connection c,
+                                       ZOOM_options parent)
+{
+    ZOOM_options_set_parent(c->options, parent);
+}
+
 ZOOM_API(const char *)
     ZOOM_resultset_option_get(ZOOM_resultset r, const char *key)
 {
@@ -1836,6 +1898,9 @@ ZOOM_API(void)
                               const char *val)
 {
     ZOOM_options_set(r->options, key, val);
+    /* chunks of later retrievals */
+    if (!strcmp(key, "presentChunk") || !strcmp(key, "step"))
+        resultset_set_step(r);
 }
 
 
@@ -2021,7 +2086,13 @@ static void ZOOM_connection_do_io(ZOOM_connection c, int mask)
             return;
         }
         if (mask & ZOOM_SELECT_READ)
-            do_read(c);
+        {
+            COMSTACK cs = c->cs;
+
+            /* pipelined responses may arrive in one read */
+            while (do_read(c) && c->cs == cs)
+                ;
+        }
         if (c->cs && (mask & ZOOM_SELECT_WRITE))
             ZOOM_send_buf(c);
     }
@@ -2120,7 +2191,7 @@ ZOOM_API(int) ZOOM_connection_get_mask(ZOOM_connection c)
 
 ZOOM_API(int) ZOOM_connection_get_timeout(ZOOM_connection c)
 {
-    return ZOOM_options_get_int(c->options, "timeout", 30);
+    return ZOOM_options_get_intk(c->options, ZOOM_OPT(timeout), 30);
 }
 
 ZOOM_API(void) ZOOM_connection_close(ZOOM_connection c)
@@ -2130,6 +2201,8 @@ ZOOM_API(void) ZOOM_connection_close(ZOOM_connection c)
     c->cs = 0;
     ZOOM_connection_set_mask(c, 0);
     c->state = STATE_IDLE;
+    c->write_pending = 0;
+    ZOOM_Z3950_reset_presents(c);
 }
 
 /*
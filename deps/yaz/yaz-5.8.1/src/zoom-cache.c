@@ -0,0 +1,265 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+/**
+ * \file zoom-cache.c
+ * \brief Implements in-process cache shared by all ZOOM connections
+ *
+ * Entries are opaque buffers (BER encoded records and hit counts) looked
+ * up by the same keys as used for memcached. Least recently used entries
+ * are evicted when the total size exceeds the configured limit.
+ */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <time.h>
+#include "zoom-p.h"
+
+#include <yaz/xmalloc.h>
+#include <yaz/mutex.h>
+#include <yaz/log.h>
+
+struct zoom_cache_entry {
+    unsigned hash;
+    char *key;
+    size_t key_len;
+    char *buf;
+    size_t len;
+    time_t expire;  /* 0 if entry does not expire */
+    struct zoom_cache_entry *hash_next;
+    struct zoom_cache_entry *lru_prev;  /* more recently used */
+    struct zoom_cache_entry *lru_next;  /* less recently used */
+};
+
+static YAZ_MUTEX cache_mutex = 0;
+static struct zoom_cache_entry **cache_hash = 0;
+static size_t cache_hash_size = 0;
+static struct zoom_cache_entry *cache_lru_head = 0;
+static struct zoom_cache_entry *cache_lru_tail = 0;
+static size_t cache_entries = 0;
+static size_t cache_bytes = 0;
+static size_t cache_max_bytes = 0;
+static int cache_search_ttl = 600;
+static size_t cache_hits = 0;
+static size_t cache_misses = 0;
+
+static unsigned cache_hash_key(const char *key, size_t len)
+{
+    unsigned h = 2166136261U; /* FNV-1a */
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        h ^= (unsigned char) key[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static size_t entry_size(struct zoom_cache_entry *e)
+{
+    return sizeof(*e) + e->key_len + e->len;
+}
+
+static void lru_unlink(struct zoom_cache_entry *e)
+{
+    if (e->lru_prev)
+        e->lru_prev->lru_next = e->lru_next;
+    else
+        cache_lru_head = e->lru_next;
+    if (e->lru_next)
+        e->lru_next->lru_prev = e->lru_prev;
+    else
+        cache_lru_tail = e->lru_prev;
+}
+
+static void lru_push(struct zoom_cache_entry *e)
+{
+    e->lru_prev = 0;
+    e->lru_next = cache_lru_head;
+    if (cache_lru_head)
+        cache_lru_head->lru_prev = e;
+    else
+        cache_lru_tail = e;
+    cache_lru_head = e;
+}
+
+static void entry_remove(struct zoom_cache_entry *e)
+{
+    struct zoom_cache_entry **ep = &cache_hash[e->hash % cache_hash_size];
+
+    while (*ep != e)
+        ep = &(*ep)->hash_next;
+    *ep = e->hash_next;
+    lru_unlink(e);
+    cache_entries--;
+    cache_bytes -= entry_size(e);
+    xfree(e);
+}
+
+static void cache_grow(void)
+{
+    size_t i, new_size = cache_hash_size ? 2 * cache_hash_size : 1024;
+    struct zoom_cache_entry **new_hash = (struct zoom_cache_entry **)
+        xmalloc(new_size * sizeof(*new_hash));
+
+    for (i = 0; i < new_size; i++)
+        new_hash[i] = 0;
+    for (i = 0; i < cache_hash_size; i++)
+    {
+        struct zoom_cache_entry *e = cache_hash[i];
+        while (e)
+        {
+            struct zoom_cache_entry *e_next = e->hash_next;
+            e->hash_next = new_hash[e->hash % new_size];
+            new_hash[e->hash % new_size] = e;
+            e = e_next;
+        }
+    }
+    xfree(cache_hash);
+    cache_hash = new_hash;
+    cache_hash_size = new_size;
+}
+
+static void cache_evict(size_t max_bytes)
+{
+    while (cache_lru_tail && cache_bytes > max_bytes)
+        entry_remove(cache_lru_tail);
+}
+
+static struct zoom_cache_entry *cache_find(const char *key, size_t key_len,
+                                           unsigned h)
+{
+    struct zoom_cache_entry *e;
+
+    if (!cache_hash_size)
+        return 0;
+    for (e = cache_hash[h % cache_hash_size]; e; e = e->hash_next)
+        if (e->hash == h && e->key_len == key_len
+            && !memcmp(e->key, key, key_len))
+            return e;
+    return 0;
+}
+
+ZOOM_API(void)
+    ZOOM_cache_configure(size_t max_bytes)
+{
+    if (cache_mutex == 0)
+        yaz_mutex_create(&cache_mutex);
+    yaz_mutex_enter(cache_mutex);
+    cache_max_bytes = max_bytes;
+    cache_evict(max_bytes);
+    yaz_mutex_leave(cache_mutex);
+}
+
+ZOOM_API(void)
+    ZOOM_cache_stat(size_t *entries, size_t *bytes,
+                    size_t *hits, size_t *misses)
+{
+    if (cache_mutex == 0)
+        yaz_mutex_create(&cache_mutex);
+    yaz_mutex_enter(cache_mutex);
+    if (entries)
+        *entries = cache_entries;
+    if (bytes)
+        *bytes = cache_bytes;
+    if (hits)
+        *hits = cache_hits;
+    if (misses)
+        *misses = cache_misses;
+    yaz_mutex_leave(cache_mutex);
+}
+
+ZOOM_API(void)
+    ZOOM_cache_configure_search(int ttl)
+{
+    cache_search_ttl = ttl > 0 ? ttl : 0;
+}
+
+int ZOOM_cache_enabled(void)
+{
+    return cache_max_bytes != 0;
+}
+
+int ZOOM_cache_search_ttl(void)
+{
+    return cache_max_bytes != 0 ? cache_search_ttl : 0;
+}
+
+void ZOOM_cache_put(const char *key, size_t key_len,
+                    const char *buf, size_t len, int ttl)
+{
+    struct zoom_cache_entry *e;
+    unsigned h = cache_hash_key(key, key_len);
+
+    if (!cache_mutex)
+        return;
+    yaz_mutex_enter(cache_mutex);
+    if ((e = cache_find(key, key_len, h)))
+        entry_remove(e);
+    if (sizeof(*e) + key_len + len <= cache_max_bytes)
+    {
+        e = (struct zoom_cache_entry *)
+            xmalloc(sizeof(*e) + key_len + len);
+        e->hash = h;
+        e->key = (char *) (e + 1);
+        e->key_len = key_len;
+        memcpy(e->key, key, key_len);
+        e->buf = e->key + key_len;
+        e->len = len;
+        memcpy(e->buf, buf, len);
+        e->expire = ttl > 0 ? time(0) + ttl : 0;
+
+        cache_evict(cache_max_bytes - entry_size(e));
+        if (cache_entries >= cache_hash_size)
+            cache_grow();
+        e->hash_next = cache_hash[h % cache_hash_size];
+        cache_hash[h % cache_hash_size] = e;
+        lru_push(e);
+        cache_entries++;
+        cache_bytes += entry_size(e);
+    }
+    yaz_mutex_leave(cache_mutex);
+}
+
+char *ZOOM_cache_get(ODR odr, const char *key, size_t key_len, int *len)
+{
+    struct zoom_cache_entry *e;
+    unsigned h = cache_hash_key(key, key_len);
+    char *buf = 0;
+
+    if (!cache_mutex)
+        return 0;
+    yaz_mutex_enter(cache_mutex);
+    e = cache_find(key, key_len, h);
+    if (e && e->expire && e->expire <= time(0))
+    {
+        entry_remove(e);
+        e = 0;
+    }
+    if (e)
+    {
+        lru_unlink(e);
+        lru_push(e);
+        buf = (char *) odr_malloc(odr, e->len ? e->len : 1);
+        memcpy(buf, e->buf, e->len);
+        *len = (int) e->len;
+        cache_hits++;
+    }
+    else
+        cache_misses++;
+    yaz_mutex_leave(cache_mutex);
+    return buf;
+}
+
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
@@ -185,32 +185,41 @@ int ZOOM_memcached_configure(ZOOM_connection c)
     return 0;
 }
 
-#if HAVE_GCRYPT_H
 static void wrbuf_vary_puts(WRBUF w, const char *v)
 {
     if (v)
     {
+#if HAVE_GCRYPT_H
         if (strlen(v) > 40)
         {
             wrbuf_sha1_puts(w, v, 1);
         }
         else
+#endif
         {
             wrbuf_puts(w, v);
         }
     }
 }
-#endif
 
 void ZOOM_memcached_resultset(ZOOM_resultset r, ZOOM_query q)
 {
-#if HAVE_GCRYPT_H
     ZOOM_connection c = r->connection;
 
+#if HAVE_GCRYPT_H
+    r->mc_key = wrbuf_alloc();
+#else
+    /* keys are only hashed for memcached and redis; the in-process
+       cache works with plain keys */
+    if (!ZOOM_cache_enabled())
+        return;
     r->mc_key = wrbuf_alloc();
+#endif
     wrbuf_puts(r->mc_key, "1;");
     wrbuf_vary_puts(r->mc_key, c->host_port);
     wrbuf_puts(r->mc_key, ";");
+    wrbuf_vary_puts(r->mc_key, ZOOM_resultset_option_get(r, "databaseName"));
+    wrbuf_puts(r->mc_key, ";");
     wrbuf_vary_puts(r->mc_key, ZOOM_resultset_option_get(r, "extraArgs"));
     wrbuf_puts(r->mc_key, ";");
     wrbuf_vary_puts(r->mc_key, c->user);
@@ -218,17 +227,37 @@ void ZOOM_memcached_resultset(ZOOM_resultset r, ZOOM_query q)
     wrbuf_vary_puts(r->mc_key, c->group);
     wrbuf_puts(r->mc_key, ";");
     if (c->password)
+    {
+#if HAVE_GCRYPT_H
         wrbuf_sha1_puts(r->mc_key, c->password, 1);
+#else
+        wrbuf_puts(r->mc_key, c->password);
+#endif
+    }
     wrbuf_puts(r->mc_key, ";");
     {
         WRBUF w = wrbuf_alloc();
         ZOOM_query_get_hash(q, w);
+#if HAVE_GCRYPT_H
         wrbuf_sha1_puts(r->mc_key, wrbuf_cstr(w), 1);
+#else
+        wrbuf_puts(r->mc_key, wrbuf_cstr(w));
+#endif
         wrbuf_destroy(w);
     }
     wrbuf_puts(r->mc_key, ";");
     wrbuf_vary_puts(r->mc_key, r->req_facets);
-#endif
+}
+
+static void record_key(WRBUF k, ZOOM_resultset r, int pos,
+                       const char *syntax, const char *elementSetName,
+                       const char *schema)
+{
+    wrbuf_write(k, wrbuf_buf(r->mc_key), wrbuf_len(r->mc_key));
+    wrbuf_printf(k, ";%d;%s;%s;%s", pos,
+                 syntax ? syntax : "",
+                 elementSetName ? elementSetName : "",
+                 schema ? schema : "");
 }
 
 void ZOOM_memcached_search(ZOOM_connection c, ZOOM_resultset resultset)
@@ -319,6 +348,42 @@ void ZOOM_memcached_search(ZOOM_connection c, ZOOM_resultset resultset)
         }
     }
 #endif
+    if (resultset->mc_key && ZOOM_cache_search_ttl() &&
+        resultset->live_set == 0)
+    {
+        int v_len;
+        char *v = ZOOM_cache_get(resultset->odr,
+                                 wrbuf_buf(resultset->mc_key),
+                                 wrbuf_len(resultset->mc_key), &v_len);
+        /* count;precision (ASCII) + '\0' + BER buffer for otherInformation */
+        if (v)
+        {
+            ZOOM_Event event;
+            const char *precision = strchr(v, ';');
+            int lead_len = strlen(v) + 1;
+
+            resultset->size = odr_atoi(v);
+            if (precision)
+                ZOOM_options_set(resultset->options, "resultCountPrecision",
+                                 precision + 1);
+            if (v_len > lead_len)
+            {
+                Z_OtherInformation *oi = 0;
+                odr_setbuf(resultset->odr, v + lead_len, v_len - lead_len, 0);
+                if (!z_OtherInformation(resultset->odr, &oi, 0, 0))
+                {
+                    yaz_log(YLOG_WARN, "oi decoding failed");
+                    return;
+                }
+                ZOOM_handle_search_result(c, resultset, oi);
+                ZOOM_handle_facet_result(c, resultset, oi);
+            }
+            ZOOM_options_set(resultset->options, "cached", "1");
+            event = ZOOM_Event_create(ZOOM_EVENT_RECV_SEARCH);
+            ZOOM_connection_put_event(c, event);
+            resultset->live_set = 1;
+        }
+    }
 }
 
 #if HAVE_HIREDIS
@@ -423,6 +488,30 @@ void ZOOM_memcached_hitcount(ZOOM_connection c, ZOOM_resultset resultset,
         odr_destroy(odr);
     }
 #endif
+    if (resultset->mc_key && ZOOM_cache_search_ttl() &&
+        resultset->live_set == 0)
+    {
+        ODR odr = odr_createmem(ODR_ENCODE);
+        WRBUF v = wrbuf_alloc();
+
+        /* count;precision (ASCII) + '\0' + BER buffer for otherInformation */
+        wrbuf_printf(v, ODR_INT_PRINTF ";%s", resultset->size, precision);
+        wrbuf_putc(v, '\0');
+        if (oi)
+        {
+            char *oi_buf;
+            int oi_len;
+
+            z_OtherInformation(odr, &oi, 0, 0);
+            oi_buf = odr_getbuf(odr, &oi_len, 0);
+            wrbuf_write(v, oi_buf, oi_len);
+        }
+        ZOOM_cache_put(wrbuf_buf(resultset->mc_key),
+                       wrbuf_len(resultset->mc_key),
+                       wrbuf_buf(v), wrbuf_len(v), ZOOM_cache_search_ttl());
+        wrbuf_destroy(v);
+        odr_destroy(odr);
+    }
 }
 
 void ZOOM_memcached_add(ZOOM_resultset r, Z_NamePlusRecord *npr,
@@ -534,6 +623,24 @@ void ZOOM_memcached_add(ZOOM_resultset r, Z_NamePlusRecord *npr,
         wrbuf_destroy(rec_sha1);
     }
 #endif
+    if (r->mc_key && ZOOM_cache_enabled() &&
+        !diag && npr->which == Z_NamePlusRecord_databaseRecord)
+    {
+        WRBUF k = wrbuf_alloc();
+        ODR odr = odr_createmem(ODR_ENCODE);
+        char *rec_buf;
+        int rec_len;
+
+        z_NamePlusRecord(odr, &npr, 0, 0);
+        rec_buf = odr_getbuf(odr, &rec_len, 0);
+
+        record_key(k, r, pos, syntax, elementSetName, schema);
+        ZOOM_cache_put(wrbuf_buf(k), wrbuf_len(k), rec_buf, rec_len,
+                       ZOOM_cache_search_ttl());
+
+        odr_destroy(odr);
+        wrbuf_destroy(k);
+    }
 }
 
 Z_NamePlusRecord *ZOOM_memcached_lookup(ZOOM_resultset r, int pos,
@@ -640,6 +747,24 @@ Z_NamePlusRecord *ZOOM_memcached_lookup(ZOOM_resultset r, int pos,
         }
     }
 #endif
+    if (r->mc_key && ZOOM_cache_enabled())
+    {
+        WRBUF k = wrbuf_alloc();
+        int v_len;
+        char *v_buf;
+
+        record_key(k, r, pos, syntax, elementSetName, schema);
+        v_buf = ZOOM_cache_get(r->odr, wrbuf_buf(k), wrbuf_len(k), &v_len);
+        wrbuf_destroy(k);
+        if (v_buf)
+        {
+            Z_NamePlusRecord *npr = 0;
+
+            odr_setbuf(r->odr, v_buf, v_len, 0);
+            z_NamePlusRecord(r->odr, &npr, 0, 0);
+            return npr;
+        }
+    }
     return 0;
 
 }
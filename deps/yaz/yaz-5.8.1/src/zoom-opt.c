@@ -11,47 +11,198 @@
 #endif
 
 #include <assert.h>
+#if YAZ_POSIX_THREADS
+#include <pthread.h>
+#endif
 #include "zoom-p.h"
 
 #include <yaz/xmalloc.h>
 
+/* Option names are interned: there is one key per name for the process,
+   so options find an entry by comparing key pointers. The keys of
+   ZOOM_OPTION_NAMES are static; other names get a key when first set
+   or passed to ZOOM_options_key_get.
+
+   The table of names and those keys are never freed, on purpose. Any
+   ZOOM_options, also one destroyed by an exit handler, may hold a key,
+   and callers may keep keys in static variables. The table only grows
+   with the number of distinct names, and stays reachable through
+   `names', so leak checkers do not count it as lost. */
+
+#define ZOOM_OPTION_NAME(n) { #n, 0 },
+struct ZOOM_options_key_p ZOOM_option_keys[] = {
+    ZOOM_OPTION_NAMES
+    { 0, 0 }
+};
+#undef ZOOM_OPTION_NAME
+
+static struct ZOOM_options_key_p **names = 0;  /* open addressing */
+static unsigned names_size = 0;                /* 0 or a power of 2 */
+static unsigned names_num = 0;
+#if YAZ_POSIX_THREADS
+static pthread_mutex_t names_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 struct ZOOM_options_entry {
-    char *name;
+    ZOOM_options_key key;     /* 0 for a free slot */
     char *value;
     int len;                  /* of `value', which may contain NULs */
-    struct ZOOM_options_entry *next;
 };
 
 struct ZOOM_options_p {
     int refcount;
     void *callback_handle;
     ZOOM_options_callback callback_func;
-    struct ZOOM_options_entry *entries;
+    struct ZOOM_options_entry *entries;  /* open addressing, by key */
+    int num_entries;
+    int size;                            /* 0 or a power of 2 */
     ZOOM_options parent1;
     ZOOM_options parent2;
 };
 
-static void set_value(struct ZOOM_options_entry **e,
-                      const char *value, int len)
+static unsigned name_hash(const char *name)
 {
-    (*e)->value = 0;
-    (*e)->len = 0;
-    if (value)
+    unsigned h = 2166136261U;  /* FNV-1a */
+
+    for (; *name; name++)
+        h = (h ^ (unsigned char) *name) * 16777619U;
+    return h;
+}
+
+static void names_insert(struct ZOOM_options_key_p *key)
+{
+    unsigned i = key->hash & (names_size - 1);
+
+    while (names[i])
+        i = (i + 1) & (names_size - 1);
+    names[i] = key;
+    names_num++;
+}
+
+static void names_grow(void)
+{
+    struct ZOOM_options_key_p **old = names;
+    unsigned i, old_size = names_size;
+
+    names_size = old_size ? 2 * old_size : 64;
+    names = (struct ZOOM_options_key_p **)
+        xmalloc(names_size * sizeof(*names));
+    for (i = 0; i < names_size; i++)
+        names[i] = 0;
+    names_num = 0;
+    if (old_size == 0)
     {
-        (*e)->value = (char *) xmalloc(len+1);
-        memcpy((*e)->value, value, len);
-        (*e)->value[len] = '\0';
-        (*e)->len = len;
+        for (i = 0; i < zoom_opt_max; i++)
+        {
+            ZOOM_option_keys[i].hash = name_hash(ZOOM_option_keys[i].name);
+            names_insert(ZOOM_option_keys + i);
+        }
     }
+    for (i = 0; i < old_size; i++)
+        if (old[i])
+            names_insert(old[i]);
+    xfree(old);
 }
 
-static void append_entry(struct ZOOM_options_entry **e,
-                         const char *name, const char *value, int len)
+/* key of name; 0 if name has no key yet and create is 0 */
+static ZOOM_options_key key_lookup(const char *name, int create)
 {
-    *e = (struct ZOOM_options_entry *) xmalloc(sizeof(**e));
-    (*e)->name = xstrdup(name);
-    set_value(e, value, len);
-    (*e)->next = 0;
+    struct ZOOM_options_key_p *key = 0;
+    unsigned h = name_hash(name);
+    unsigned i;
+
+#if YAZ_POSIX_THREADS
+    pthread_mutex_lock(&names_mutex);
+#endif
+    if (!names)
+        names_grow();
+    for (i = h & (names_size - 1); names[i]; i = (i + 1) & (names_size - 1))
+        if (names[i]->hash == h && !strcmp(names[i]->name, name))
+        {
+            key = names[i];
+            break;
+        }
+    if (!key && create)
+    {
+        if (2 * (names_num + 1) > names_size)
+            names_grow();
+        key = (struct ZOOM_options_key_p *) xmalloc(sizeof(*key));
+        key->name = xstrdup(name);
+        key->hash = h;
+        names_insert(key);
+    }
+#if YAZ_POSIX_THREADS
+    pthread_mutex_unlock(&names_mutex);
+#endif
+    return key;
+}
+
+ZOOM_API(ZOOM_options_key)
+    ZOOM_options_key_get(const char *name)
+{
+    return key_lookup(name, 1);
+}
+
+static unsigned key_slot(ZOOM_options_key key, int size)
+{
+    size_t h = (size_t) key / sizeof(*key);
+
+    h *= 2654435761U;
+    return (unsigned) (h ^ (h >> 16)) & (size - 1);
+}
+
+static struct ZOOM_options_entry *find_entry(ZOOM_options opt,
+                                             ZOOM_options_key key)
+{
+    unsigned i;
+
+    if (opt->size == 0)
+        return 0;
+    for (i = key_slot(key, opt->size); opt->entries[i].key;
+         i = (i + 1) & (opt->size - 1))
+        if (opt->entries[i].key == key)
+            return opt->entries + i;
+    return 0;
+}
+
+static struct ZOOM_options_entry *free_entry(ZOOM_options opt,
+                                             ZOOM_options_key key)
+{
+    unsigned i = key_slot(key, opt->size);
+
+    while (opt->entries[i].key)
+        i = (i + 1) & (opt->size - 1);
+    return opt->entries + i;
+}
+
+static void grow_entries(ZOOM_options opt)
+{
+    struct ZOOM_options_entry *old = opt->entries;
+    int i, old_size = opt->size;
+
+    opt->size = old_size ? 2 * old_size : 8;
+    opt->entries = (struct ZOOM_options_entry *)
+        xmalloc(opt->size * sizeof(*opt->entries));
+    for (i = 0; i < opt->size; i++)
+        opt->entries[i].key = 0;
+    for (i = 0; i < old_size; i++)
+        if (old[i].key)
+            *free_entry(opt, old[i].key) = old[i];
+    xfree(old);
+}
+
+static void set_value(struct ZOOM_options_entry *e,
+                      const char *value, int len)
+{
+    e->value = 0;
+    e->len = 0;
+    if (value)
+    {
+        e->value = (char *) xmalloc(len+1);
+        memcpy(e->value, value, len);
+        e->value[len] = '\0';
+        e->len = len;
+    }
 }
 
 ZOOM_API(ZOOM_options)
@@ -62,14 +213,22 @@ ZOOM_API(ZOOM_options)
     else
     {
         ZOOM_options dst = ZOOM_options_create();
-        struct ZOOM_options_entry *src_e = src->entries;
-        struct ZOOM_options_entry **dst_e = &dst->entries;
+        int i;
 
-        while(src_e)
+        if (src->size)
         {
-            append_entry(dst_e, src_e->name, src_e->value, src_e->len);
-            dst_e = &(*dst_e)->next;
-            src_e = src_e->next;
+            dst->size = src->size;
+            dst->num_entries = src->num_entries;
+            dst->entries = (struct ZOOM_options_entry *)
+                xmalloc(dst->size * sizeof(*dst->entries));
+            for (i = 0; i < dst->size; i++)
+            {
+                struct ZOOM_options_entry *e = src->entries + i;
+
+                dst->entries[i].key = e->key;
+                if (e->key)
+                    set_value(dst->entries + i, e->value, e->len);
+            }
         }
         dst->parent1 = ZOOM_options_dup(src->parent1);
         dst->parent2 = ZOOM_options_dup(src->parent2);
@@ -100,6 +259,8 @@ ZOOM_API(ZOOM_options)
     opt->callback_func = 0;
     opt->callback_handle = 0;
     opt->entries = 0;
+    opt->num_entries = 0;
+    opt->size = 0;
     opt->parent1= parent1;
     if (parent1)
         (parent1->refcount)++;
@@ -115,6 +276,15 @@ void ZOOM_options_addref(ZOOM_options opt)
     (opt->refcount)++;
 }
 
+ZOOM_API(void)
+    ZOOM_options_set_parent(ZOOM_options opt, ZOOM_options parent)
+{
+    if (parent)
+        (parent->refcount)++;
+    ZOOM_options_destroy(opt->parent1);
+    opt->parent1 = parent;
+}
+
 ZOOM_API(ZOOM_options_callback)
     ZOOM_options_set_callback (
     ZOOM_options opt,
@@ -138,42 +308,43 @@ ZOOM_API(void)
     (opt->refcount)--;
     if (opt->refcount == 0)
     {
-        struct ZOOM_options_entry *e;
+        int i;
 
         ZOOM_options_destroy(opt->parent1);
         ZOOM_options_destroy(opt->parent2);
-        e = opt->entries;
-        while (e)
-        {
-            struct ZOOM_options_entry *e0 = e;
-            xfree(e->name);
-            xfree(e->value);
-            e = e->next;
-            xfree(e0);
-        }
+        for (i = 0; i < opt->size; i++)
+            if (opt->entries[i].key)
+                xfree(opt->entries[i].value);
+        xfree(opt->entries);
         xfree(opt);
     }
 }
 
 
 ZOOM_API(void)
-    ZOOM_options_setl(ZOOM_options opt, const char *name, const char *value,
-                      int len)
+    ZOOM_options_setk(ZOOM_options opt, ZOOM_options_key key,
+                      const char *value, int len)
 {
-    struct ZOOM_options_entry **e;
+    struct ZOOM_options_entry *e = find_entry(opt, key);
 
-    e = &opt->entries;
-    while (*e)
+    if (e)
+        xfree(e->value);
+    else
     {
-        if (!strcmp((*e)->name, name))
-        {
-            xfree((*e)->value);
-            set_value(e, value, len);
-            return;
-        }
-        e = &(*e)->next;
+        if (2 * (opt->num_entries + 1) > opt->size)
+            grow_entries(opt);
+        e = free_entry(opt, key);
+        e->key = key;
+        opt->num_entries++;
     }
-    append_entry(e, name, value, len);
+    set_value(e, value, len);
+}
+
+ZOOM_API(void)
+    ZOOM_options_setl(ZOOM_options opt, const char *name, const char *value,
+                      int len)
+{
+    ZOOM_options_setk(opt, key_lookup(name, 1), value, len);
 }
 
 ZOOM_API(void)
@@ -182,8 +353,9 @@ ZOOM_API(void)
     ZOOM_options_setl(opt, name, value, value ? strlen(value): 0);
 }
 
-ZOOM_API(const char *)
-    ZOOM_options_getl(ZOOM_options opt, const char *name, int *lenp)
+/* key is 0 for a name without key, which only callbacks may know */
+static const char *get_value(ZOOM_options opt, ZOOM_options_key key,
+                             const char *name, int *lenp)
 {
     const char *v = 0;
     if (!opt)
@@ -191,27 +363,40 @@ ZOOM_API(const char *)
     if (opt->callback_func)
     {
         v = (*opt->callback_func)(opt->callback_handle, name);
-        if (v)
+        if (v && lenp)
             *lenp = strlen(v);
     }
-    if (!v)
+    if (!v && key)
     {
-        struct ZOOM_options_entry *e;
-        for (e = opt->entries; e; e = e->next)
-            if (!strcmp(e->name, name))
-            {
-                v = e->value;
+        struct ZOOM_options_entry *e = find_entry(opt, key);
+        if (e)
+        {
+            v = e->value;
+            if (lenp)
                 *lenp = e->len;
-                break;
-            }
+        }
     }
     if (!v)
-        v = ZOOM_options_getl(opt->parent1, name, lenp);
+        v = get_value(opt->parent1, key, name, lenp);
     if (!v)
-        v = ZOOM_options_getl(opt->parent2, name, lenp);
+        v = get_value(opt->parent2, key, name, lenp);
     return v;
 }
 
+ZOOM_API(const char *)
+    ZOOM_options_getk(ZOOM_options opt, ZOOM_options_key key, int *lenp)
+{
+    return get_value(opt, key, key->name, lenp);
+}
+
+ZOOM_API(const char *)
+    ZOOM_options_getl(ZOOM_options opt, const char *name, int *lenp)
+{
+    if (!opt)
+        return 0;
+    return get_value(opt, key_lookup(name, 0), name, lenp);
+}
+
 ZOOM_API(const char *)
     ZOOM_options_get(ZOOM_options opt, const char *name)
 {
@@ -219,11 +404,8 @@ ZOOM_API(const char *)
     return ZOOM_options_getl(opt, name, &dummy);
 }
 
-ZOOM_API(int)
-    ZOOM_options_get_bool(ZOOM_options opt, const char *name, int defa)
+static int get_bool(const char *v, int defa)
 {
-    const char *v = ZOOM_options_get(opt, name);
-
     if (!v)
         return defa;
     if (!strcmp(v, "1") || !strcmp(v, "T"))
@@ -231,16 +413,35 @@ ZOOM_API(int)
     return 0;
 }
 
-ZOOM_API(int)
-    ZOOM_options_get_int(ZOOM_options opt, const char *name, int defa)
+static int get_int(const char *v, int defa)
 {
-    const char *v = ZOOM_options_get(opt, name);
-
     if (!v || !*v)
         return defa;
     return atoi(v);
 }
 
+ZOOM_API(int)
+    ZOOM_options_get_bool(ZOOM_options opt, const char *name, int defa)
+{
+    return get_bool(ZOOM_options_get(opt, name), defa);
+}
+
+ZOOM_API(int)
+    ZOOM_options_get_int(ZOOM_options opt, const char *name, int defa)
+{
+    return get_int(ZOOM_options_get(opt, name), defa);
+}
+
+int ZOOM_options_get_boolk(ZOOM_options opt, ZOOM_options_key key, int defa)
+{
+    return get_bool(ZOOM_options_getk(opt, key, 0), defa);
+}
+
+int ZOOM_options_get_intk(ZOOM_options opt, ZOOM_options_key key, int defa)
+{
+    return get_int(ZOOM_options_getk(opt, key, 0), defa);
+}
+
 ZOOM_API(void)
 ZOOM_options_set_int(ZOOM_options opt, const char *name, int value)
 {
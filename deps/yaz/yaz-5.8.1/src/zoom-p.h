@@ -58,6 +58,20 @@ typedef enum {
 
 typedef struct ZOOM_task_p *ZOOM_task;
 
+#define ZOOM_PIPELINE_MAX 16
+
+/* first chunk of presentChunk=auto and the largest it grows to */
+#define ZOOM_PRESENT_CHUNK_AUTO 10
+#define ZOOM_PRESENT_CHUNK_MAX 1000
+
+/* a present of a pipelined search task */
+struct ZOOM_present_p {
+    int refid;           /* referenceId it was sent with. 0: not sent yet */
+    int start;
+    int count;
+    double sent;         /* time it was sent */
+};
+
 #define STATE_IDLE 0
 #define STATE_CONNECTING 1
 #define STATE_ESTABLISHED 2
@@ -101,6 +115,7 @@ struct ZOOM_connection_p {
 
     int maximum_record_size;
     int preferred_message_size;
+    int message_size;    /* largest response of target, as agreed or seen */
 
     ZOOM_task tasks;
     ZOOM_options options;
@@ -123,6 +138,22 @@ struct ZOOM_connection_p {
 #endif
     int expire_search;
     int expire_record;
+
+    int stream_records;  /* records of incomplete response decoded so far */
+    int stream_pos;      /* offset of next record in incomplete response */
+    int stream_end;      /* end of its records. 0: not located yet,
+                            -1: response not decoded incrementally */
+    int stream_start;    /* position of its first record */
+
+    int pipeline;        /* presents to keep outstanding, "pipeline" option */
+    int concurrent_ops;  /* target agreed to concurrentOperations */
+    int write_pending;   /* buf_out not completely written yet */
+    int present_refid;   /* referenceId of last present sent */
+    int num_presents;
+    struct ZOOM_present_p presents[ZOOM_PIPELINE_MAX];
+
+    double request_time;  /* when the last request was sent */
+    double response_time; /* when the last response was handled */
 };
 
 typedef struct ZOOM_record_cache_p *ZOOM_record_cache;
@@ -135,6 +166,10 @@ struct ZOOM_resultset_p {
     int refcount;
     Odr_int size;
     int step;
+    int step_auto;        /* presentChunk=auto: step follows the target */
+    double present_rtt;   /* shortest round trip seen, seconds */
+    double present_rate;  /* bytes per second of present responses */
+    double record_bytes;  /* average size of a record in those */
     int piggyback;
     char *setname;
     ODR odr;
@@ -225,7 +260,52 @@ typedef enum {
 
 void ZOOM_options_addref (ZOOM_options opt);
 
+/* options read on the connect, search and present paths. Their keys are
+   static, so ZOOM_OPT(name) needs no lookup of the name */
+#define ZOOM_OPTION_NAMES \
+    ZOOM_OPTION_NAME(async) \
+    ZOOM_OPTION_NAME(count) \
+    ZOOM_OPTION_NAME(databaseName) \
+    ZOOM_OPTION_NAME(elementSetName) \
+    ZOOM_OPTION_NAME(extraArgs) \
+    ZOOM_OPTION_NAME(facets) \
+    ZOOM_OPTION_NAME(largeSetLowerBound) \
+    ZOOM_OPTION_NAME(mediumSetElementSetName) \
+    ZOOM_OPTION_NAME(mediumSetPresentNumber) \
+    ZOOM_OPTION_NAME(piggyback) \
+    ZOOM_OPTION_NAME(preferredRecordSyntax) \
+    ZOOM_OPTION_NAME(presentChunk) \
+    ZOOM_OPTION_NAME(recordPacking) \
+    ZOOM_OPTION_NAME(rpnCharset) \
+    ZOOM_OPTION_NAME(schema) \
+    ZOOM_OPTION_NAME(setname) \
+    ZOOM_OPTION_NAME(smallSetElementSetName) \
+    ZOOM_OPTION_NAME(smallSetUpperBound) \
+    ZOOM_OPTION_NAME(start) \
+    ZOOM_OPTION_NAME(step) \
+    ZOOM_OPTION_NAME(timeout)
+
+enum zoom_option {
+#define ZOOM_OPTION_NAME(n) zoom_opt_##n,
+    ZOOM_OPTION_NAMES
+#undef ZOOM_OPTION_NAME
+    zoom_opt_max
+};
+
+struct ZOOM_options_key_p {
+    const char *name;
+    unsigned hash;            /* of name, for the table of names */
+};
+
+extern struct ZOOM_options_key_p ZOOM_option_keys[];
+#define ZOOM_OPT(n) ((ZOOM_options_key) (ZOOM_option_keys + zoom_opt_##n))
+
+int ZOOM_options_get_intk(ZOOM_options opt, ZOOM_options_key key, int defa);
+int ZOOM_options_get_boolk(ZOOM_options opt, ZOOM_options_key key, int defa);
+
 void ZOOM_handle_Z3950_apdu(ZOOM_connection c, Z_APDU *apdu);
+void ZOOM_handle_Z3950_partial(ZOOM_connection c, const char *buf, int len);
+void ZOOM_Z3950_reset_presents(ZOOM_connection c);
 
 void ZOOM_set_dset_error(ZOOM_connection c, int error,
                          const char *dset,
@@ -297,6 +377,12 @@ Z_NamePlusRecord *ZOOM_memcached_lookup(ZOOM_resultset r, int pos,
                                         const char *syntax,
                                         const char *elementSetName,
                                         const char *schema);
+
+int ZOOM_cache_enabled(void);
+int ZOOM_cache_search_ttl(void);
+void ZOOM_cache_put(const char *key, size_t key_len,
+                    const char *buf, size_t len, int ttl);
+char *ZOOM_cache_get(ODR odr, const char *key, size_t key_len, int *len);
 ZOOM_record ZOOM_record_cache_lookup_i(ZOOM_resultset r, int pos,
                                        const char *syntax,
                                        const char *elementSetName,
@@ -13,9 +13,12 @@
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "zoom-p.h"
 
 #include <yaz/yaz-util.h>
+#include <yaz/errno.h>
 #include <yaz/xmalloc.h>
 #include <yaz/log.h>
 #include <yaz/pquery.h>
@@ -41,8 +44,35 @@ struct ZOOM_query_p {
     char *query_string;
     WRBUF full_query;
     WRBUF sru11_sort_spec;
+    ZOOM_prepared prepared;  /* template z_query shares memory with */
+    WRBUF key;               /* for ZOOM_query_get_key */
 };
 
+struct ZOOM_prepared_p {
+    int refcount;
+    YAZ_MUTEX mutex;         /* bound queries on any thread share it */
+    int query_type;
+    char *query_string;      /* with $name placeholders */
+    ODR odr;
+    Z_Query *z_query;        /* parsed PQF template */
+    CQL_parser cql;          /* parsed CQL template */
+    char **params;           /* placeholder names, without '$' */
+    int num_params;
+};
+
+struct ZOOM_cql_transform_p {
+    char *fname;
+    time_t mtime;
+    off_t size;
+    cql_transform_t ct;
+    YAZ_MUTEX mutex;   /* ct keeps error state: one transform at a time */
+    int refcount;
+    ZOOM_cql_transform next;
+};
+
+static YAZ_MUTEX cql_cache_mutex = 0;
+static ZOOM_cql_transform cql_cache = 0;
+
 static int generate(ZOOM_query s)
 {
     if (s->query_string)
@@ -151,18 +181,96 @@ void ZOOM_query_get_hash(ZOOM_query s, WRBUF w)
         yaz_sort_spec_to_type7(s->sort_spec, w);
 }
 
+ZOOM_API(const char *)
+    ZOOM_query_get_key(ZOOM_query s)
+{
+    if (!s->key)
+        s->key = wrbuf_alloc();
+    wrbuf_rewind(s->key);
+    ZOOM_query_get_hash(s, s->key);
+    return wrbuf_cstr(s->key);
+}
+
+static void cql_transform_release(ZOOM_cql_transform t)
+{
+    if (--(t->refcount) == 0)
+    {
+        cql_transform_close(t->ct);
+        yaz_mutex_destroy(&t->mutex);
+        xfree(t->fname);
+        xfree(t);
+    }
+}
+
+ZOOM_API(ZOOM_cql_transform)
+    ZOOM_cql_transform_open(const char *fname)
+{
+    struct stat st;
+    ZOOM_cql_transform *tp, t = 0;
+
+    if (stat(fname, &st))
+        return 0;
+    if (cql_cache_mutex == 0)
+        yaz_mutex_create(&cql_cache_mutex);
+    yaz_mutex_enter(cql_cache_mutex);
+    for (tp = &cql_cache; *tp; tp = &(*tp)->next)
+        if (!strcmp((*tp)->fname, fname))
+        {
+            t = *tp;
+            if (t->mtime == st.st_mtime && t->size == st.st_size)
+                t->refcount++;
+            else
+            {   /* file changed: drop it from the cache */
+                *tp = t->next;
+                cql_transform_release(t);
+                t = 0;
+            }
+            break;
+        }
+    if (!t)
+    {
+        cql_transform_t ct = cql_transform_open_fname(fname);
+        if (ct)
+        {
+            t = (ZOOM_cql_transform) xmalloc(sizeof(*t));
+            t->fname = xstrdup(fname);
+            t->mtime = st.st_mtime;
+            t->size = st.st_size;
+            t->ct = ct;
+            t->mutex = 0;
+            yaz_mutex_create(&t->mutex);
+            t->refcount = 2; /* cache and caller */
+            t->next = cql_cache;
+            cql_cache = t;
+        }
+    }
+    yaz_mutex_leave(cql_cache_mutex);
+    return t;
+}
+
+ZOOM_API(void)
+    ZOOM_cql_transform_destroy(ZOOM_cql_transform t)
+{
+    if (!t)
+        return;
+    yaz_mutex_enter(cql_cache_mutex);
+    cql_transform_release(t);
+    yaz_mutex_leave(cql_cache_mutex);
+}
+
 /*
  * Returns an xmalloc()d string containing RPN that corresponds to the
- * CQL passed in.  On error, sets the Connection object's error state
- * and returns a null pointer.
- * ### We could cache CQL parser and/or transformer in Connection.
+ * CQL passed in.  The transform is trans or else the cached one for the
+ * connection's cqlfile option. On error, sets the Connection object's
+ * error state and returns a null pointer.
  */
-static char *cql2pqf(ZOOM_connection c, const char *cql)
+static char *cql2pqf(ZOOM_connection c, const char *cql,
+                     ZOOM_cql_transform trans)
 {
     CQL_parser parser;
     int error;
     const char *cqlfile;
-    cql_transform_t trans;
+    ZOOM_cql_transform opened = 0;
     char *result = 0;
 
     parser = cql_parser_create();
@@ -172,27 +280,34 @@ static char *cql2pqf(ZOOM_connection c, const char *cql)
         return 0;
     }
 
-    cqlfile = ZOOM_connection_option_get(c, "cqlfile");
-    if (cqlfile == 0)
-    {
-        ZOOM_set_error(c, ZOOM_ERROR_CQL_TRANSFORM, "no CQL transform file");
-    }
-    else if ((trans = cql_transform_open_fname(cqlfile)) == 0)
+    if (!trans)
     {
-        char buf[512];
-        sprintf(buf, "can't open CQL transform file '%.200s': %.200s",
-                cqlfile, strerror(errno));
-        ZOOM_set_error(c, ZOOM_ERROR_CQL_TRANSFORM, buf);
+        cqlfile = ZOOM_connection_option_get(c, "cqlfile");
+        if (cqlfile == 0)
+        {
+            ZOOM_set_error(c, ZOOM_ERROR_CQL_TRANSFORM,
+                           "no CQL transform file");
+        }
+        else if ((trans = opened = ZOOM_cql_transform_open(cqlfile)) == 0)
+        {
+            char buf[512], msg[200];
+            yaz_strerror(msg, sizeof(msg));
+            sprintf(buf, "can't open CQL transform file '%.200s': %s",
+                    cqlfile, msg);
+            ZOOM_set_error(c, ZOOM_ERROR_CQL_TRANSFORM, buf);
+        }
     }
-    else
+    if (trans)
     {
         WRBUF wrbuf_result = wrbuf_alloc();
-        error = cql_transform(trans, cql_parser_result(parser),
+
+        yaz_mutex_enter(trans->mutex);
+        error = cql_transform(trans->ct, cql_parser_result(parser),
                               wrbuf_vp_puts, wrbuf_result);
         if (error != 0) {
             char buf[512];
             const char *addinfo;
-            error = cql_transform_error(trans, &addinfo);
+            error = cql_transform_error(trans->ct, &addinfo);
             sprintf(buf, "%.200s (addinfo=%.200s)",
                     cql_strerror(error), addinfo);
             ZOOM_set_error(c, ZOOM_ERROR_CQL_TRANSFORM, buf);
@@ -201,14 +316,14 @@ static char *cql2pqf(ZOOM_connection c, const char *cql)
         {
             result = xstrdup(wrbuf_cstr(wrbuf_result));
         }
-        cql_transform_close(trans);
+        yaz_mutex_leave(trans->mutex);
         wrbuf_destroy(wrbuf_result);
     }
+    ZOOM_cql_transform_destroy(opened);
     cql_parser_destroy(parser);
     return result;
 }
 
-
 ZOOM_API(ZOOM_query)
     ZOOM_query_create(void)
 {
@@ -223,6 +338,8 @@ ZOOM_API(ZOOM_query)
     s->full_query = wrbuf_alloc();
     s->sort_strategy = SORT_STRATEGY_Z3950;
     s->sru11_sort_spec = wrbuf_alloc();
+    s->prepared = 0;
+    s->key = 0;
     return s;
 }
 
@@ -240,6 +357,8 @@ ZOOM_API(void)
         xfree(s->query_string);
         wrbuf_destroy(s->full_query);
         wrbuf_destroy(s->sru11_sort_spec);
+        ZOOM_prepared_destroy(s->prepared);
+        wrbuf_destroy(s->key);
         xfree(s);
     }
 }
@@ -278,6 +397,17 @@ ZOOM_API(int)
  */
 ZOOM_API(int)
     ZOOM_query_cql2rpn(ZOOM_query s, const char *str, ZOOM_connection conn)
+{
+    return ZOOM_query_cql2rpn_transform(s, str, 0, conn);
+}
+
+/*
+ * As ZOOM_query_cql2rpn() but with a transform from ZOOM_cql_transform_open()
+ * instead of the connection's cqlfile option.
+ */
+ZOOM_API(int)
+    ZOOM_query_cql2rpn_transform(ZOOM_query s, const char *str,
+                                 ZOOM_cql_transform t, ZOOM_connection conn)
 {
     char *rpn;
     int ret;
@@ -286,7 +416,7 @@ ZOOM_API(int)
     if (conn == 0)
         conn = freeme = ZOOM_connection_create(0);
 
-    rpn = cql2pqf(conn, str);
+    rpn = cql2pqf(conn, str, t);
     if (freeme != 0)
         ZOOM_connection_destroy(freeme);
     if (rpn == 0)
@@ -297,6 +427,576 @@ ZOOM_API(int)
     return ret;
 }
 
+/* end of the name of a $name placeholder starting at cp */
+static const char *prepared_name_end(const char *cp)
+{
+    while (*cp == '_' || yaz_isdigit(*cp) || yaz_isupper(*cp)
+           || yaz_islower(*cp))
+        cp++;
+    return cp;
+}
+
+/* whether the term buf of len bytes is a $name placeholder */
+static int prepared_is_param(const char *buf, size_t len)
+{
+    return len >= 2 && buf[0] == '$' && prepared_name_end(buf + 1) == buf + len;
+}
+
+/* length of the quoted string at cp, quotes included, or 0 if there is
+   none: PQF quotes with "" and {}, CQL with "" */
+static size_t prepared_quoted(const char *cp, int query_type)
+{
+    const char *end;
+    char close;
+
+    if (*cp == '"')
+        close = '"';
+    else if (*cp == '{' && query_type == Z_Query_type_1)
+        close = '}';
+    else
+        return 0;
+    for (end = cp + 1; *end && *end != close; end++)
+        if (*end == '\\' && end[1])
+            end++;
+    return *end ? end + 1 - cp : end - cp;
+}
+
+/* a quoted "$name" is a literal term, not a placeholder: its '$' is
+   masked while the template is parsed and restored on bind */
+#define PREPARED_LITERAL '\001'
+
+static void prepared_mask_quoted(char *str, int query_type)
+{
+    while (*str)
+    {
+        size_t n = prepared_quoted(str, query_type);
+
+        if (n)
+        {
+            if (n > 2 && prepared_is_param(str + 1, n - 2))
+                str[1] = PREPARED_LITERAL;
+            str += n;
+        }
+        else
+            str++;
+    }
+}
+
+/* adds the name of placeholder term buf, if it is one, to p->params */
+static void prepared_add_param(ZOOM_prepared p, const char *buf, size_t len)
+{
+    int i;
+
+    if (!prepared_is_param(buf, len))
+        return;
+    for (i = 0; i < p->num_params; i++)
+        if (strlen(p->params[i]) == len - 1
+            && !memcmp(p->params[i], buf + 1, len - 1))
+            return;
+    p->params = (char **)
+        xrealloc(p->params, (p->num_params + 1) * sizeof(*p->params));
+    p->params[p->num_params++] = odr_strdupn(p->odr, buf + 1, len - 1);
+}
+
+/* buffer and length of an RPN term, or NULL if not a string */
+static const char *prepared_term(Z_Term *term, size_t *len)
+{
+    if (term->which == Z_Term_general)
+    {
+        *len = term->u.general->len;
+        return (const char *) term->u.general->buf;
+    }
+    if (term->which == Z_Term_characterString)
+    {
+        *len = strlen(term->u.characterString);
+        return term->u.characterString;
+    }
+    return 0;
+}
+
+static void prepared_rpn_params(ZOOM_prepared p, Z_RPNStructure *s)
+{
+    if (s->which == Z_RPNStructure_complex)
+    {
+        prepared_rpn_params(p, s->u.complex->s1);
+        prepared_rpn_params(p, s->u.complex->s2);
+    }
+    else if (s->u.simple->which == Z_Operand_APT)
+    {
+        size_t len;
+        const char *buf =
+            prepared_term(s->u.simple->u.attributesPlusTerm->term, &len);
+
+        if (buf)
+            prepared_add_param(p, buf, len);
+    }
+}
+
+static void prepared_cql_params(ZOOM_prepared p, struct cql_node *cn)
+{
+    struct cql_node *t;
+
+    switch (cn->which)
+    {
+    case CQL_NODE_ST:
+        for (t = cn; t; t = t->u.st.extra_terms)
+            prepared_add_param(p, t->u.st.term, strlen(t->u.st.term));
+        break;
+    case CQL_NODE_BOOL:
+        prepared_cql_params(p, cn->u.boolean.left);
+        prepared_cql_params(p, cn->u.boolean.right);
+        break;
+    case CQL_NODE_SORT:
+        prepared_cql_params(p, cn->u.sort.search);
+        break;
+    }
+}
+
+ZOOM_API(ZOOM_prepared)
+    ZOOM_prepared_create(const char *type, const char *str)
+{
+    ZOOM_prepared p;
+    int query_type;
+    char *masked;
+
+    if (!strcmp(type, "prefix"))
+        query_type = Z_Query_type_1;
+    else if (!strcmp(type, "cql"))
+        query_type = Z_Query_type_104;
+    else
+        return 0;
+
+    p = (ZOOM_prepared) xmalloc(sizeof(*p));
+    p->refcount = 1;
+    p->mutex = 0;
+    yaz_mutex_create(&p->mutex);
+    p->query_type = query_type;
+    p->query_string = xstrdup(str);
+    p->odr = odr_createmem(ODR_ENCODE);
+    p->z_query = 0;
+    p->cql = 0;
+    p->params = 0;
+    p->num_params = 0;
+
+    masked = odr_strdup(p->odr, str);
+    prepared_mask_quoted(masked, query_type);
+    if (query_type == Z_Query_type_1)
+    {
+        p->z_query = (Z_Query *) odr_malloc(p->odr, sizeof(*p->z_query));
+        p->z_query->which = Z_Query_type_1;
+        p->z_query->u.type_1 = p_query_rpn(p->odr, masked);
+        if (!p->z_query->u.type_1)
+        {
+            ZOOM_prepared_destroy(p);
+            return 0;
+        }
+        prepared_rpn_params(p, p->z_query->u.type_1->RPNStructure);
+    }
+    else
+    {
+        p->cql = cql_parser_create();
+        if (cql_parser_string(p->cql, masked))
+        {
+            ZOOM_prepared_destroy(p);
+            return 0;
+        }
+        prepared_cql_params(p, cql_parser_result(p->cql));
+    }
+    return p;
+}
+
+ZOOM_API(void)
+    ZOOM_prepared_destroy(ZOOM_prepared p)
+{
+    if (!p)
+        return;
+    yaz_mutex_enter(p->mutex);
+    if (--(p->refcount) == 0)
+    {
+        yaz_mutex_leave(p->mutex);
+        yaz_mutex_destroy(&p->mutex);
+        if (p->cql)
+            cql_parser_destroy(p->cql);
+        odr_destroy(p->odr);
+        xfree(p->params);
+        xfree(p->query_string);
+        xfree(p);
+    }
+    else
+        yaz_mutex_leave(p->mutex);
+}
+
+ZOOM_API(int)
+    ZOOM_prepared_num_params(ZOOM_prepared p)
+{
+    return p->num_params;
+}
+
+ZOOM_API(const char *)
+    ZOOM_prepared_param_name(ZOOM_prepared p, int i)
+{
+    if (i < 0 || i >= p->num_params)
+        return 0;
+    return p->params[i];
+}
+
+/* index of parameter for placeholder $name of len bytes or -1 */
+static int prepared_param(const char *buf, size_t len,
+                          const char **names, int num)
+{
+    int i;
+
+    if (!prepared_is_param(buf, len))
+        return -1;
+    for (i = 0; i < num; i++)
+        if (strlen(names[i]) == len - 1 && !memcmp(names[i], buf + 1, len - 1))
+            return i;
+    return -1;
+}
+
+/* copies the nodes of the RPN structure leading to placeholder terms;
+   everything else is shared with the template */
+static Z_RPNStructure *prepared_bind_rpn(ODR o, Z_RPNStructure *s,
+                                         const char **names,
+                                         const char **values, int num)
+{
+    Z_RPNStructure *r = (Z_RPNStructure *) odr_malloc(o, sizeof(*r));
+
+    *r = *s;
+    if (s->which == Z_RPNStructure_complex)
+    {
+        r->u.complex = (Z_Complex *) odr_malloc(o, sizeof(*r->u.complex));
+        *r->u.complex = *s->u.complex;
+        r->u.complex->s1 = prepared_bind_rpn(o, s->u.complex->s1,
+                                             names, values, num);
+        r->u.complex->s2 = prepared_bind_rpn(o, s->u.complex->s2,
+                                             names, values, num);
+    }
+    else if (s->u.simple->which == Z_Operand_APT)
+    {
+        Z_AttributesPlusTerm *apt = s->u.simple->u.attributesPlusTerm;
+        Z_Term *term = apt->term, *bound = 0;
+        size_t len = 0;
+        const char *buf = prepared_term(term, &len);
+        int i;
+
+        if (len && *buf == PREPARED_LITERAL)
+        {
+            char *lit = odr_strdupn(o, buf, len);
+
+            *lit = '$';
+            bound = z_Term_create(o, term->which, lit, len);
+        }
+        else if (buf && (i = prepared_param(buf, len, names, num)) >= 0)
+            bound = z_Term_create(o, term->which, values[i],
+                                  strlen(values[i]));
+        if (bound)
+        {
+            Z_Operand *op = (Z_Operand *) odr_malloc(o, sizeof(*op));
+
+            op->which = Z_Operand_APT;
+            op->u.attributesPlusTerm = (Z_AttributesPlusTerm *)
+                odr_malloc(o, sizeof(*op->u.attributesPlusTerm));
+            op->u.attributesPlusTerm->attributes = apt->attributes;
+            op->u.attributesPlusTerm->term = bound;
+            r->u.simple = op;
+        }
+    }
+    return r;
+}
+
+/* CQL term for a template term: the value, with quotes and backslashes
+   escaped, for a placeholder */
+static char *prepared_bind_term(NMEM nmem, char *term, const char **names,
+                                const char **values, int num)
+{
+    int i = prepared_param(term, strlen(term), names, num);
+
+    if (*term == PREPARED_LITERAL)
+    {
+        term = nmem_strdup(nmem, term);
+        *term = '$';
+    }
+    else if (i >= 0)
+    {
+        const char *v;
+        char *cp;
+
+        cp = term = (char *) nmem_malloc(nmem, 2 * strlen(values[i]) + 1);
+        for (v = values[i]; *v; v++)
+        {
+            if (*v == '"' || *v == '\\')
+                *cp++ = '\\';
+            *cp++ = *v;
+        }
+        *cp = '\0';
+    }
+    return term;
+}
+
+/* copies the nodes of the CQL tree leading to search terms, which get
+   the values of placeholders; modifiers are shared with the template */
+static struct cql_node *prepared_bind_cql(NMEM nmem, struct cql_node *cn,
+                                          const char **names,
+                                          const char **values, int num)
+{
+    struct cql_node *r;
+
+    if (!cn)
+        return 0;
+    r = (struct cql_node *) nmem_malloc(nmem, sizeof(*r));
+    *r = *cn;
+    switch (cn->which)
+    {
+    case CQL_NODE_ST:
+        r->u.st.term = prepared_bind_term(nmem, cn->u.st.term,
+                                          names, values, num);
+        r->u.st.extra_terms = prepared_bind_cql(nmem, cn->u.st.extra_terms,
+                                                names, values, num);
+        break;
+    case CQL_NODE_BOOL:
+        r->u.boolean.left = prepared_bind_cql(nmem, cn->u.boolean.left,
+                                              names, values, num);
+        r->u.boolean.right = prepared_bind_cql(nmem, cn->u.boolean.right,
+                                               names, values, num);
+        break;
+    case CQL_NODE_SORT:
+        r->u.sort.search = prepared_bind_cql(nmem, cn->u.sort.search,
+                                             names, values, num);
+        break;
+    }
+    return r;
+}
+
+/* CQL string as parsed: backslash escapes are kept. Quoted if quote is
+   set or the string would not read back as one term otherwise */
+static void prepared_cql_str(WRBUF w, const char *str, int quote)
+{
+    const char *cp;
+
+    if (!quote)
+        quote = !*str || strpbrk(str, " \n()=<>/\"")
+            || !cql_strcmp(str, "and") || !cql_strcmp(str, "or")
+            || !cql_strcmp(str, "not") || !cql_strcmp(str, "prox")
+            || !cql_strcmp(str, "sortby");
+    if (quote)
+        wrbuf_putc(w, '"');
+    for (cp = str; *cp; cp++)
+    {
+        if (*cp == '\\')
+        {
+            wrbuf_putc(w, *cp);
+            if (!cp[1])
+                break;
+            cp++;
+        }
+        else if (*cp == '"')
+            wrbuf_putc(w, '\\');
+        wrbuf_putc(w, *cp);
+    }
+    if (quote)
+        wrbuf_putc(w, '"');
+}
+
+/* modifier lists are kept last modifier first */
+static void prepared_cql_modifiers(WRBUF w, struct cql_node *mod)
+{
+    if (!mod)
+        return;
+    prepared_cql_modifiers(w, mod->u.st.modifiers);
+    wrbuf_putc(w, '/');
+    prepared_cql_str(w, mod->u.st.index, 0);
+    if (mod->u.st.relation)
+    {
+        wrbuf_puts(w, mod->u.st.relation);
+        prepared_cql_str(w, mod->u.st.term, 0);
+    }
+}
+
+static void prepared_cql_write(WRBUF w, struct cql_node *cn);
+
+static void prepared_cql_operand(WRBUF w, struct cql_node *cn)
+{
+    if (cn->which == CQL_NODE_BOOL)
+    {
+        wrbuf_putc(w, '(');
+        prepared_cql_write(w, cn);
+        wrbuf_putc(w, ')');
+    }
+    else
+        prepared_cql_write(w, cn);
+}
+
+/* CQL for a parsed query. The parser resolves context set prefixes, so
+   a search clause with index or relation in a set has the set given
+   again, under a prefix of its own */
+static void prepared_cql_write(WRBUF w, struct cql_node *cn)
+{
+    struct cql_node *t;
+
+    switch (cn->which)
+    {
+    case CQL_NODE_ST:
+        if (cn->u.st.index_uri || cn->u.st.relation_uri)
+        {
+            wrbuf_putc(w, '(');
+            if (cn->u.st.index_uri)
+            {
+                wrbuf_puts(w, ">i=");
+                prepared_cql_str(w, cn->u.st.index_uri, 1);
+                wrbuf_putc(w, ' ');
+            }
+            if (cn->u.st.relation_uri)
+            {
+                wrbuf_puts(w, ">r=");
+                prepared_cql_str(w, cn->u.st.relation_uri, 1);
+                wrbuf_putc(w, ' ');
+            }
+        }
+        if (cn->u.st.index_uri || cn->u.st.relation_uri || cn->u.st.modifiers
+            || strcmp(cn->u.st.index, "cql.serverChoice")
+            || strcmp(cn->u.st.relation, "="))
+        {
+            if (cn->u.st.index_uri)
+                wrbuf_puts(w, "i.");
+            prepared_cql_str(w, cn->u.st.index, 0);
+            wrbuf_putc(w, ' ');
+            if (cn->u.st.relation_uri)
+                wrbuf_puts(w, "r.");
+            wrbuf_puts(w, cn->u.st.relation);
+            prepared_cql_modifiers(w, cn->u.st.modifiers);
+            wrbuf_putc(w, ' ');
+        }
+        for (t = cn; t; t = t->u.st.extra_terms)
+        {
+            if (t != cn)
+                wrbuf_putc(w, ' ');
+            prepared_cql_str(w, t->u.st.term, 1);
+        }
+        if (cn->u.st.index_uri || cn->u.st.relation_uri)
+            wrbuf_putc(w, ')');
+        break;
+    case CQL_NODE_BOOL:
+        prepared_cql_operand(w, cn->u.boolean.left);
+        wrbuf_printf(w, " %s", cn->u.boolean.value);
+        prepared_cql_modifiers(w, cn->u.boolean.modifiers);
+        wrbuf_putc(w, ' ');
+        prepared_cql_operand(w, cn->u.boolean.right);
+        break;
+    case CQL_NODE_SORT:
+        prepared_cql_write(w, cn->u.sort.search);
+        wrbuf_puts(w, " sortBy");
+        for (t = cn; t; t = t->u.sort.next)
+        {
+            wrbuf_putc(w, ' ');
+            prepared_cql_str(w, t->u.sort.index, 0);
+            prepared_cql_modifiers(w, t->u.sort.modifiers);
+        }
+        break;
+    }
+}
+
+/* PQF template with values, quoted, for its placeholders. Quoted
+   strings are copied as they are */
+static void prepared_bind_pqf(WRBUF w, const char *cp, const char **names,
+                              const char **values, int num)
+{
+    const char *start = cp;
+
+    while (*cp)
+    {
+        const char *end = cp + 1;
+        size_t n = prepared_quoted(cp, Z_Query_type_1);
+        int i = -1;
+
+        if (n)
+        {
+            wrbuf_write(w, cp, n);
+            cp += n;
+            continue;
+        }
+        /* a placeholder is a whole term */
+        if (*cp == '$' && (cp == start || yaz_isspace(cp[-1])))
+        {
+            end = prepared_name_end(end);
+            if (!*end || yaz_isspace(*end))
+                i = prepared_param(cp, end - cp, names, num);
+        }
+        if (i >= 0)
+        {
+            const char *v;
+
+            wrbuf_putc(w, '"');
+            for (v = values[i]; *v; v++)
+            {
+                if (*v == '"' || *v == '\\')
+                    wrbuf_putc(w, '\\');
+                wrbuf_putc(w, *v);
+            }
+            wrbuf_putc(w, '"');
+            cp = end;
+        }
+        else
+            wrbuf_putc(w, *cp++);
+    }
+}
+
+/*
+ * Creates query from prepared template with values for its placeholders.
+ * The parsed template is reused: no PQF or CQL parsing takes place.
+ */
+ZOOM_API(ZOOM_query)
+    ZOOM_prepared_bind(ZOOM_prepared p, const char **names,
+                       const char **values, int num)
+{
+    ZOOM_query s;
+    int i, j;
+
+    for (j = 0; j < p->num_params; j++)
+    {
+        for (i = 0; i < num; i++)
+            if (!strcmp(names[i], p->params[j]))
+                break;
+        if (i == num || !values[i])
+            return 0;
+    }
+    s = ZOOM_query_create();
+    s->query_type = p->query_type;
+    if (p->query_type == Z_Query_type_1)
+    {
+        Z_RPNQuery *rpn = (Z_RPNQuery *)
+            odr_malloc(s->odr_query, sizeof(*rpn));
+
+        prepared_bind_pqf(s->full_query, p->query_string, names, values, num);
+        s->query_string = xstrdup(wrbuf_cstr(s->full_query));
+
+        *rpn = *p->z_query->u.type_1;
+        rpn->RPNStructure = prepared_bind_rpn(s->odr_query,
+                                              rpn->RPNStructure,
+                                              names, values, num);
+        s->z_query = (Z_Query *) odr_malloc(s->odr_query, sizeof(*s->z_query));
+        s->z_query->which = Z_Query_type_1;
+        s->z_query->u.type_1 = rpn;
+        s->prepared = p;
+        yaz_mutex_enter(p->mutex);
+        p->refcount++;
+        yaz_mutex_leave(p->mutex);
+    }
+    else
+    {
+        NMEM nmem = nmem_create();
+        struct cql_node *cn = prepared_bind_cql(nmem,
+                                                cql_parser_result(p->cql),
+                                                names, values, num);
+
+        prepared_cql_write(s->full_query, cn);
+        s->query_string = xstrdup(wrbuf_cstr(s->full_query));
+        nmem_destroy(nmem);
+        generate(s);
+    }
+    return s;
+}
+
 /*
  * Analogous in every way to ZOOM_query_cql2rpn(), except that there
  * is no analogous ZOOM_query_ccl() that just sends uninterpreted CCL
@@ -25,6 +25,7 @@ YAZ_SHPTR_TYPE(WRBUF)
 
 struct ZOOM_record_p {
     ODR odr;
+    ZOOM_resultset resultset; /* set whose memory a reference points into */
 #if SHPTR
     struct WRBUF_shptr *record_wrbuf;
 #else
@@ -81,6 +82,7 @@ static ZOOM_record record_cache_add(ZOOM_resultset r,
     {
         rc = (ZOOM_record_cache) odr_malloc(r->odr, sizeof(*rc));
         rc->rec.odr = 0;
+        rc->rec.resultset = 0;
 #if SHPTR
         YAZ_SHPTR_INC(r->record_wrbuf);
         rc->rec.record_wrbuf = r->record_wrbuf;
@@ -190,6 +192,7 @@ ZOOM_API(ZOOM_record)
 
     nrec = (ZOOM_record) xmalloc(sizeof(*nrec));
     nrec->odr = odr_createmem(ODR_DECODE);
+    nrec->resultset = 0;
 #if SHPTR
     nrec->record_wrbuf = 0;
 #else
@@ -207,6 +210,35 @@ ZOOM_API(ZOOM_record)
     return nrec;
 }
 
+ZOOM_API(ZOOM_record)
+    ZOOM_resultset_record_ref(ZOOM_resultset r, size_t pos)
+{
+    ZOOM_record srec = ZOOM_resultset_record_immediate(r, pos);
+    ZOOM_record nrec;
+
+    if (!srec)
+        return 0;
+
+    /* no copy of the record; the result set memory holding it is kept
+       alive by a reference which is dropped in ZOOM_record_destroy */
+    nrec = (ZOOM_record) xmalloc(sizeof(*nrec));
+    nrec->odr = 0;
+    nrec->resultset = r;
+    ZOOM_resultset_addref(r);
+#if SHPTR
+    nrec->record_wrbuf = 0;
+#else
+    nrec->wrbuf = 0;
+#endif
+    nrec->npr = srec->npr;
+    nrec->schema = srec->schema;
+    nrec->diag_uri = srec->diag_uri;
+    nrec->diag_message = srec->diag_message;
+    nrec->diag_details = srec->diag_details;
+    nrec->diag_set = srec->diag_set;
+    return nrec;
+}
+
 static void ZOOM_record_release(ZOOM_record rec)
 {
     if (!rec)
@@ -222,6 +254,8 @@ static void ZOOM_record_release(ZOOM_record rec)
 
     if (rec->odr)
         odr_destroy(rec->odr);
+    if (rec->resultset)
+        ZOOM_resultset_destroy(rec->resultset);
 }
 
 ZOOM_API(void)
@@ -32,7 +32,8 @@ static void set_SRU_error(ZOOM_connection c, Z_SRW_diagnostic *d)
 static zoom_ret send_srw(ZOOM_connection c, Z_SRW_PDU *sr)
 {
     Z_GDU *gdu;
-    const char *database =  ZOOM_options_get(c->options, "databaseName");
+    const char *database =
+        ZOOM_options_getk(c->options, ZOOM_OPT(databaseName), 0);
 
     gdu = z_get_HTTP_Request_uri(c->odr_out, c->host_port,
                                  database,
@@ -234,11 +235,13 @@ zoom_ret ZOOM_connection_srw_send_search(ZOOM_connection c)
     sr->u.request->recordSchema = odr_strdup_null(c->odr_out, schema);
     sr->u.request->facetList = facet_list;
 
-    option_val = ZOOM_resultset_option_get(resultset, "recordPacking");
+    option_val = ZOOM_options_getk(resultset->options, ZOOM_OPT(recordPacking),
+                                   0);
     if (option_val)
         sr->u.request->recordPacking = odr_strdup(c->odr_out, option_val);
 
-    option_val = ZOOM_resultset_option_get(resultset, "extraArgs");
+    option_val = ZOOM_options_getk(resultset->options, ZOOM_OPT(extraArgs),
+                                   0);
     yaz_encode_sru_extra(sr, c->odr_out, option_val);
     return send_srw(c, sr);
 }
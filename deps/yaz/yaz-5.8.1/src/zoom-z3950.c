@@ -13,6 +13,10 @@
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
 #include "zoom-p.h"
 
 #include <yaz/yaz-util.h>
@@ -28,6 +32,7 @@
 #include <yaz/copy_types.h>
 #include <yaz/snprintf.h>
 #include <yaz/facet.h>
+#include <yaz/gettimeofday.h>
 
 #include <yaz/shptr.h>
 
@@ -542,12 +547,21 @@ static int encode_APDU(ZOOM_connection c, Z_APDU *a, ODR out)
     return 0;
 }
 
+static double zoom_time(void)
+{
+    struct timeval tv;
+
+    yaz_gettimeofday(&tv);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
 static zoom_ret send_APDU(ZOOM_connection c, Z_APDU *a)
 {
     ZOOM_Event event;
     assert(a);
     if (encode_APDU(c, a, c->odr_out))
         return zoom_complete;
+    c->request_time = zoom_time();
     yaz_log(c->log_details, "%p send APDU type=%d", c, a->which);
     c->buf_out = odr_getbuf(c->odr_out, &c->len_out, 0);
     event = ZOOM_Event_create(ZOOM_EVENT_SEND_APDU);
@@ -569,6 +583,8 @@ zoom_ret ZOOM_connection_Z3950_send_init(ZOOM_connection c)
     ODR_MASK_SET(ireq->options, Z_Options_sort);
     ODR_MASK_SET(ireq->options, Z_Options_extendedServices);
     ODR_MASK_SET(ireq->options, Z_Options_namedResultSets);
+    if (c->pipeline > 1)
+        ODR_MASK_SET(ireq->options, Z_Options_concurrentOperations);
 
     ODR_MASK_SET(ireq->protocolVersion, Z_ProtocolVersion_1);
     ODR_MASK_SET(ireq->protocolVersion, Z_ProtocolVersion_2);
@@ -657,9 +673,9 @@ static zoom_ret Z3950_send_search(ZOOM_connection c)
 
     elementSetName = c->tasks->u.search.elementSetName;
     smallSetElementSetName  =
-        ZOOM_options_get(r->options, "smallSetElementSetName");
+        ZOOM_options_getk(r->options, ZOOM_OPT(smallSetElementSetName), 0);
     mediumSetElementSetName =
-        ZOOM_options_get(r->options, "mediumSetElementSetName");
+        ZOOM_options_getk(r->options, ZOOM_OPT(mediumSetElementSetName), 0);
 
     if (!smallSetElementSetName)
         smallSetElementSetName = elementSetName;
@@ -693,7 +709,8 @@ static zoom_ret Z3950_send_search(ZOOM_connection c)
     if (search_req->query->which == Z_Query_type_1 ||
         search_req->query->which == Z_Query_type_101)
     {
-        const char *cp = ZOOM_options_get(r->options, "rpnCharset");
+        const char *cp = ZOOM_options_getk(r->options, ZOOM_OPT(rpnCharset),
+                                           0);
         if (cp)
         {
             yaz_iconv_t cd = yaz_iconv_open(cp, "UTF-8");
@@ -723,9 +740,10 @@ static zoom_ret Z3950_send_search(ZOOM_connection c)
 
     schema = c->tasks->u.search.schema;
 
-    lslb = ZOOM_options_get_int(r->options, "largeSetLowerBound", -1);
-    ssub = ZOOM_options_get_int(r->options, "smallSetUpperBound", -1);
-    mspn = ZOOM_options_get_int(r->options, "mediumSetPresentNumber", -1);
+    lslb = ZOOM_options_get_intk(r->options, ZOOM_OPT(largeSetLowerBound), -1);
+    ssub = ZOOM_options_get_intk(r->options, ZOOM_OPT(smallSetUpperBound), -1);
+    mspn = ZOOM_options_get_intk(r->options,
+                                 ZOOM_OPT(mediumSetPresentNumber), -1);
     if (lslb != -1 && ssub != -1 && mspn != -1)
     {
         /* So're a Z39.50 expert? Let's hope you don't do sort */
@@ -950,7 +968,7 @@ ZOOM_API(void)
 }
 
 static void handle_Z3950_records(ZOOM_connection c, Z_Records *sr,
-                                 int present_phase);
+                                 int present_phase, int *start, int *count);
 
 static void response_default_diag(ZOOM_connection c, Z_DefaultDiagFormat *r)
 {
@@ -1263,6 +1281,93 @@ void ZOOM_handle_search_result(ZOOM_connection c, ZOOM_resultset resultset,
     }
 }
 
+/* records of a response before the first one left out for exceeding
+   the preferred message size */
+static int records_fitted(Z_Records *sr)
+{
+    int i;
+    Z_NamePlusRecordList *p;
+
+    if (!sr || sr->which != Z_Records_DBOSD)
+        return 0;
+    p = sr->u.databaseOrSurDiagnostics;
+    for (i = 0; i < p->num_records; i++)
+    {
+        Z_NamePlusRecord *npr = p->records[i];
+
+        if (npr->which == Z_NamePlusRecord_surrogateDiagnostic
+            && npr->u.surrogateDiagnostic->which == Z_DiagRec_defaultFormat
+            && *npr->u.surrogateDiagnostic->u.defaultFormat->condition ==
+            YAZ_BIB1_RECORD_EXCEEDS_PREFERRED_MESSAGE_SIZE)
+            break;
+    }
+    return i;
+}
+
+/* chunk transfer time aimed at by presentChunk=auto, in round trips.
+   With 4 the round trip leaves the connection idle a fifth of the time */
+#define PRESENT_AUTO_RTTS 4
+
+/* presentChunk=auto. A response of bytes holding nrec records took secs
+   since its request was sent or, if queued behind the response before
+   it, since that one. cut is the number of records that fitted if the
+   target left out the rest for the message size, 0 otherwise. The step
+   is set to the number of records that take PRESENT_AUTO_RTTS round
+   trips to transfer, growing at most twofold a response, and kept
+   within the message size */
+static void adapt_present_chunk(ZOOM_connection c, ZOOM_resultset r,
+                                double secs, int queued, int bytes,
+                                int nrec, int cut)
+{
+    double transfer = secs;
+    int step, limit = ZOOM_PRESENT_CHUNK_MAX;
+
+    if (!queued)
+    {
+        if (r->present_rtt == 0.0 || secs < r->present_rtt)
+            r->present_rtt = secs;
+        transfer = secs - r->present_rtt;
+    }
+    ZOOM_options_set_int(r->options, "presentRoundTrip",
+                         (int) (r->present_rtt * 1000));
+    if (nrec <= 0)
+        return;
+    r->record_bytes = r->record_bytes == 0.0 ? (double) bytes / nrec :
+        (3 * r->record_bytes + (double) bytes / nrec) / 4;
+    /* transfer lost in the noise of the round trip tells nothing */
+    if (transfer > 0.001 && transfer > r->present_rtt / 10)
+    {
+        double rate = bytes / transfer;
+        r->present_rate = r->present_rate == 0.0 ? rate :
+            (3 * r->present_rate + rate) / 4;
+    }
+    if (cut > 0 && (!c->message_size || bytes < c->message_size))
+        c->message_size = bytes;
+
+    step = 2 * r->step;
+    if (r->present_rate > 0.0)
+    {
+        double n = r->present_rate * r->present_rtt * PRESENT_AUTO_RTTS
+            / r->record_bytes;
+        if (n < step)
+            step = n < ZOOM_PRESENT_CHUNK_AUTO ? ZOOM_PRESENT_CHUNK_AUTO :
+                (int) n;
+    }
+    if (c->message_size > 0 && c->message_size / r->record_bytes < limit)
+        limit = (int) (c->message_size / r->record_bytes);
+    if (cut > 0 && cut < limit)
+        limit = cut;
+    if (step > limit)
+        step = limit;
+    r->step = step > 0 ? step : 1;
+    yaz_log(c->log_details, "%p adapt_present_chunk rtt=%.3f rate=%.0f "
+            "record=%.0f step=%d", c, r->present_rtt, r->present_rate,
+            r->record_bytes, r->step);
+    ZOOM_options_set_int(r->options, "presentChunkSize", r->step);
+    ZOOM_options_set_int(r->options, "presentRecordSize",
+                         (int) r->record_bytes);
+}
+
 static void handle_Z3950_search_response(ZOOM_connection c,
                                          Z_SearchResponse *sr)
 {
@@ -1303,7 +1408,14 @@ static void handle_Z3950_search_response(ZOOM_connection c,
     ZOOM_memcached_hitcount(c, resultset, sr->additionalSearchInfo,
                             resultCountPrecision);
     resultset->live_set = 2;
-    handle_Z3950_records(c, sr->records, 0);
+    if (resultset->step_auto)
+    {
+        c->response_time = zoom_time();
+        adapt_present_chunk(c, resultset, c->response_time - c->request_time,
+                            0, odr_offset(c->odr_in), 0, 0);
+    }
+    handle_Z3950_records(c, sr->records, 0, &c->tasks->u.search.start,
+                         &c->tasks->u.search.count);
 }
 
 static void handle_Z3950_sort_response(ZOOM_connection c, Z_SortResponse *res)
@@ -1338,19 +1450,17 @@ static void handle_Z3950_scan_response(ZOOM_connection c, Z_ScanResponse *res)
     nmem_destroy(nmem);
 }
 
+/* caches the records at *start and advances *start and *count past them */
 static void handle_Z3950_records(ZOOM_connection c, Z_Records *sr,
-                                 int present_phase)
+                                 int present_phase, int *start, int *count)
 {
     ZOOM_resultset resultset;
-    int *start, *count;
     const char *syntax = 0, *elementSetName = 0, *schema = 0;
 
     if (!c->tasks || c->tasks->which != ZOOM_TASK_SEARCH)
         return ;
 
     resultset = c->tasks->u.search.resultset;
-    start = &c->tasks->u.search.start;
-    count = &c->tasks->u.search.count;
     syntax = c->tasks->u.search.syntax;
     elementSetName = c->tasks->u.search.elementSetName;
     schema =  c->tasks->u.search.schema;
@@ -1376,7 +1486,8 @@ static void handle_Z3950_records(ZOOM_connection c, Z_Records *sr,
             NMEM nmem = odr_extract_mem(c->odr_in);
             Z_NamePlusRecordList *p =
                 sr->u.databaseOrSurDiagnostics;
-            for (i = 0; i < p->num_records; i++)
+            /* leading records were cached while the response arrived */
+            for (i = c->stream_records; i < p->num_records; i++)
             {
                 ZOOM_record_cache_add(resultset, p->records[i], i + *start,
                                       syntax, elementSetName, schema, 0);
@@ -1420,10 +1531,226 @@ static void handle_Z3950_records(ZOOM_connection c, Z_Records *sr,
     }
 }
 
+/* outstanding present answered by a response with the given referenceId.
+   Without one, the target is taken to answer in order */
+static struct ZOOM_present_p *find_present(ZOOM_connection c,
+                                           const char *refid, int len)
+{
+    int i;
+
+    for (i = 0; i < c->num_presents; i++)
+    {
+        struct ZOOM_present_p *p = c->presents + i;
+        char buf[20];
+
+        if (!p->refid)
+            continue;
+        if (!refid)
+            return p;
+        sprintf(buf, "%d", p->refid);
+        if (strlen(buf) == (size_t) len && !memcmp(buf, refid, len))
+            return p;
+    }
+    return 0;
+}
+
+/* BER identifier and length octets at buf; returns their size, 0 if
+   incomplete or -1 on error. elen is -1 for indefinite length */
+static int partial_header(const char *buf, int len, int *zclass, int *tag,
+                          int *cons, int *elen)
+{
+    int n, m;
+
+    if ((n = ber_dectag(buf, zclass, tag, cons, len)) <= 0)
+        return 0;
+    if ((m = ber_declen(buf + n, elen, len - n)) == -1)
+        return 0;
+    return m < 0 ? -1 : n + m;
+}
+
+static int partial_eoc(const char *buf, int len)
+{
+    return len >= 2 && buf[0] == 0 && buf[1] == 0;
+}
+
+/* Decodes the records of a search or present response still being
+   received, so each is cached (and ZOOM_EVENT_RECV_RECORD put) as soon
+   as its bytes arrive rather than when the whole response did */
+void ZOOM_handle_Z3950_partial(ZOOM_connection c, const char *buf, int len)
+{
+    ZOOM_resultset resultset;
+    ODR odr;
+    int zclass, tag, cons, elen, n;
+
+    if (c->stream_end < 0 || !c->tasks
+        || c->tasks->which != ZOOM_TASK_SEARCH)
+        return;
+    resultset = c->tasks->u.search.resultset;
+    if (!c->stream_end)
+    {
+        int pos, end;
+        const char *refid = 0;
+        int refid_len = 0;
+
+        /* outer APDU, then skip its members up to the records */
+        n = partial_header(buf, len, &zclass, &tag, &cons, &elen);
+        if (n == 0)
+            return;
+        if (n < 0 || zclass != ODR_CONTEXT || !cons
+            || (tag != 23 && tag != 25))
+        {
+            c->stream_end = -1;
+            return;
+        }
+        end = elen >= 0 ? n + elen : len + 1;
+        for (pos = n; ; pos += n)
+        {
+            if (pos >= end || partial_eoc(buf + pos, len - pos))
+            {
+                c->stream_end = -1;  /* no records */
+                return;
+            }
+            n = partial_header(buf + pos, len - pos, &zclass, &tag, &cons,
+                               &elen);
+            if (n > 0 && zclass == ODR_CONTEXT && tag == 28 && cons)
+                break;
+            if (n > 0 && zclass == ODR_CONTEXT && tag == 2 && !cons
+                && elen >= 0)
+            {
+                refid = buf + pos + n;  /* referenceId */
+                refid_len = elen;
+            }
+            if (n >= 0)
+                n = completeBER(buf + pos, len - pos);
+            if (n == 0)
+                return;
+            if (n < 0)
+            {
+                c->stream_end = -1;
+                return;
+            }
+        }
+        c->stream_start = c->tasks->u.search.start;
+        if (c->num_presents)
+        {
+            struct ZOOM_present_p *p = find_present(c, refid, refid_len);
+            if (!p)
+            {
+                c->stream_end = -1;
+                return;
+            }
+            c->stream_start = p->start;
+        }
+        c->stream_pos = pos + n;
+        c->stream_end = elen >= 0 ? pos + n + elen : INT_MAX;
+    }
+    odr = odr_createmem(ODR_DECODE);
+    while (c->stream_pos < c->stream_end)
+    {
+        Z_NamePlusRecord *npr;
+        NMEM nmem;
+
+        if (partial_eoc(buf + c->stream_pos, len - c->stream_pos))
+        {
+            c->stream_end = -1;  /* end of indefinite length records */
+            break;
+        }
+        n = completeBER(buf + c->stream_pos, len - c->stream_pos);
+        if (n < 0)
+            c->stream_end = -1;
+        if (n <= 0)
+            break;
+        odr_reset(odr);
+        odr_setbuf(odr, (char *) buf + c->stream_pos, n, 0);
+        if (!z_NamePlusRecord(odr, &npr, 0, 0))
+        {
+            /* left for the decode of the complete response to report */
+            c->stream_end = -1;
+            break;
+        }
+        nmem = odr_extract_mem(odr);
+        ZOOM_record_cache_add(resultset, npr,
+                              c->stream_start + c->stream_records,
+                              c->tasks->u.search.syntax,
+                              c->tasks->u.search.elementSetName,
+                              c->tasks->u.search.schema, 0);
+        nmem_transfer(odr_getmem(resultset->odr), nmem);
+        nmem_destroy(nmem);
+        c->stream_records++;
+        c->stream_pos += n;
+    }
+    odr_destroy(odr);
+}
+
+static int present_chunk(ZOOM_connection c);
+
+/* feeds a present response for start, count to presentChunk=auto */
+static void adapt_present_response(ZOOM_connection c, Z_PresentResponse *pr,
+                                   int start, int count, double sent)
+{
+    ZOOM_resultset resultset = c->tasks->u.search.resultset;
+    double now = zoom_time();
+    int queued = sent < c->response_time;
+    int nrec = 0, cut = 0;
+
+    if (pr->records && pr->records->which == Z_Records_DBOSD)
+        nrec = pr->records->u.databaseOrSurDiagnostics->num_records;
+    cut = records_fitted(pr->records);
+    if (cut == nrec &&
+        (nrec >= count || start + nrec >= resultset->size))
+        cut = 0;
+    adapt_present_chunk(c, resultset,
+                        now - (queued ? c->response_time : sent), queued,
+                        odr_offset(c->odr_in), nrec, cut);
+    c->response_time = now;
+}
+
 static void handle_Z3950_present_response(ZOOM_connection c,
                                           Z_PresentResponse *pr)
 {
-    handle_Z3950_records(c, pr->records, 1);
+    struct ZOOM_present_p *p;
+    int start, count;
+
+    if (!c->tasks || c->tasks->which != ZOOM_TASK_SEARCH)
+        return;
+    if (!c->num_presents)
+    {
+        if (c->tasks->u.search.resultset->step_auto)
+            adapt_present_response(c, pr, c->tasks->u.search.start,
+                                    present_chunk(c), c->request_time);
+        handle_Z3950_records(c, pr->records, 1, &c->tasks->u.search.start,
+                             &c->tasks->u.search.count);
+        return;
+    }
+    if (pr->referenceId)
+        p = find_present(c, pr->referenceId->buf, pr->referenceId->len);
+    else
+        p = find_present(c, 0, 0);
+    if (!p)
+    {
+        yaz_log(c->log_api, "%p handle_Z3950_present_response: "
+                "no present for referenceId", c);
+        ZOOM_set_error(c, ZOOM_ERROR_DECODE, "referenceId");
+        ZOOM_connection_close(c);
+        return;
+    }
+    start = p->start;
+    count = p->count;
+    if (c->tasks->u.search.resultset->step_auto)
+        adapt_present_response(c, pr, start, count, p->sent);
+    handle_Z3950_records(c, pr->records, 1, &start, &count);
+    if (count > 0 && !c->error)
+    {
+        /* fewer records than asked for; ask again for the rest */
+        p->refid = 0;
+        p->start = start;
+        p->count = count;
+    }
+    else
+    {
+        c->num_presents--;
+        memmove(p, p + 1, (c->presents + c->num_presents - p) * sizeof(*p));
+    }
 }
 
 static void set_init_option(const char *name, void *clientData)
@@ -1459,7 +1786,7 @@ zoom_ret send_Z3950_sort(ZOOM_connection c, ZOOM_resultset resultset)
     return zoom_complete;
 }
 
-static zoom_ret Z3950_send_present(ZOOM_connection c)
+static Z_APDU *create_present_APDU(ZOOM_connection c, int start, int count)
 {
     Z_APDU *apdu = zget_APDU(c->odr_out, Z_APDU_presentRequest);
     Z_PresentRequest *req = apdu->u.presentRequest;
@@ -1468,17 +1795,8 @@ static zoom_ret Z3950_send_present(ZOOM_connection c)
     const char *elementSetName = c->tasks->u.search.elementSetName;
     const char *schema = c->tasks->u.search.schema;
 
-    yaz_log(c->log_details, "%p Z3950_send_present", c);
-
-    *req->resultSetStartPoint = c->tasks->u.search.start + 1;
-
-    if (resultset->step > 0 && resultset->step < c->tasks->u.search.count)
-        *req->numberOfRecordsRequested = resultset->step;
-    else
-        *req->numberOfRecordsRequested = c->tasks->u.search.count;
-
-    if (*req->numberOfRecordsRequested + c->tasks->u.search.start > resultset->size)
-        *req->numberOfRecordsRequested = resultset->size - c->tasks->u.search.start;
+    *req->resultSetStartPoint = start + 1;
+    *req->numberOfRecordsRequested = count;
     assert(*req->numberOfRecordsRequested > 0);
 
     if (syntax && *syntax)
@@ -1542,7 +1860,145 @@ static zoom_ret Z3950_send_present(ZOOM_connection c)
         req->recordComposition = compo;
     }
     req->resultSetId = odr_strdup(c->odr_out, resultset->setname);
-    return send_APDU(c, apdu);
+    return apdu;
+}
+
+/* records the next present of the task asks for */
+static int present_chunk(ZOOM_connection c)
+{
+    ZOOM_resultset resultset = c->tasks->u.search.resultset;
+    int start = c->tasks->u.search.start;
+    int count = c->tasks->u.search.count;
+
+    if (resultset->step > 0 && resultset->step < count)
+        count = resultset->step;
+    if (count + start > resultset->size)
+        count = resultset->size - start;
+    return count;
+}
+
+static zoom_ret Z3950_send_present(ZOOM_connection c)
+{
+    yaz_log(c->log_details, "%p Z3950_send_present", c);
+
+    return send_APDU(c, create_present_APDU(c, c->tasks->u.search.start,
+                                            present_chunk(c)));
+}
+
+/* The presents of a task are pipelined when the target agreed to
+   concurrent operations: its records are requested in presentChunk pieces,
+   up to "pipeline" of them outstanding at a time and sent in one buffer.
+   Each carries a referenceId to match its response with */
+static int pipeline_presents(ZOOM_connection c)
+{
+    ZOOM_resultset resultset = c->tasks->u.search.resultset;
+
+    return c->num_presents > 0 ||
+        (c->pipeline > 1 && c->concurrent_ops && resultset->step > 0
+         && resultset->step < c->tasks->u.search.count);
+}
+
+static zoom_ret Z3950_send_presents(ZOOM_connection c)
+{
+    ZOOM_resultset resultset = c->tasks->u.search.resultset;
+    int *start = &c->tasks->u.search.start;
+    int *count = &c->tasks->u.search.count;
+    int i, sent = 0;
+
+    if (c->error)
+    {
+        /* drop those not sent and wait for the rest */
+        for (i = 0; i < c->num_presents; )
+            if (!c->presents[i].refid)
+            {
+                c->num_presents--;
+                memmove(c->presents + i, c->presents + i + 1,
+                        (c->num_presents - i) * sizeof(*c->presents));
+            }
+            else
+                i++;
+    }
+    else if (c->write_pending)
+        ;   /* queued after the buffer still being written */
+    else
+    {
+        ODR odr = odr_createmem(ODR_ENCODE);
+
+        c->request_time = zoom_time();
+
+        while (*count > 0 && c->num_presents < c->pipeline)
+        {
+            struct ZOOM_present_p *p = c->presents + c->num_presents++;
+
+            p->refid = 0;
+            p->start = *start;
+            p->count = resultset->step < *count ? resultset->step : *count;
+            *start += p->count;
+            *count -= p->count;
+        }
+        for (i = 0; i < c->num_presents; i++)
+        {
+            struct ZOOM_present_p *p = c->presents + i;
+            Z_APDU *apdu;
+            char refid[20], *buf;
+            int len;
+
+            if (p->refid)
+                continue;
+            apdu = create_present_APDU(c, p->start, p->count);
+            p->refid = ++c->present_refid;
+            p->sent = c->request_time;
+            sprintf(refid, "%d", p->refid);
+            apdu->u.presentRequest->referenceId =
+                odr_create_Odr_oct(c->odr_out, refid, strlen(refid));
+            yaz_log(c->log_details, "%p Z3950_send_presents start=%d "
+                    "count=%d refid=%s", c, p->start, p->count, refid);
+            if (encode_APDU(c, apdu, odr))
+            {
+                odr_destroy(odr);
+                ZOOM_connection_close(c);
+                return zoom_complete;
+            }
+            /* appended to those before it in the buffer of odr_out */
+            buf = odr_getbuf(odr, &len, 0);
+            odr_write(c->odr_out, buf, len);
+            odr_reset(odr);
+            sent++;
+        }
+        odr_destroy(odr);
+    }
+    if (sent)
+    {
+        c->buf_out = odr_getbuf(c->odr_out, &c->len_out, 0);
+        for (i = 0; i < sent; i++)
+            ZOOM_connection_put_event(c,
+                                      ZOOM_Event_create(ZOOM_EVENT_SEND_APDU));
+        odr_reset(c->odr_out);
+        return ZOOM_send_buf(c);
+    }
+    if (!c->num_presents)
+        return zoom_complete;
+    ZOOM_connection_set_mask(c, ZOOM_SELECT_READ|ZOOM_SELECT_EXCEPT
+                             | (c->write_pending ? ZOOM_SELECT_WRITE : 0));
+    return zoom_pending;
+}
+
+/* Called when the connection is closed: the presents outstanding are not
+   answered any more, so their task goes back to the first of them */
+void ZOOM_Z3950_reset_presents(ZOOM_connection c)
+{
+    if (c->num_presents && c->tasks && c->tasks->which == ZOOM_TASK_SEARCH)
+    {
+        int *start = &c->tasks->u.search.start;
+        int *count = &c->tasks->u.search.count;
+        int i, end = *start + *count;
+
+        for (i = 0; i < c->num_presents; i++)
+            if (c->presents[i].start < *start)
+                *start = c->presents[i].start;
+        *count = end - *start;
+    }
+    c->num_presents = 0;
 }
 
 zoom_ret ZOOM_connection_Z3950_search(ZOOM_connection c)
@@ -1584,7 +2040,7 @@ zoom_ret ZOOM_connection_Z3950_search(ZOOM_connection c)
     }
 
     if (c->error)                  /* don't continue on error */
-        return zoom_complete;
+        return c->num_presents ? Z3950_send_presents(c) : zoom_complete;
 
     for (i = 0; i < *count; i++)
     {
@@ -1597,6 +2053,9 @@ zoom_ret ZOOM_connection_Z3950_search(ZOOM_connection c)
     *start += i;
     *count -= i;
 
+    if (resultset->live_set == 2 && pipeline_presents(c))
+        return Z3950_send_presents(c);
+
     if (*count == 0 && resultset->live_set)
         return zoom_complete;
 
@@ -1672,6 +2131,10 @@ void ZOOM_handle_Z3950_apdu(ZOOM_connection c, Z_APDU *apdu)
             if (ODR_MASK_GET(initrs->options, Z_Options_namedResultSets) &&
                 ODR_MASK_GET(initrs->protocolVersion, Z_ProtocolVersion_3))
                 c->support_named_resultsets = 1;
+            c->concurrent_ops =
+                ODR_MASK_GET(initrs->options, Z_Options_concurrentOperations);
+            c->message_size = initrs->preferredMessageSize ?
+                (int) *initrs->preferredMessageSize : 0;
             if (c->tasks)
             {
                 assert(c->tasks->which == ZOOM_TASK_CONNECT);
@@ -0,0 +1,203 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* Micro-benchmark for the NMEM block pool.
+
+   Encodes a present response with 20 copies of each ISO2709 record in the
+   files given and decodes it over and over on one ODR, as a connection
+   does for each response. Counts the NMEM blocks taken per decode and how
+   many of those came from malloc rather than the per-thread pool, then
+   times the decodes.
+
+   bench_nmem [-n rounds] file.marc ..
+*/
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yaz/log.h>
+#include <yaz/marcdisp.h>
+#include <yaz/oid_db.h>
+#include <yaz/proto.h>
+#include <yaz/timing.h>
+#include <yaz/wrbuf.h>
+
+#define COPIES 20
+
+struct counts {
+    long blocks;    /* get_block calls */
+    long mallocs;   /* of those, blocks not found in the pool */
+};
+
+/* nmem logs each get_block, and each malloc it does for one */
+static void count_log(int level, const char *msg, void *info)
+{
+    struct counts *c = (struct counts *) info;
+
+    if (strstr(msg, "nmem get_block size="))
+        c->blocks++;
+    else if (strstr(msg, "nmem get_block alloc new block"))
+        c->mallocs++;
+}
+
+static void read_records(WRBUF recs, int *num, const char *fname)
+{
+    FILE *f = fopen(fname, "rb");
+    char tmp[4096];
+    size_t n;
+
+    if (!f)
+    {
+        perror(fname);
+        exit(1);
+    }
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+        wrbuf_write(recs, tmp, n);
+    fclose(f);
+    (*num)++;
+}
+
+/* present response with COPIES of every record in recs */
+static void encode_response(ODR enc, WRBUF recs, char **buf, int *len)
+{
+    Z_APDU *apdu = zget_APDU(enc, Z_APDU_presentResponse);
+    Z_Records *records = (Z_Records *) odr_malloc(enc, sizeof(*records));
+    Z_NamePlusRecordList *list = (Z_NamePlusRecordList *)
+        odr_malloc(enc, sizeof(*list));
+    yaz_marc_t mt = yaz_marc_create();
+    size_t off = 0;
+    int max = 0;
+
+    list->num_records = 0;
+    list->records = 0;
+    while (off < wrbuf_len(recs))
+    {
+        int r = yaz_marc_read_iso2709(mt, wrbuf_buf(recs) + off,
+                                      wrbuf_len(recs) - off);
+        int i;
+
+        if (r <= 0)
+            break;
+        for (i = 0; i < COPIES; i++)
+        {
+            Z_NamePlusRecord *npr = (Z_NamePlusRecord *)
+                odr_malloc(enc, sizeof(*npr));
+
+            if (list->num_records == max)
+            {
+                Z_NamePlusRecord **old = list->records;
+
+                max = max ? 2 * max : 64;
+                list->records = (Z_NamePlusRecord **)
+                    odr_malloc(enc, max * sizeof(*list->records));
+                if (old)
+                    memcpy(list->records, old,
+                           list->num_records * sizeof(*old));
+            }
+            npr->databaseName = 0;
+            npr->which = Z_NamePlusRecord_databaseRecord;
+            npr->u.databaseRecord =
+                z_ext_record_oid(enc, yaz_oid_recsyn_usmarc,
+                                 wrbuf_buf(recs) + off, r);
+            list->records[list->num_records++] = npr;
+        }
+        off += r;
+    }
+    yaz_marc_destroy(mt);
+
+    records->which = Z_Records_DBOSD;
+    records->u.databaseOrSurDiagnostics = list;
+    apdu->u.presentResponse->records = records;
+    *apdu->u.presentResponse->numberOfRecordsReturned = list->num_records;
+    if (!z_APDU(enc, &apdu, 0, 0))
+    {
+        fprintf(stderr, "encoding failed\n");
+        exit(1);
+    }
+    *buf = odr_getbuf(enc, len, 0);
+}
+
+static void decode(ODR dec, char *buf, int len)
+{
+    Z_APDU *apdu;
+
+    odr_setbuf(dec, buf, len, 0);
+    if (!z_APDU(dec, &apdu, 0, 0))
+    {
+        fprintf(stderr, "decoding failed\n");
+        exit(1);
+    }
+    odr_reset(dec);
+}
+
+int main(int argc, char **argv)
+{
+    struct counts c = { 0, 0 };
+    int level = yaz_log_mask_str("");
+    int rounds = 20000;
+    int num = 0;
+    int i = 1;
+    WRBUF recs = wrbuf_alloc();
+    yaz_timing_t t;
+    ODR enc, dec;
+    char *buf;
+    int len;
+
+    if (i + 1 < argc && !strcmp(argv[i], "-n"))
+    {
+        rounds = atoi(argv[i + 1]);
+        i += 2;
+    }
+    if (i == argc)
+    {
+        fprintf(stderr, "usage: %s [-n rounds] file.marc ..\n", argv[0]);
+        exit(1);
+    }
+    /* nmem reads its log level once, so it is set before any NMEM;
+       the messages only go to count_log */
+    yaz_log_init_file(0);
+    yaz_log_init_level(yaz_log_mask_str_x("nmem", level));
+    yaz_log_set_handler(count_log, &c);
+
+    for (; i < argc; i++)
+        read_records(recs, &num, argv[i]);
+    enc = odr_createmem(ODR_ENCODE);
+    dec = odr_createmem(ODR_DECODE);
+    encode_response(enc, recs, &buf, &len);
+
+    decode(dec, buf, len);
+    c.blocks = c.mallocs = 0;
+    for (i = 0; i < rounds; i++)
+        decode(dec, buf, len);
+    yaz_log_init_level(level);
+
+    printf("%d files, response of %d bytes, %d rounds\n", num, len, rounds);
+    printf("blocks per decode %.2f, of which from malloc %.4f\n",
+           (double) c.blocks / rounds, (double) c.mallocs / rounds);
+
+    t = yaz_timing_create();
+    for (i = 0; i < rounds; i++)
+        decode(dec, buf, len);
+    yaz_timing_stop(t);
+    printf("%.1f us per decode\n", yaz_timing_get_real(t) * 1e6 / rounds);
+    yaz_timing_destroy(&t);
+
+    odr_destroy(dec);
+    odr_destroy(enc);
+    wrbuf_destroy(recs);
+    return 0;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
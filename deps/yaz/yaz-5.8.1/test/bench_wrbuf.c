@@ -0,0 +1,250 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* Micro-benchmark for the JSON and XML escaping of WRBUF.
+
+   Compares wrbuf_json_write and wrbuf_xmlputs_n with the byte-at-a-time
+   versions they replaced, on the field and subfield values of the ISO2709
+   records in the files given, and checks that both produce the same output.
+
+   bench_wrbuf [-n rounds] file.marc ..
+*/
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yaz/marcdisp.h>
+#include <yaz/timing.h>
+#include <yaz/wrbuf.h>
+
+struct values {
+    WRBUF data;     /* all values, back to back */
+    size_t *len;
+    int num;
+    int max;
+};
+
+static void add_value(struct values *v, const char *buf, size_t len)
+{
+    if (v->num == v->max)
+    {
+        v->max = v->max ? 2 * v->max : 1024;
+        v->len = (size_t *) xrealloc(v->len, v->max * sizeof(*v->len));
+    }
+    wrbuf_write(v->data, buf, len);
+    v->len[v->num++] = len;
+}
+
+static void visit_controlfield(void *data, const char *tag,
+                               const char *value, size_t value_len)
+{
+    add_value((struct values *) data, value, value_len);
+}
+
+static void visit_subfield(void *data, const char *code, size_t code_len,
+                           const char *value, size_t value_len)
+{
+    add_value((struct values *) data, value, value_len);
+}
+
+static void read_values(struct values *v, const char *fname)
+{
+    struct yaz_marc_visitor visitor;
+    yaz_marc_t mt = yaz_marc_create();
+    FILE *f = fopen(fname, "rb");
+    WRBUF buf = wrbuf_alloc();
+    char tmp[4096];
+    size_t n, off = 0;
+
+    if (!f)
+    {
+        perror(fname);
+        exit(1);
+    }
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+        wrbuf_write(buf, tmp, n);
+    fclose(f);
+
+    memset(&visitor, 0, sizeof(visitor));
+    visitor.controlfield = visit_controlfield;
+    visitor.subfield = visit_subfield;
+    while (off < wrbuf_len(buf))
+    {
+        int r = yaz_marc_read_iso2709(mt, wrbuf_buf(buf) + off,
+                                      wrbuf_len(buf) - off);
+        if (r <= 0)
+            break;
+        yaz_marc_visit(mt, &visitor, v);
+        off += r;
+    }
+    wrbuf_destroy(buf);
+    yaz_marc_destroy(mt);
+}
+
+/* wrbuf_xmlputs_n as it was, one byte at a time */
+static void ref_xmlputs_n(WRBUF b, const char *cp, size_t size)
+{
+    for (; size; size--)
+    {
+        if (*cp >= 0 && *cp <= 31)
+            if (*cp != 9 && *cp != 10 && *cp != 13)
+            {
+                cp++;
+                continue;
+            }
+        switch(*cp)
+        {
+        case '<':
+            wrbuf_puts(b, "&lt;");
+            break;
+        case '>':
+            wrbuf_puts(b, "&gt;");
+            break;
+        case '&':
+            wrbuf_puts(b, "&amp;");
+            break;
+        case '"':
+            wrbuf_puts(b, "&quot;");
+            break;
+        case '\'':
+            wrbuf_puts(b, "&apos;");
+            break;
+        default:
+            wrbuf_putc(b, *cp);
+        }
+        cp++;
+    }
+}
+
+/* wrbuf_json_write as it was, one byte at a time */
+static void ref_json_write(WRBUF b, const char *cp, size_t sz)
+{
+    size_t i;
+    for (i = 0; i < sz; i++)
+    {
+        if (cp[i] > 0 && cp[i] < 32)
+        {
+            wrbuf_putc(b, '\\');
+            switch (cp[i])
+            {
+            case '\b': wrbuf_putc(b, 'b'); break;
+            case '\f': wrbuf_putc(b, 'f'); break;
+            case '\n': wrbuf_putc(b, 'n'); break;
+            case '\r': wrbuf_putc(b, 'r'); break;
+            case '\t': wrbuf_putc(b, 't'); break;
+            default:
+                wrbuf_printf(b, "u%04x", cp[i]);
+            }
+        }
+        else if (cp[i] == '"')
+        {
+            wrbuf_putc(b, '\\'); wrbuf_putc(b, '"');
+        }
+        else if (cp[i] == '\\')
+        {
+            wrbuf_putc(b, '\\'); wrbuf_putc(b, '\\');
+        }
+        else
+            wrbuf_putc(b, cp[i]);
+    }
+}
+
+typedef void (*escape_func)(WRBUF b, const char *cp, size_t sz);
+
+static void escape_all(struct values *v, WRBUF w, escape_func f)
+{
+    const char *cp = wrbuf_buf(v->data);
+    int i;
+
+    wrbuf_rewind(w);
+    for (i = 0; i < v->num; i++)
+    {
+        f(w, cp, v->len[i]);
+        cp += v->len[i];
+    }
+}
+
+static double bench(struct values *v, WRBUF w, escape_func f, int rounds)
+{
+    yaz_timing_t t = yaz_timing_create();
+    double secs;
+    int i;
+
+    for (i = 0; i < rounds; i++)
+        escape_all(v, w, f);
+    yaz_timing_stop(t);
+    secs = yaz_timing_get_real(t);
+    yaz_timing_destroy(&t);
+    return secs;
+}
+
+static void run(struct values *v, const char *name,
+                escape_func ref, escape_func cur, int rounds)
+{
+    WRBUF w1 = wrbuf_alloc();
+    WRBUF w2 = wrbuf_alloc();
+    double mb = (double) wrbuf_len(v->data) * rounds / 1e6;
+    double t_ref, t_cur;
+
+    escape_all(v, w1, ref);
+    escape_all(v, w2, cur);
+    if (wrbuf_len(w1) != wrbuf_len(w2)
+        || memcmp(wrbuf_buf(w1), wrbuf_buf(w2), wrbuf_len(w1)))
+    {
+        fprintf(stderr, "%s: output differs from reference\n", name);
+        exit(1);
+    }
+    t_ref = bench(v, w1, ref, rounds);
+    t_cur = bench(v, w2, cur, rounds);
+    printf("%-5s reference %8.1f MB/s  current %8.1f MB/s  x%.1f\n",
+           name, mb / t_ref, mb / t_cur, t_ref / t_cur);
+    wrbuf_destroy(w1);
+    wrbuf_destroy(w2);
+}
+
+int main(int argc, char **argv)
+{
+    struct values v;
+    int rounds = 200;
+    int i = 1;
+
+    if (i + 1 < argc && !strcmp(argv[i], "-n"))
+    {
+        rounds = atoi(argv[i + 1]);
+        i += 2;
+    }
+    if (i == argc)
+    {
+        fprintf(stderr, "usage: %s [-n rounds] file.marc ..\n", argv[0]);
+        exit(1);
+    }
+    v.data = wrbuf_alloc();
+    v.len = 0;
+    v.num = v.max = 0;
+    for (; i < argc; i++)
+        read_values(&v, argv[i]);
+    printf("%d values, %ld bytes, %d rounds\n", v.num,
+           (long) wrbuf_len(v.data), rounds);
+
+    run(&v, "json", ref_json_write, wrbuf_json_write, rounds);
+    run(&v, "xml", ref_xmlputs_n, wrbuf_xmlputs_n, rounds);
+
+    wrbuf_destroy(v.data);
+    xfree(v.len);
+    return 0;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
+
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <yaz/log.h>
 #include <yaz/test.h>
 #include <yaz/comstack.h>
 #include <yaz/tcpip.h>
@@ -204,6 +205,130 @@ static void tst_http_response(void)
     }
 }
 
+/* feeds buf to cs_complete_auto_r in pieces of step bytes, the first
+   piece being first bytes, as recv would; each result must be the one
+   cs_complete_auto gives for the same prefix, up to the first non-zero */
+static int complete_r_split(const char *buf, int len, int first, int step)
+{
+    struct cs_complete_state st;
+    int n = first;
+
+    cs_complete_reset(&st);
+    while (1)
+    {
+        int r = cs_complete_auto_r(&st, buf, n);
+        if (r != cs_complete_auto(buf, n))
+        {
+            yaz_log(YLOG_WARN, "len=%d first=%d step=%d: %d != %d at %d",
+                    len, first, step, r, cs_complete_auto(buf, n), n);
+            return 0;
+        }
+        if (r || n == len)
+            return 1;
+        n = n + step > len ? len : n + step;
+    }
+}
+
+static void tst_complete_r_buf(const char *buf, int len)
+{
+    int first, step;
+
+    /* PDU to be complete at all */
+    YAZ_CHECK(cs_complete_auto(buf, len));
+    for (step = 1; step <= len; step++)
+        YAZ_CHECK(complete_r_split(buf, len, step, step));
+    for (first = 1; first < len; first++)
+        YAZ_CHECK(complete_r_split(buf, len, first, len));
+}
+
+static void tst_complete_r_str(const char *buf)
+{
+    tst_complete_r_buf(buf, strlen(buf));
+}
+
+static void tst_complete_r(void)
+{
+    /* BER: definite, long form length, multi-byte tag, indefinite
+       nested, definite inside indefinite, and each followed by the next
+       PDU */
+    static const char ber_def[] = {
+        0x30, 0x06, 0x02, 0x01, 0x05, 0x04, 0x01, 'a',
+        0x30, 0x03, 0x02, 0x01, 0x06 };
+    static const char ber_tag[] = {
+        0xbf, 0x81, 0x01, 0x05, 0x9f, 0x82, 0x7f, 0x01, 0x00,
+        0x02, 0x01, 0x00 };
+    static const char ber_indef[] = {
+        0x30, 0x80, 0xa1, 0x80, 0x02, 0x01, 0x01, 0x30, 0x80, 0x00, 0x00,
+        0x00, 0x00, 0x04, 0x02, 'a', 'b', 0xa2, 0x03, 0x02, 0x01, 0x07,
+        0x00, 0x00,
+        0x30, 0x80, 0x00, 0x00 };
+    /* indefinite length for a primitive is an error */
+    static const char ber_bad[] = {
+        0x30, 0x80, 0x04, 0x80, 'a', 0x00, 0x00, 0x00, 0x00 };
+    char ber_long[300];
+    int i;
+
+    ber_long[0] = 0x30;
+    ber_long[1] = 0x82;
+    ber_long[2] = 0x01;
+    ber_long[3] = 0x10;
+    for (i = 4; i < 276; i += 2)
+    {
+        ber_long[i] = 0x04;
+        ber_long[i + 1] = 0x00;
+    }
+    ber_long[276] = 0x30;
+    ber_long[277] = 0x00;
+
+    tst_complete_r_buf(ber_def, sizeof(ber_def));
+    tst_complete_r_buf(ber_tag, sizeof(ber_tag));
+    tst_complete_r_buf(ber_indef, sizeof(ber_indef));
+    tst_complete_r_buf(ber_bad, sizeof(ber_bad));
+    tst_complete_r_buf(ber_long, 278);
+    tst_complete_r_buf(ber_long, 276);
+
+    /* HTTP header only */
+    tst_complete_r_str("GET / HTTP/1.1\r\n"
+                       "Host: localhost\r\n"
+                       "\r\n"
+                       "GET / HTTP/1.1\r\n");
+    tst_complete_r_str("HTTP/1.1 204 OK\r\n"
+                       "\r\n");
+    tst_complete_r_str("HTTP/1.1 304 Not Modified\r\n"
+                       "ETag: \"x\"\r\n"
+                       "\r\n"
+                       "HTTP/1.1 200 OK\r\n");
+    /* HTTP content length */
+    tst_complete_r_str("POST / HTTP/1.1\r\n"
+                       "Content-Type: text/xml\r\n"
+                       "Content-Length: 12\r\n"
+                       "\r\n"
+                       "<a>\r\n\r\n</a>"
+                       "HTTP/1.1 200 OK\r\n");
+    tst_complete_r_str("HTTP/1.1 200 OK\r\n"
+                       "content-length:   0\r\n"
+                       "\r\n");
+    /* HTTP chunked, with extension and trailers */
+    tst_complete_r_str("HTTP/1.1 200 OK\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "4\r\n"
+                       "ab\r\n\r\n"
+                       "1A;x=y\r\n"
+                       "0123456789abcdefghijklmnop\r\n"
+                       "0\r\n"
+                       "\r\n"
+                       "HTTP/1.1 200 OK\r\n");
+    tst_complete_r_str("HTTP/1.1 200 OK\r\n"
+                       "Transfer-Encoding: chunked\r\n"
+                       "\r\n"
+                       "a\r\n"
+                       "0123456789\r\n"
+                       "0\r\n"
+                       "Expires: 0\r\n"
+                       "\r\n");
+}
+
 /** \brief COMSTACK synopsis from manual, doc/comstack.xml */
 static int comstack_example(const char *server_address_str)
 {
@@ -275,6 +400,7 @@ int main (int argc, char **argv)
        comstack_example(argv[1]);
     tst_http_request();
     tst_http_response();
+    tst_complete_r();
     YAZ_CHECK_TERM;
 }
 
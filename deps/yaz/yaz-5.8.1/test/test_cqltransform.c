@@ -0,0 +1,207 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* Property lookup of CQL transforms: patterns are matched without regard
+   to case, the first definition of a pattern wins, and the reverse
+   lookup and set URIs only see patterns whose category prefix matches
+   exactly. Checked for small tables and for ones that had to grow; the
+   expected results are those of the linear scan the hash table replaced. */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <yaz/cql.h>
+#include <yaz/log.h>
+#include <yaz/pquery.h>
+#include <yaz/rpn2cql.h>
+#include <yaz/test.h>
+#include <yaz/wrbuf.h>
+
+static const char *props[][2] = {
+    { "set.cql", "info:srw/cql-context-set/1/cql-v1.2" },
+    { "set.dc", "info:srw/cql-context-set/1/dc-v1.1" },
+    { "set", "info:srw/cql-context-set/1/dc-v1.1" },
+    { "SET.Bath", "http://zing.z3950.org/cql/bath/2.0/" },
+    { "set.bib", "info:srw/cql-context-set/1/bib-v1" },
+    { "set.bib2", "info:srw/cql-context-set/1/bib-v1" },
+    { "set.x", "http://example.com/x" },
+    { "index.cql.serverChoice", "1=1016" },
+    { "index.dc.title", "1=4" },
+    { "index.dc.title", "1=5" },
+    { "Index.DC.Creator", "1=1003" },
+    { "index.dc.creator", "1=9999" },
+    { "index.dc.subject", "1=21" },
+    { "INDEX.dc.subject", "1=29" },
+    { "index.bath.isbn", "1=7" },
+    { "index.bib.name", "1=1002" },
+    { "index.dc.date", "1=30 4=5" },
+    { "index.dc.identifier", "1=12 4=1" },
+    { "relation.<", "2=1" },
+    { "relation.le", "2=2" },
+    { "relation.eq", "2=3" },
+    { "relation.EQ", "2=103" },
+    { "relation.ge", "2=4" },
+    { "relation.>", "2=5" },
+    { "Relation.Exact", "2=3 6=3" },
+    { "relation.scr", "2=3" },
+    { "relation.all", "2=3" },
+    { "relation.any", "2=3" },
+    { "structure.exact", "4=108" },
+    { "structure.all", "4=2" },
+    { "structure.any", "4=2" },
+    { "structure.*", "4=1" },
+    { "STRUCTURE.eq", "4=3" },
+    { "position.first", "3=1 6=1" },
+    { "position.any", "3=3 6=1" },
+    { "truncation.right", "5=1" },
+    { "truncation.none", "5=100" },
+    { "always", "" },
+    { 0, 0 }
+};
+
+/* attributes added for every term: structure.*, position.any and
+   truncation.none */
+#define D "@attr 4=1 @attr 3=3 @attr 6=1 @attr 5=100 "
+
+/* extra index entries so the pattern table has to grow */
+#define FILLER 500
+
+static cql_transform_t create(int filler)
+{
+    cql_transform_t ct = cql_transform_create();
+    int i;
+
+    for (i = 0; props[i][0]; i++)
+        YAZ_CHECK_EQ(cql_transform_define_pattern(ct, props[i][0],
+                                                  props[i][1]), 0);
+    for (i = 0; i < filler; i++)
+    {
+        char pattern[40], value[40];
+
+        sprintf(pattern, "index.x.Field%d", i);
+        sprintf(value, "1=%d", 5000 + i);
+        YAZ_CHECK_EQ(cql_transform_define_pattern(ct, pattern, value), 0);
+    }
+    return ct;
+}
+
+/* CQL to PQF; expected 0 for a transform error */
+static int forward(cql_transform_t ct, const char *cql, const char *expected)
+{
+    CQL_parser cp = cql_parser_create();
+    const char *addinfo = 0;
+    char out[1024];
+    int ret = 0;
+
+    if (cql_parser_string(cp, cql))
+        yaz_log(YLOG_WARN, "%s: parse error", cql);
+    else if (cql_transform_buf(ct, cql_parser_result(cp), out, sizeof(out)))
+    {
+        ret = !expected;
+        if (!ret)
+            yaz_log(YLOG_WARN, "%s: error %d, expected %s", cql,
+                    cql_transform_error(ct, &addinfo), expected);
+    }
+    else if (expected && !strcmp(out, expected))
+        ret = 1;
+    else
+        yaz_log(YLOG_WARN, "%s: got %s, expected %s", cql, out,
+                expected ? expected : "error");
+    cql_parser_destroy(cp);
+    return ret;
+}
+
+/* PQF to CQL; expected 0 for a transform error */
+static int reverse(cql_transform_t ct, const char *pqf, const char *expected)
+{
+    ODR odr = odr_createmem(ODR_ENCODE);
+    WRBUF w = wrbuf_alloc();
+    Z_RPNQuery *q = p_query_rpn(odr, pqf);
+    int ret = 0;
+
+    if (!q)
+        yaz_log(YLOG_WARN, "%s: bad PQF", pqf);
+    else if (cql_transform_rpn2cql_wrbuf(ct, w, q))
+    {
+        ret = !expected;
+        if (!ret)
+            yaz_log(YLOG_WARN, "%s: error, expected %s", pqf, expected);
+    }
+    else if (expected && !strcmp(wrbuf_cstr(w), expected))
+        ret = 1;
+    else
+        yaz_log(YLOG_WARN, "%s: got %s, expected %s", pqf, wrbuf_cstr(w),
+                expected ? expected : "error");
+    wrbuf_destroy(w);
+    odr_destroy(odr);
+    return ret;
+}
+
+static void tst(int filler)
+{
+    cql_transform_t ct = create(filler);
+
+    /* first definition wins */
+    YAZ_CHECK(forward(ct, "dc.title=x", "@attr 2=3 " D "@attr 1=4 \"x\" "));
+    YAZ_CHECK(forward(ct, "dc.subject=x", "@attr 2=3 " D "@attr 1=21 \"x\" "));
+    /* patterns match whatever the case of file or query */
+    YAZ_CHECK(forward(ct, "dc.creator=x",
+                      "@attr 2=3 " D "@attr 1=1003 \"x\" "));
+    YAZ_CHECK(forward(ct, "DC.CREATOR=x",
+                      "@attr 2=3 " D "@attr 1=1003 \"x\" "));
+    YAZ_CHECK(forward(ct, "dc.title==x",
+                      "@attr 2=3 @attr 6=3 " D "@attr 1=4 \"x\" "));
+    YAZ_CHECK(forward(ct, "dc.title all x",
+                      "@attr 2=3 @attr 4=2 @attr 3=3 @attr 6=1 @attr 5=100 "
+                      "@attr 1=4 \"x\" "));
+    YAZ_CHECK(forward(ct, "bib.name=x", "@attr 2=3 " D "@attr 1=1002 \"x\" "));
+    YAZ_CHECK(forward(ct, "x", "@attr 2=3 " D "@attr 1=1016 \"x\" "));
+    YAZ_CHECK(forward(ct, "title=x", "@attr 2=3 " D "@attr 1=4 \"x\" "));
+    YAZ_CHECK(forward(ct, "dc.date>2000",
+                      "@attr 2=5 " D "@attr 1=30 @attr 4=5 \"2000\" "));
+    YAZ_CHECK(forward(ct, "dc.nosuch=x", 0));
+    /* but a set must be defined with a lower-case "set." */
+    YAZ_CHECK(forward(ct, "bath.isbn=1", 0));
+    YAZ_CHECK(forward(ct, "x.field1=y",
+                      filler ? "@attr 2=3 " D "@attr 1=5001 \"y\" " : 0));
+    YAZ_CHECK(forward(ct, "X.FIELD499=y",
+                      filler ? "@attr 2=3 " D "@attr 1=5499 \"y\" " : 0));
+    YAZ_CHECK(forward(ct, "x.field500=y", 0));
+
+    /* reverse lookup takes the first entry with an exact "index." prefix
+       whose attributes all match */
+    YAZ_CHECK(reverse(ct, "@attr 1=4 x", "dc.title=x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=5 x", "dc.title=x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=1003 x", 0));
+    YAZ_CHECK(reverse(ct, "@attr 1=9999 x", "dc.creator=x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=21 x", "dc.subject=x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=29 x", 0));
+    YAZ_CHECK(reverse(ct, "@attr 1=12 @attr 4=1 x", "dc.identifier=x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=12 x", 0));
+    YAZ_CHECK(reverse(ct, "@attr 1=4 @attr 2=1 x", "dc.title<x"));
+    YAZ_CHECK(reverse(ct, "@attr 1=4 @attr 2=103 x", "dc.titleEQx"));
+    YAZ_CHECK(reverse(ct, "@attr 1=5123 x", filler ? "x.Field123=x" : 0));
+    cql_transform_close(ct);
+}
+
+int main (int argc, char **argv)
+{
+    YAZ_CHECK_INIT(argc, argv);
+    YAZ_CHECK_LOG();
+    tst(0);
+    tst(FILLER);
+    YAZ_CHECK_TERM;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
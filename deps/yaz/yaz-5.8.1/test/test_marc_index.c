@@ -0,0 +1,238 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* yaz_marc_index_iso2709 must find the fields and subfields that
+   yaz_marc_read_iso2709 reads. Each record of the marc?.marc files is
+   read both ways, as is, cut short and with each of its bytes replaced
+   by digits, letters and separators. The index is turned back into MARC
+   nodes, taking tags from the directory, and both are compared in line
+   format, without comments. */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yaz/log.h>
+#include <yaz/marcdisp.h>
+#include <yaz/snprintf.h>
+#include <yaz/test.h>
+#include <yaz/wrbuf.h>
+#include <yaz/yaz-iconv.h>
+
+/* line format of mt, leaving out comments */
+static void write_lines(yaz_marc_t mt, WRBUF w)
+{
+    WRBUF lines = wrbuf_alloc();
+    const char *cp;
+
+    yaz_marc_write_line(mt, lines);
+    for (cp = wrbuf_cstr(lines); *cp; )
+    {
+        const char *nl = strchr(cp, '\n');
+        size_t len = nl ? nl - cp + 1 : strlen(cp);
+
+        if (*cp != '(')
+            wrbuf_write(w, cp, len);
+        cp += len;
+    }
+    wrbuf_destroy(lines);
+}
+
+/* MARC nodes for record r of idx; 0 if a tag is wrong */
+static int index_to_marc(yaz_marc_index_t idx, int r, const char *buf,
+                         yaz_marc_t mt)
+{
+    const char *rec = buf + idx->record_offset[r];
+    int indicator_length, identifier_length, base_address;
+    int length_data_entry, length_starting, length_implementation;
+    int f, entry_p = 24;
+
+    yaz_marc_reset(mt);
+    yaz_marc_set_leader(mt, rec,
+                        &indicator_length, &identifier_length,
+                        &base_address, &length_data_entry,
+                        &length_starting, &length_implementation);
+    /* a field for each directory entry, until the first bad one */
+    for (f = idx->record_field[r]; f < idx->record_field[r + 1]; f++)
+    {
+        int s = idx->field_subfield[f];
+        char tag[4];
+
+        memcpy(tag, rec + entry_p, 3);
+        tag[3] = '\0';
+        entry_p += 3 + length_data_entry + length_starting;
+        if (idx->field_tag[f] !=
+            (yaz_isdigit(tag[0]) && yaz_isdigit(tag[1]) && yaz_isdigit(tag[2])
+             ? atoi(tag) : -1))
+            return 0;
+        /* as yaz_marc_read_iso2709 tells 00X control fields from data
+           fields, ignoring skipped bytes in indicators */
+        if (s == idx->field_subfield[f + 1] && !memcmp(tag, "00", 2)
+            && (indicator_length >= 4 ||
+                buf[idx->field_offset[f] + indicator_length] != ISO2709_IDFS))
+            yaz_marc_add_controlfield(mt, tag, buf + idx->field_offset[f],
+                                      idx->field_length[f]);
+        else
+        {
+            yaz_marc_add_datafield(mt, tag, buf + idx->field_offset[f],
+                                   indicator_length);
+            for (; s < idx->field_subfield[f + 1]; s++)
+                yaz_marc_add_subfield(mt, buf + idx->subfield_offset[s],
+                                      idx->subfield_length[s]);
+        }
+    }
+    return 1;
+}
+
+/* reads buf + off both ways; 1 if they agree */
+static int compare(yaz_marc_index_t idx, const char *buf, int off, int bsize)
+{
+    yaz_marc_t mt = yaz_marc_create();
+    int r = idx->num_records;
+    int read_ret = yaz_marc_read_iso2709(mt, buf + off, bsize);
+    int index_ret = yaz_marc_index_iso2709(idx, buf, off, bsize);
+    int ret = 0;
+
+    if (read_ret != index_ret)
+        yaz_log(YLOG_WARN, "offset %d size %d: read %d, index %d",
+                off, bsize, read_ret, index_ret);
+    else if (idx->num_records != r + 1)
+        yaz_log(YLOG_WARN, "offset %d size %d: %d records",
+                off, bsize, idx->num_records);
+    else if (index_ret <= 0)
+    {
+        ret = idx->record_offset[r] == -1
+            && idx->record_field[r + 1] == idx->record_field[r];
+        if (!ret)
+            yaz_log(YLOG_WARN, "offset %d size %d: bad record indexed",
+                    off, bsize);
+    }
+    else
+    {
+        yaz_marc_t mt_idx = yaz_marc_create();
+        WRBUF w_read = wrbuf_alloc();
+        WRBUF w_idx = wrbuf_alloc();
+
+        if (!index_to_marc(idx, r, buf, mt_idx))
+            yaz_log(YLOG_WARN, "offset %d size %d: bad tag", off, bsize);
+        else
+        {
+            write_lines(mt, w_read);
+            write_lines(mt_idx, w_idx);
+            ret = !strcmp(wrbuf_cstr(w_read), wrbuf_cstr(w_idx));
+            if (!ret)
+                yaz_log(YLOG_WARN, "offset %d size %d:\n%s---\n%s",
+                        off, bsize, wrbuf_cstr(w_read), wrbuf_cstr(w_idx));
+        }
+        wrbuf_destroy(w_idx);
+        wrbuf_destroy(w_read);
+        yaz_marc_destroy(mt_idx);
+    }
+    yaz_marc_destroy(mt);
+    return ret;
+}
+
+static int read_file(WRBUF w, const char *srcdir, int no)
+{
+    char fname[1024];
+    char tmp[4096];
+    size_t n;
+    FILE *f;
+
+    yaz_snprintf(fname, sizeof(fname), "%s/marc%d.marc", srcdir, no);
+    f = fopen(fname, "rb");
+    if (!f)
+        return 0;
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+        wrbuf_write(w, tmp, n);
+    fclose(f);
+    return 1;
+}
+
+/* the records of a file, indexed one after the other */
+static void tst_file(const char *buf, int len)
+{
+    yaz_marc_index_t idx = yaz_marc_index_create();
+    int off = 0;
+
+    while (off < len)
+    {
+        int r = idx->num_records;
+        YAZ_CHECK(compare(idx, buf, off, len - off));
+        if (idx->record_offset[r] == -1)
+            break;
+        off += atoi_n(buf + off, 5);
+    }
+    /* a reset index starts over with the same result */
+    yaz_marc_index_reset(idx);
+    YAZ_CHECK(compare(idx, buf, 0, len));
+    YAZ_CHECK(compare(idx, buf, 0, -1));
+    yaz_marc_index_destroy(idx);
+}
+
+/* the first record of a file, cut short and with one byte replaced */
+static void tst_malformed(const char *rec, int len)
+{
+    static const char subst[] = {
+        '0', '9', 'x', ' ', ISO2709_RS, ISO2709_FS, ISO2709_IDFS };
+    yaz_marc_index_t idx = yaz_marc_index_create();
+    char *buf = (char *) xmalloc(len);
+    int i, j, failed = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        if (!compare(idx, rec, 0, i))
+            failed++;
+        for (j = 0; j < (int) sizeof(subst); j++)
+        {
+            memcpy(buf, rec, len);
+            buf[i] = subst[j];
+            if (!compare(idx, buf, 0, len))
+                failed++;
+        }
+        yaz_marc_index_reset(idx);
+    }
+    YAZ_CHECK_EQ(failed, 0);
+    xfree(buf);
+    yaz_marc_index_destroy(idx);
+}
+
+int main (int argc, char **argv)
+{
+    const char *srcdir = getenv("srcdir");
+    int i;
+
+    YAZ_CHECK_INIT(argc, argv);
+    YAZ_CHECK_LOG();
+    for (i = 1; i < 10; i++)
+    {
+        WRBUF w = wrbuf_alloc();
+
+        if (read_file(w, srcdir ? srcdir : ".", i))
+        {
+            int len = wrbuf_len(w);
+            int rec_len = atoi_n(wrbuf_buf(w), 5);
+
+            tst_file(wrbuf_buf(w), len);
+            if (rec_len >= 25 && rec_len <= len)
+                tst_malformed(wrbuf_buf(w), rec_len);
+        }
+        else
+            YAZ_CHECK(0);
+        wrbuf_destroy(w);
+    }
+    YAZ_CHECK_TERM;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
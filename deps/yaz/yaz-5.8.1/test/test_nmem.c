@@ -45,6 +45,63 @@ void tst_nmem_malloc(void)
     nmem_destroy(n);
 }
 
+/* sizes of the blocks n takes for num runs of 16 byte allocations; a run
+   ends where an allocation no longer follows the one before it */
+static void block_sizes(NMEM n, size_t *sizes, int num)
+{
+    char *prev = (char *) nmem_malloc(n, 16);
+    int i;
+
+    for (i = 0; i < num; i++)
+    {
+        char *cp;
+
+        sizes[i] = 16;
+        while ((cp = (char *) nmem_malloc(n, 16)) == prev + 16)
+        {
+            sizes[i] += 16;
+            prev = cp;
+        }
+        prev = cp;
+    }
+}
+
+void tst_nmem_growth(void)
+{
+    NMEM n = nmem_create();
+    size_t sizes[5];
+
+    /* each block is four times the one before, up to 64K */
+    block_sizes(n, sizes, 5);
+    YAZ_CHECK_EQ(sizes[0], 4096);
+    YAZ_CHECK_EQ(sizes[1], 16384);
+    YAZ_CHECK_EQ(sizes[2], 65536);
+    YAZ_CHECK_EQ(sizes[3], 65536);
+    YAZ_CHECK_EQ(sizes[4], 65536);
+
+    /* a reset starts over with small blocks */
+    nmem_reset(n);
+    YAZ_CHECK_EQ(nmem_total(n), 0);
+    block_sizes(n, sizes, 3);
+    YAZ_CHECK_EQ(sizes[0], 4096);
+    YAZ_CHECK_EQ(sizes[1], 16384);
+    YAZ_CHECK_EQ(sizes[2], 65536);
+
+    /* a large request gets a block of its own size */
+    nmem_reset(n);
+    YAZ_CHECK(nmem_malloc(n, 200000));
+    block_sizes(n, sizes, 1);
+    YAZ_CHECK_EQ(sizes[0], 16384);
+    nmem_destroy(n);
+
+    /* blocks pooled by the NMEMs above do not change the sizes */
+    n = nmem_create();
+    block_sizes(n, sizes, 2);
+    YAZ_CHECK_EQ(sizes[0], 4096);
+    YAZ_CHECK_EQ(sizes[1], 16384);
+    nmem_destroy(n);
+}
+
 void tst_nmem_strsplit(void)
 {
     NMEM nmem = nmem_create();
@@ -123,6 +180,7 @@ int main (int argc, char **argv)
     YAZ_CHECK_INIT(argc, argv);
     YAZ_CHECK_LOG();
     tst_nmem_malloc();
+    tst_nmem_growth();
     tst_nmem_strsplit();
     YAZ_CHECK_TERM;
 }
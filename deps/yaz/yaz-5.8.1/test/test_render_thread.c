@@ -0,0 +1,273 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* Renders the MARC records of test/marc*.marc from several threads at
+   once and checks that every thread gets the output of a single threaded
+   render.
+
+   test_render_thread [threads [rounds]]
+
+   With arguments, the time of one thread doing all rounds is compared
+   with that of the threads splitting them, to see how rendering scales.
+*/
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yaz/log.h>
+#include <yaz/marcdisp.h>
+#include <yaz/oid_db.h>
+#include <yaz/proto.h>
+#include <yaz/record_render.h>
+#include <yaz/test.h>
+#include <yaz/thread_create.h>
+#include <yaz/timing.h>
+#include <yaz/wrbuf.h>
+
+#define MAX_RECORDS 64
+#define MAX_THREADS 64
+#define NUM_SPECS 4
+
+static const char *spec_fmt[NUM_SPECS] = {
+    "xml; charset=%s",
+    "json; charset=%s",
+    "json; charset=%s; format=compact",
+    "txml; charset=%s"
+};
+
+struct test_record {
+    char *buf;
+    int len;
+    char spec[NUM_SPECS][64];
+    WRBUF expect[NUM_SPECS];
+};
+
+static struct test_record records[MAX_RECORDS];
+static int num_records = 0;
+
+struct work {
+    int rounds;
+    int rendered;
+    int errors;
+};
+
+static void read_records(const char *srcdir, int no)
+{
+    char fname[1024], charset[32];
+    WRBUF w = wrbuf_alloc();
+    char tmp[4096];
+    size_t n, off;
+    FILE *f;
+
+    sprintf(fname, "%s/marc%d.chr", srcdir, no);
+    f = fopen(fname, "r");
+    if (!f)
+    {
+        wrbuf_destroy(w);
+        return;
+    }
+    if (fscanf(f, "%31s", charset) != 1)
+        strcpy(charset, "utf-8");
+    fclose(f);
+
+    sprintf(fname, "%s/marc%d.marc", srcdir, no);
+    f = fopen(fname, "rb");
+    if (!f)
+    {
+        wrbuf_destroy(w);
+        return;
+    }
+    while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+        wrbuf_write(w, tmp, n);
+    fclose(f);
+
+    for (off = 0; off + 5 <= wrbuf_len(w) && num_records < MAX_RECORDS; )
+    {
+        struct test_record *r = records + num_records;
+        int i, len = atoi_n(wrbuf_buf(w) + off, 5);
+
+        if (len < 25 || off + len > wrbuf_len(w))
+            break;
+        r->len = len;
+        r->buf = (char *) xmalloc(len);
+        memcpy(r->buf, wrbuf_buf(w) + off, len);
+        for (i = 0; i < NUM_SPECS; i++)
+        {
+            sprintf(r->spec[i], spec_fmt[i], charset);
+            r->expect[i] = 0;
+        }
+        num_records++;
+        off += len;
+    }
+    wrbuf_destroy(w);
+}
+
+/* renders every record in every format once; returns number of renders
+   that differ from the expected output */
+static int render_all(ODR odr, WRBUF w, int *rendered)
+{
+    int errors = 0;
+    int i, j;
+
+    for (i = 0; i < num_records; i++)
+    {
+        Z_NamePlusRecord *npr = (Z_NamePlusRecord *)
+            odr_malloc(odr, sizeof(*npr));
+
+        npr->databaseName = 0;
+        npr->which = Z_NamePlusRecord_databaseRecord;
+        npr->u.databaseRecord =
+            z_ext_record_oid(odr, yaz_oid_recsyn_usmarc,
+                             records[i].buf, records[i].len);
+        for (j = 0; j < NUM_SPECS; j++)
+        {
+            int len;
+            const char *res;
+
+            wrbuf_rewind(w);
+            res = yaz_record_render(npr, 0, w, records[i].spec[j], &len);
+            if (!records[i].expect[j])
+            {
+                /* single threaded first pass */
+                records[i].expect[j] = wrbuf_alloc();
+                if (res)
+                    wrbuf_write(records[i].expect[j], res, len);
+                else
+                    errors++;
+            }
+            else if (!res
+                     || (size_t) len != wrbuf_len(records[i].expect[j])
+                     || memcmp(res, wrbuf_buf(records[i].expect[j]), len))
+                errors++;
+            (*rendered)++;
+        }
+        odr_reset(odr);
+    }
+    if (yaz_string_to_oid(yaz_oid_std(), CLASS_RECSYN, "usmarc")
+        != yaz_oid_recsyn_usmarc)
+        errors++;
+    return errors;
+}
+
+static void *work_handler(void *arg)
+{
+    struct work *wk = (struct work *) arg;
+    ODR odr = odr_createmem(ODR_ENCODE);
+    WRBUF w = wrbuf_alloc();
+    char module[40];
+    int i, mask;
+
+    /* all threads define log module bits at the same time */
+    sprintf(module, "render_thread_%p", (void *) wk);
+    mask = yaz_log_mask_str_x(module, 0);
+    if (yaz_log_module_level(module) != mask)
+        wk->errors++;
+    for (i = 0; i < wk->rounds; i++)
+        wk->errors += render_all(odr, w, &wk->rendered);
+    wrbuf_destroy(w);
+    odr_destroy(odr);
+    return 0;
+}
+
+/* runs rounds split over num_threads threads; returns seconds taken */
+static double run_threads(int num_threads, int rounds, int *rendered,
+                          int *errors)
+{
+    yaz_thread_t tids[MAX_THREADS];
+    struct work wk[MAX_THREADS];
+    yaz_timing_t t = yaz_timing_create();
+    double secs;
+    int i;
+
+    for (i = 0; i < num_threads; i++)
+    {
+        wk[i].rounds = rounds / num_threads
+            + (i < rounds % num_threads ? 1 : 0);
+        wk[i].rendered = wk[i].errors = 0;
+        tids[i] = yaz_thread_create(work_handler, wk + i);
+    }
+    *rendered = *errors = 0;
+    for (i = 0; i < num_threads; i++)
+    {
+        if (tids[i])
+            yaz_thread_join(&tids[i], 0);
+        else
+            (*errors)++;
+        *rendered += wk[i].rendered;
+        *errors += wk[i].errors;
+    }
+    yaz_timing_stop(t);
+    secs = yaz_timing_get_real(t);
+    yaz_timing_destroy(&t);
+    return secs;
+}
+
+static void tst(int num_threads, int rounds, int report)
+{
+    ODR odr = odr_createmem(ODR_ENCODE);
+    WRBUF w = wrbuf_alloc();
+    int rendered = 0, errors;
+    double t1, tn;
+
+    YAZ_CHECK(num_records > 0);
+    errors = render_all(odr, w, &rendered); /* expected output */
+    YAZ_CHECK_EQ(errors, 0);
+    wrbuf_destroy(w);
+    odr_destroy(odr);
+
+    tn = run_threads(num_threads, rounds, &rendered, &errors);
+    YAZ_CHECK_EQ(errors, 0);
+    YAZ_CHECK_EQ(rendered, rounds * num_records * NUM_SPECS);
+
+    if (report)
+    {
+        t1 = run_threads(1, rounds, &rendered, &errors);
+        YAZ_CHECK_EQ(errors, 0);
+        printf("%d renders. 1 thread: %.0f/s  %d threads: %.0f/s  x%.1f\n",
+               rendered, rendered / t1, num_threads, rendered / tn, t1 / tn);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *srcdir = getenv("srcdir");
+    int num_threads = 4, rounds = 20;
+    int i;
+
+    YAZ_CHECK_INIT(argc, argv);
+    YAZ_CHECK_LOG();
+    if (argc > 1)
+        num_threads = atoi(argv[1]);
+    if (argc > 2)
+        rounds = atoi(argv[2]);
+    if (num_threads < 1)
+        num_threads = 1;
+    if (num_threads > MAX_THREADS)
+        num_threads = MAX_THREADS;
+    for (i = 1; i < 10; i++)
+        read_records(srcdir ? srcdir : ".", i);
+    tst(num_threads, rounds, argc > 1);
+    for (i = 0; i < num_records; i++)
+    {
+        int j;
+        for (j = 0; j < NUM_SPECS; j++)
+            wrbuf_destroy(records[i].expect[j]);
+        xfree(records[i].buf);
+    }
+    YAZ_CHECK_TERM;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
+
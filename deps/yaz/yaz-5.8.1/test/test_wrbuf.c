@@ -159,11 +159,110 @@ static void tst_cstr(void)
 
 }
 
+/* the escapes of wrbuf_xmlputs_n and wrbuf_json_write; bytes not listed
+   are copied as is */
+struct esc {
+    char c;
+    const char *xml;
+    const char *json;
+};
+
+static const struct esc escapes[] = {
+    { '<', "&lt;", 0 },
+    { '>', "&gt;", 0 },
+    { '&', "&amp;", 0 },
+    { '"', "&quot;", "\\\"" },
+    { '\'', "&apos;", 0 },
+    { '\\', 0, "\\\\" },
+    { '\t', 0, "\\t" },
+    { '\n', 0, "\\n" },
+    { '\r', 0, "\\r" },
+    { '\b', "", "\\b" },
+    { '\001', "", "\\u0001" },
+    { '\037', "", "\\u001f" },
+    { '\0', "", 0 },
+    { ' ', 0, 0 },
+    { '\177', 0, 0 },
+    { '\200', 0, 0 },
+    { '\377', 0, 0 },
+    { 0, 0, 0 }
+};
+
+static void esc_expect(WRBUF w, const char *cp, size_t sz, int json)
+{
+    size_t i;
+    for (i = 0; i < sz; i++)
+    {
+        const char *e = 0;
+        int j;
+        for (j = 0; escapes[j].xml || escapes[j].json || escapes[j].c; j++)
+            if (escapes[j].c == cp[i])
+                e = json ? escapes[j].json : escapes[j].xml;
+        if (e)
+            wrbuf_puts(w, e);
+        else
+            wrbuf_putc(w, cp[i]);
+    }
+}
+
+static int esc_test(const char *cp, size_t sz, int json)
+{
+    WRBUF w = wrbuf_alloc();
+    WRBUF e = wrbuf_alloc();
+    int ret;
+
+    if (json)
+        wrbuf_json_write(w, cp, sz);
+    else
+        wrbuf_xmlputs_n(w, cp, sz);
+    esc_expect(e, cp, sz, json);
+    ret = wrbuf_len(w) == wrbuf_len(e)
+        && !memcmp(wrbuf_buf(w), wrbuf_buf(e), wrbuf_len(e));
+    wrbuf_destroy(e);
+    wrbuf_destroy(w);
+    return ret;
+}
+
+/* the escaping scans 16 or 32 bytes at a time where it can, so put each
+   special byte at every position of inputs up to three blocks long, with
+   and without a second one at the end */
+static void tst_escape(void)
+{
+    char buf[100];
+    size_t sz, pos;
+    int j, json;
+    char last;
+
+    YAZ_CHECK(esc_test("", 0, 0));
+    YAZ_CHECK(esc_test("", 0, 1));
+    for (sz = 1; sz <= sizeof(buf); sz++)
+        for (pos = 0; pos < sz; pos++)
+            for (j = 0; escapes[j].xml || escapes[j].json || escapes[j].c;
+                 j++)
+            {
+                size_t i;
+                for (i = 0; i < sz; i++)
+                    buf[i] = i & 1 ? 'a' : '\346';
+                buf[pos] = escapes[j].c;
+                last = buf[sz - 1];
+                for (json = 0; json < 2; json++)
+                {
+                    YAZ_CHECK(esc_test(buf, sz, json));
+                    buf[sz - 1] = '<';
+                    YAZ_CHECK(esc_test(buf, sz, json));
+                    buf[sz - 1] = '"';
+                    YAZ_CHECK(esc_test(buf, sz, json));
+                    buf[sz - 1] = last;
+                }
+            }
+}
+
 int main (int argc, char **argv)
 {
     YAZ_CHECK_INIT(argc, argv);
     tstwrbuf();
     tst_cstr();
+    tst_escape();
     YAZ_CHECK_TERM;
 }
 
@@ -0,0 +1,267 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <yaz/test.h>
+#include <yaz/thread_create.h>
+#include <yaz/zoom.h>
+
+static int eq(const char *a, const char *b)
+{
+    return a && b && !strcmp(a, b);
+}
+
+static void tst_set_get(void)
+{
+    ZOOM_options opt = ZOOM_options_create();
+    const char *v;
+    int len = -1;
+
+    YAZ_CHECK(!ZOOM_options_get(opt, "a"));
+    ZOOM_options_set(opt, "a", "1");
+    YAZ_CHECK(eq(ZOOM_options_get(opt, "a"), "1"));
+    ZOOM_options_set(opt, "a", "22");
+    YAZ_CHECK(eq(ZOOM_options_get(opt, "a"), "22"));
+    /* names are case sensitive */
+    YAZ_CHECK(!ZOOM_options_get(opt, "A"));
+
+    ZOOM_options_setl(opt, "b", "x\0y", 3);
+    v = ZOOM_options_getl(opt, "b", &len);
+    YAZ_CHECK_EQ(len, 3);
+    YAZ_CHECK(v && !memcmp(v, "x\0y", 4));
+
+    /* a NULL value reads as unset */
+    ZOOM_options_set(opt, "a", 0);
+    YAZ_CHECK(!ZOOM_options_get(opt, "a"));
+
+    ZOOM_options_set_int(opt, "n", 42);
+    YAZ_CHECK_EQ(ZOOM_options_get_int(opt, "n", 7), 42);
+    YAZ_CHECK_EQ(ZOOM_options_get_int(opt, "none", 7), 7);
+    ZOOM_options_set(opt, "t", "T");
+    YAZ_CHECK_EQ(ZOOM_options_get_bool(opt, "t", 0), 1);
+    ZOOM_options_set(opt, "t", "0");
+    YAZ_CHECK_EQ(ZOOM_options_get_bool(opt, "t", 1), 0);
+    YAZ_CHECK_EQ(ZOOM_options_get_bool(opt, "none", 1), 1);
+    ZOOM_options_destroy(opt);
+}
+
+static const char *callback(void *handle, const char *name)
+{
+    int *calls = (int *) handle;
+
+    (*calls)++;
+    if (!strcmp(name, "cb"))
+        return "from callback";
+    if (!strcmp(name, "a"))
+        return "callback a";
+    return 0;
+}
+
+static void tst_parents(void)
+{
+    ZOOM_options p1 = ZOOM_options_create();
+    ZOOM_options p2 = ZOOM_options_create();
+    ZOOM_options c = ZOOM_options_create_with_parent2(p1, p2);
+    ZOOM_options d;
+    int calls = 0;
+
+    ZOOM_options_set(p1, "a", "p1");
+    ZOOM_options_set(p2, "a", "p2");
+    ZOOM_options_set(p2, "b", "p2");
+    YAZ_CHECK(eq(ZOOM_options_get(c, "a"), "p1"));
+    YAZ_CHECK(eq(ZOOM_options_get(c, "b"), "p2"));
+    ZOOM_options_set(c, "a", "c");
+    YAZ_CHECK(eq(ZOOM_options_get(c, "a"), "c"));
+    YAZ_CHECK(!ZOOM_options_get(c, "c"));
+
+    /* the callback of an options object comes before its own values,
+       also for names that were never set */
+    ZOOM_options_set_callback(p1, callback, &calls);
+    YAZ_CHECK(eq(ZOOM_options_get(c, "cb"), "from callback"));
+    YAZ_CHECK_EQ(calls, 1);
+    YAZ_CHECK(eq(ZOOM_options_get(c, "a"), "c"));
+    YAZ_CHECK_EQ(calls, 1);
+    YAZ_CHECK(eq(ZOOM_options_get(p1, "a"), "callback a"));
+    YAZ_CHECK(eq(ZOOM_options_get(c, "b"), "p2"));
+    YAZ_CHECK_EQ(calls, 3);
+
+    /* a copy has copies of parents too */
+    d = ZOOM_options_dup(c);
+    ZOOM_options_set(p2, "b", "changed");
+    YAZ_CHECK(eq(ZOOM_options_get(d, "a"), "c"));
+    YAZ_CHECK(eq(ZOOM_options_get(d, "b"), "p2"));
+    YAZ_CHECK(eq(ZOOM_options_get(c, "b"), "changed"));
+    ZOOM_options_destroy(d);
+
+    /* a NULL value does not hide those of parents */
+    ZOOM_options_set_parent(c, p2);
+    ZOOM_options_set(c, "a", 0);
+    YAZ_CHECK(eq(ZOOM_options_get(c, "a"), "p2"));
+    YAZ_CHECK(eq(ZOOM_options_get(c, "b"), "changed"));
+
+    ZOOM_options_destroy(c);
+    ZOOM_options_destroy(p2);
+    ZOOM_options_destroy(p1);
+}
+
+static void tst_keys(void)
+{
+    ZOOM_options p = ZOOM_options_create();
+    ZOOM_options c = ZOOM_options_create_with_parent(p);
+    ZOOM_options_key k = ZOOM_options_key_get("keyed");
+    ZOOM_options_key async = ZOOM_options_key_get("async");
+    int len = -1;
+
+    YAZ_CHECK(k);
+    YAZ_CHECK(k == ZOOM_options_key_get("keyed"));
+    YAZ_CHECK(k != ZOOM_options_key_get("Keyed"));
+    /* built-in names have keys too */
+    YAZ_CHECK(async && async == ZOOM_options_key_get("async"));
+
+    YAZ_CHECK(!ZOOM_options_getk(c, k, 0));
+    ZOOM_options_setk(p, k, "by key", 6);
+    YAZ_CHECK(eq(ZOOM_options_getk(c, k, &len), "by key"));
+    YAZ_CHECK_EQ(len, 6);
+    YAZ_CHECK(eq(ZOOM_options_get(c, "keyed"), "by key"));
+    ZOOM_options_set(c, "keyed", "by name");
+    YAZ_CHECK(eq(ZOOM_options_getk(c, k, 0), "by name"));
+    ZOOM_options_setk(c, k, "a\0b", 3);
+    YAZ_CHECK(eq(ZOOM_options_getl(c, "keyed", &len), "a"));
+    YAZ_CHECK_EQ(len, 3);
+    ZOOM_options_setk(c, k, 0, 0);
+    YAZ_CHECK(eq(ZOOM_options_getk(c, k, 0), "by key"));
+
+    ZOOM_options_set(c, "async", "1");
+    YAZ_CHECK(eq(ZOOM_options_getk(c, async, 0), "1"));
+    ZOOM_options_destroy(c);
+    ZOOM_options_destroy(p);
+}
+
+/* enough entries, and names, for several rounds of table growth */
+#define NUM_NAMES 3000
+
+static void tst_growth(void)
+{
+    static ZOOM_options_key keys[NUM_NAMES];
+    ZOOM_options opt = ZOOM_options_create();
+    ZOOM_options dup;
+    int i, bad = 0;
+
+    for (i = 0; i < NUM_NAMES; i++)
+    {
+        char name[40], value[40];
+
+        sprintf(name, "grow%d", i);
+        sprintf(value, "%d", i);
+        if (i & 1)
+            ZOOM_options_set(opt, name, value);
+        else
+        {
+            keys[i] = ZOOM_options_key_get(name);
+            ZOOM_options_setk(opt, keys[i], value, strlen(value));
+        }
+    }
+    for (i = 0; i < NUM_NAMES; i++)
+    {
+        char name[40];
+
+        sprintf(name, "grow%d", i);
+        if (ZOOM_options_get_int(opt, name, -1) != i)
+            bad++;
+        /* keys stay the same however many names came later */
+        if (!(i & 1) && keys[i] != ZOOM_options_key_get(name))
+            bad++;
+        if (!(i & 1) && ZOOM_options_getk(opt, keys[i], 0) !=
+            ZOOM_options_get(opt, name))
+            bad++;
+    }
+    YAZ_CHECK_EQ(bad, 0);
+
+    dup = ZOOM_options_dup(opt);
+    for (i = 0; i < NUM_NAMES; i += 2)
+        ZOOM_options_setk(opt, keys[i], "x", 1);
+    for (i = 0; i < NUM_NAMES; i++)
+    {
+        char name[40], value[40];
+
+        sprintf(name, "grow%d", i);
+        sprintf(value, "%d", i);
+        if (!eq(ZOOM_options_get(dup, name), value))
+            bad++;
+        if (!eq(ZOOM_options_get(opt, name), (i & 1) ? value : "x"))
+            bad++;
+    }
+    YAZ_CHECK_EQ(bad, 0);
+    YAZ_CHECK(!ZOOM_options_get(opt, "grow-1"));
+    ZOOM_options_destroy(dup);
+    ZOOM_options_destroy(opt);
+}
+
+#if YAZ_POSIX_THREADS
+#define NUM_THREADS 8
+#define THREAD_NAMES 500
+
+static void *key_thread(void *arg)
+{
+    ZOOM_options_key *keys = (ZOOM_options_key *) arg;
+    int i;
+
+    for (i = 0; i < THREAD_NAMES; i++)
+    {
+        char name[40];
+
+        sprintf(name, "thread%d", i);
+        keys[i] = ZOOM_options_key_get(name);
+    }
+    return 0;
+}
+
+/* threads interning the same new names get the same keys */
+static void tst_threads(void)
+{
+    static ZOOM_options_key keys[NUM_THREADS][THREAD_NAMES];
+    yaz_thread_t tid[NUM_THREADS];
+    int i, j, bad = 0;
+
+    for (i = 0; i < NUM_THREADS; i++)
+        tid[i] = yaz_thread_create(key_thread, keys[i]);
+    for (i = 0; i < NUM_THREADS; i++)
+    {
+        void *return_data;
+        yaz_thread_join(tid + i, &return_data);
+    }
+    for (i = 1; i < NUM_THREADS; i++)
+        for (j = 0; j < THREAD_NAMES; j++)
+            if (keys[i][j] != keys[0][j])
+                bad++;
+    YAZ_CHECK_EQ(bad, 0);
+}
+#endif
+
+int main (int argc, char **argv)
+{
+    YAZ_CHECK_INIT(argc, argv);
+    tst_set_get();
+    tst_parents();
+    tst_keys();
+    tst_growth();
+#if YAZ_POSIX_THREADS
+    tst_threads();
+#endif
+    YAZ_CHECK_TERM;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
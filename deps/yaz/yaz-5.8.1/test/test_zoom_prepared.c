@@ -0,0 +1,184 @@
+/* This file is part of the YAZ toolkit.
+ * Copyright (C) Index Data
+ * See the file LICENSE for details.
+ */
+
+/* Prepared queries: the Z_Query of a bound query must be the one of the
+   same query with the values written in, for PQF and CQL templates */
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <yaz/log.h>
+#include <yaz/querytowrbuf.h>
+#include <yaz/test.h>
+#include "../src/zoom-p.h"
+
+/* Z_Query as a string, as yaz_query_to_wrbuf writes it */
+static void query_str(ZOOM_query q, WRBUF w)
+{
+    wrbuf_rewind(w);
+    yaz_query_to_wrbuf(w, ZOOM_query_get_Z_Query(q));
+}
+
+/* binds template with name=value pairs and compares with query of
+   type and string expected; 0 for expected bind failure */
+static int bind_eq(const char *type, const char *template,
+                   const char **names, const char **values, int num,
+                   const char *expected)
+{
+    ZOOM_prepared p = ZOOM_prepared_create(type, template);
+    ZOOM_query b, q;
+    WRBUF w_b, w_q;
+    int ret;
+
+    if (!p)
+    {
+        yaz_log(YLOG_WARN, "%s: prepare failed", template);
+        return 0;
+    }
+    b = ZOOM_prepared_bind(p, names, values, num);
+    /* bound queries outlive the template */
+    ZOOM_prepared_destroy(p);
+    if (!b)
+    {
+        if (expected)
+            yaz_log(YLOG_WARN, "%s: bind failed", template);
+        return !expected;
+    }
+    if (!expected)
+    {
+        yaz_log(YLOG_WARN, "%s: bind did not fail", template);
+        ZOOM_query_destroy(b);
+        return 0;
+    }
+    q = ZOOM_query_create();
+    if (!strcmp(type, "prefix"))
+        ZOOM_query_prefix(q, expected);
+    else
+        ZOOM_query_cql(q, expected);
+    w_b = wrbuf_alloc();
+    w_q = wrbuf_alloc();
+    query_str(b, w_b);
+    query_str(q, w_q);
+    ret = !strcmp(wrbuf_cstr(w_b), wrbuf_cstr(w_q));
+    if (!ret)
+        yaz_log(YLOG_WARN, "%s: got %s, expected %s", template,
+                wrbuf_cstr(w_b), wrbuf_cstr(w_q));
+    wrbuf_destroy(w_q);
+    wrbuf_destroy(w_b);
+    ZOOM_query_destroy(q);
+    ZOOM_query_destroy(b);
+    return ret;
+}
+
+static void tst_pqf(void)
+{
+    const char *names[] = { "title", "author" };
+    const char *values[] = { "fish", "a \"b\" \\c" };
+
+    YAZ_CHECK(bind_eq("prefix", "@attr 1=4 $title", names, values, 1,
+                      "@attr 1=4 fish"));
+    YAZ_CHECK(bind_eq("prefix", "@and @attr 1=4 $title @attr 1=1003 $author",
+                      names, values, 2,
+                      "@and @attr 1=4 fish @attr 1=1003 \"a \\\"b\\\" \\\\c\""));
+    YAZ_CHECK(bind_eq("prefix", "@or $title @attr 1=4 $title",
+                      names, values, 1, "@or fish @attr 1=4 fish"));
+    /* quoted and partial placeholders are literal terms */
+    YAZ_CHECK(bind_eq("prefix", "@or @attr 1=4 $title @attr 1=4 \"$title\"",
+                      names, values, 1,
+                      "@or @attr 1=4 fish @attr 1=4 {$title}"));
+    YAZ_CHECK(bind_eq("prefix", "@or $title x$title", names, values, 1,
+                      "@or fish x$title"));
+    YAZ_CHECK(bind_eq("prefix", "@attr 1=4 fish", names, values, 0,
+                      "@attr 1=4 fish"));
+    /* unbound placeholder */
+    YAZ_CHECK(bind_eq("prefix", "@and $title $author", names, values, 1, 0));
+    YAZ_CHECK(!ZOOM_prepared_create("prefix", "@and $title"));
+}
+
+static void tst_cql(void)
+{
+    const char *names[] = { "title", "author", "note" };
+    const char *values[] = { "fish", "a \"b\" \\c", "and" };
+
+    YAZ_CHECK(bind_eq("cql", "dc.title = $title", names, values, 1,
+                      "dc.title = \"fish\""));
+    YAZ_CHECK(bind_eq("cql", "$title", names, values, 1, "\"fish\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title any $title", names, values, 1,
+                      "dc.title any \"fish\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title = $title and dc.creator = $author",
+                      names, values, 2,
+                      "dc.title = \"fish\" and dc.creator = "
+                      "\"a \\\"b\\\" \\\\c\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title = $note", names, values, 3,
+                      "dc.title = \"and\""));
+    YAZ_CHECK(bind_eq("cql", "a or (b and dc.title=$title)",
+                      names, values, 1,
+                      "\"a\" or (\"b\" and dc.title = \"fish\")"));
+    YAZ_CHECK(bind_eq("cql", "(a or b) not/x=1 $title", names, values, 1,
+                      "(\"a\" or \"b\") not/x=1 \"fish\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title =/a/b<2 $title", names, values, 1,
+                      "dc.title =/a/b<2 \"fish\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title = $title sortby dc.date/sort.descending",
+                      names, values, 1,
+                      "dc.title = \"fish\" sortBy dc.date/sort.descending"));
+    YAZ_CHECK(bind_eq("cql", ">dc=\"info:dc\" dc.title = $title",
+                      names, values, 1,
+                      "(>i=\"info:dc\" i.title = \"fish\")"));
+    /* quoted placeholders and other terms are kept */
+    YAZ_CHECK(bind_eq("cql", "dc.title = $title and note = \"costs $title\"",
+                      names, values, 1,
+                      "dc.title = \"fish\" and note = \"costs $title\""));
+    YAZ_CHECK(bind_eq("cql", "dc.title = \"$title\" or x$title",
+                      names, values, 1,
+                      "dc.title = \"$title\" or \"x$title\""));
+    YAZ_CHECK(bind_eq("cql", "a\\\"b", names, values, 0, "\"a\\\"b\""));
+    /* unbound placeholder */
+    YAZ_CHECK(bind_eq("cql", "$title or $author", names, values, 1, 0));
+    YAZ_CHECK(!ZOOM_prepared_create("cql", "dc.title = "));
+}
+
+static void tst_params(void)
+{
+    ZOOM_prepared p = ZOOM_prepared_create(
+        "prefix", "@or @and $b \"$x\" @and $a $b");
+
+    YAZ_CHECK(p);
+    if (!p)
+        return;
+    YAZ_CHECK_EQ(ZOOM_prepared_num_params(p), 2);
+    YAZ_CHECK(!strcmp(ZOOM_prepared_param_name(p, 0), "b"));
+    YAZ_CHECK(!strcmp(ZOOM_prepared_param_name(p, 1), "a"));
+    YAZ_CHECK(!ZOOM_prepared_param_name(p, 2));
+    ZOOM_prepared_destroy(p);
+
+    p = ZOOM_prepared_create("cql", "$t any $u $v or \"$w\"");
+    YAZ_CHECK(p);
+    if (!p)
+        return;
+    YAZ_CHECK_EQ(ZOOM_prepared_num_params(p), 2);
+    YAZ_CHECK(!strcmp(ZOOM_prepared_param_name(p, 0), "u"));
+    YAZ_CHECK(!strcmp(ZOOM_prepared_param_name(p, 1), "v"));
+    ZOOM_prepared_destroy(p);
+}
+
+int main (int argc, char **argv)
+{
+    YAZ_CHECK_INIT(argc, argv);
+    YAZ_CHECK_LOG();
+    tst_pqf();
+    tst_cql();
+    tst_params();
+    YAZ_CHECK_TERM;
+}
+/*
+ * Local variables:
+ * c-basic-offset: 4
+ * c-file-style: "Stroustrup"
+ * indent-tabs-mode: nil
+ * End:
+ * vim: shiftwidth=4 tabstop=8 expandtab
+ */
@@ -18,12 +18,14 @@
         'target_arch%': 'ia32'
       },
       'cflags': [
+        '-pthread',
         '<!@(pkg-config --cflags gnutls)',
         '<!@(xml2-config --cflags)',
         '<!@(libgcrypt-config --cflags)'
       ],
       'xcode_settings': {
         'OTHER_CFLAGS': [
+          '-pthread',
           '<!@(pkg-config --cflags gnutls)',
           '<!@(xml2-config --cflags)',
           '<!@(libgcrypt-config --cflags)'
@@ -155,6 +157,7 @@
         '<(yazsrc)/init_globals.c',
         '<(yazsrc)/zoom-c.c',
         '<(yazsrc)/zoom-memcached.c',
+        '<(yazsrc)/zoom-cache.c',
         '<(yazsrc)/zoom-z3950.c',
         '<(yazsrc)/zoom-sru.c',
         '<(yazsrc)/zoom-query.c',
@@ -243,7 +246,11 @@
         '<(yazsrc)/backtrace.c'
       ],
       'link_settings': {
+        'ldflags': [
+          '-pthread'
+        ],
         'libraries': [
+          '-lpthread',
           '<!@(pkg-config --libs gnutls)',
           '<!@(libgcrypt-config --libs)',
           '<!@(xml2-config --libs)'
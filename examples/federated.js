@@ -0,0 +1,23 @@
+'use strict';
+
+var zoom = require('../lib');
+
+zoom.federated([
+    '192.83.186.170:210/INNOPAC',
+    { host: 'lx2.loc.gov:210/LCDB', timeout: 10 }
+  ], '@attr 1=4 台灣', {
+    count: 5,
+    options: { preferredRecordSyntax: 'usmarc' }
+  })
+  .on('search', function (target, size) {
+    console.log(target.host, 'hits', size);
+  })
+  .on('record', function (target, record) {
+    console.log(target.host, record.json.leader);
+  })
+  .on('target end', function (target, err) {
+    console.log(target.host, 'done', err || '');
+  })
+  .on('end', function () {
+    console.log('all targets done');
+  });
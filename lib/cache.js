@@ -0,0 +1,19 @@
+'use strict';
+
+var Cache_ = require('./binding').Cache;
+
+// Hit counts and records fetched by any connection are kept in memory and
+// served to later searches for the same query on the same target.
+// Disabled until a maxBytes limit is configured; cached searches expire
+// after searchTtl seconds.
+exports.configure = function (opts) {
+  opts || (opts = {});
+  var ttl = opts.searchTtl === undefined ? 600 : opts.searchTtl;
+  Cache_.configure(Math.max(Math.floor(opts.maxBytes) || 0, 0),
+    Math.max(Math.floor(ttl) || 0, 0));
+  return exports;
+};
+
+exports.stats = function () {
+  return Cache_.stats();
+};
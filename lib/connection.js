@@ -1,24 +1,27 @@
 'use strict';
 
 var Query_ = require('./binding').Query;
+var Prepared_ = require('./binding').Prepared;
 var Options_ = require('./binding').Options;
 var Connection_ = require('./binding').Connection;
 var noop = require('./noop');
 var ResultSet = require('./resultset');
 var ReadStream = require('./read-stream');
+var Prepared = require('./prepared');
 
 module.exports = Connection;
 
 var conn = Connection.prototype;
 
-function Connection(host) {
+function Connection(host, pool) {
   if (!(this instanceof Connection)) {
-    return new Connection(host);
+    return new Connection(host, pool);
   }
 
   this._connected = false;
   this._options = Options_();
-  this._conn = new Connection_(this._options);
+  this._pool = pool ? pool._pool : null;
+  this._conn = new Connection_(this._options, this._pool);
   this.set('implementationName', 'node-zoom');
 
   var parsed = this._parseHost(host || '');
@@ -36,7 +39,7 @@ conn.get = function (key) {
   return this._options.get(key);
 };
 
-conn.query = function (type, queryString) {
+conn.query = function (type, queryString, transform) {
   if (arguments.length < 2) {
     queryString = type;
     type = 'prefix';
@@ -48,11 +51,24 @@ conn.query = function (type, queryString) {
     throw new Error('Unknown query type');
   }
 
-  clone._query[type](queryString);
+  // CQL is sent as is, unless a transform turns it into RPN here
+  if (type === 'cql' && transform) {
+    clone._query.cql2rpn(queryString, transform);
+  } else {
+    clone._query[type](queryString);
+  }
 
   return clone;
 };
 
+conn.prepare = function (type, queryString) {
+  if (arguments.length < 2) {
+    queryString = type;
+    type = 'prefix';
+  }
+  return new Prepared(this, new Prepared_(type, queryString));
+};
+
 conn.sort = function () {
   if (!this._query) {
     throw new Error('Query not found');
@@ -76,6 +92,15 @@ conn.connect = function (cb) {
   return this;
 };
 
+// Hands a pooled session back to its pool (closes it otherwise); result
+// sets from earlier searches must not be used afterwards.
+conn.release = function () {
+  this._conn.release();
+  this._conn = new Connection_(this._options, this._pool);
+  this._connected = false;
+  return this;
+};
+
 conn.createReadStream = function (options) {
   if (!this._query) {
     throw new Error('Query not found');
@@ -0,0 +1,97 @@
+'use strict';
+
+var util = require('util');
+var EventEmitter = require('events').EventEmitter;
+var Query_ = require('./binding').Query;
+var Options_ = require('./binding').Options;
+var Federation_ = require('./binding').Federation;
+var Connection = require('./connection');
+var Record = require('./record');
+
+module.exports = Federated;
+
+util.inherits(Federated, EventEmitter);
+
+var fed = Federated.prototype;
+
+function Federated(targets, query, opts) {
+  if (!(this instanceof Federated)) {
+    return new Federated(targets, query, opts);
+  }
+
+  EventEmitter.call(this);
+
+  opts || (opts = {});
+
+  var type = opts.type || 'prefix';
+  var zquery = Query_();
+
+  if (!zquery[type]) {
+    throw new Error('Unknown query type');
+  }
+
+  zquery[type](query);
+
+  this._options = Options_();
+  this._options.set('implementationName', 'node-zoom');
+  this._options.set('count', (opts.count === undefined ? 10 : opts.count) | 0);
+  opts.timeout && this._options.set('timeout', opts.timeout | 0);
+  setOptions(this._options, opts.options);
+
+  this._federation = new Federation_(zquery, this._emit.bind(this));
+  this.targets = (targets || []).map(this._addTarget, this);
+
+  process.nextTick(function () {
+    this._federation.start();
+  }.bind(this));
+}
+
+fed._addTarget = function (target) {
+  if (typeof target === 'string') {
+    target = { host: target };
+  }
+
+  var parsed = Connection.prototype._parseHost(target.host || '');
+  var options = Options_(this._options);
+
+  parsed.database && options.set('databaseName', parsed.database);
+  target.timeout && options.set('timeout', target.timeout | 0);
+  setOptions(options, target.options);
+
+  this._federation.add(options, parsed.host, parsed.port | 0);
+
+  return {
+    host: target.host,
+    size: 0,
+    error: null,
+    done: false
+  };
+};
+
+fed._emit = function (type, index, value) {
+  var target = this.targets[index];
+
+  switch (type) {
+    case 'search':
+      target.size = value;
+      this.emit('search', target, value);
+      break;
+    case 'record':
+      this.emit('record', target, value && new Record(value));
+      break;
+    case 'end':
+      target.error = value;
+      target.done = true;
+      this.emit('target end', target, value);
+      break;
+    case 'done':
+      this.emit('end', this.targets);
+      break;
+  }
+};
+
+function setOptions(options, values) {
+  values && Object.keys(values).forEach(function (key) {
+    options.set(key, values[key]);
+  });
+}
@@ -1,8 +1,22 @@
 'use strict';
 
 var binding = require('./binding');
+var cache = require('./cache');
 var Connection = require('./connection');
+var Federated = require('./federated');
+var Pool = require('./pool');
 
 exports.binding = binding;
+exports.cache = cache;
 exports.Connection = Connection;
 exports.connection = Connection;
+exports.Federated = Federated;
+exports.federated = Federated;
+exports.Pool = Pool;
+exports.pool = Pool;
+
+// Compiled CQL transform for conn.query('cql', query, transform); files
+// are parsed once and shared until they change on disk
+exports.cqlTransform = function (file) {
+  return new binding.Transform(file);
+};
@@ -0,0 +1,36 @@
+'use strict';
+
+var Pool_ = require('./binding').Pool;
+var Connection = require('./connection');
+
+module.exports = Pool;
+
+var pool = Pool.prototype;
+
+function Pool(opts) {
+  if (!(this instanceof Pool)) {
+    return new Pool(opts);
+  }
+
+  opts || (opts = {});
+
+  var max = opts.maxPerTarget === undefined ? 4 : opts.maxPerTarget;
+  var idle = opts.idleTimeout === undefined ? 30000 : opts.idleTimeout;
+
+  this._pool = new Pool_(Math.max(max | 0, 1), idle | 0);
+}
+
+pool.connection = function (host) {
+  return new Connection(host, this);
+};
+
+pool.drain = function () {
+  this._pool.drain();
+  return this;
+};
+
+Object.defineProperty(pool, 'size', {
+  get: function () {
+    return this._pool.size();
+  }
+});
@@ -0,0 +1,16 @@
+'use strict';
+
+module.exports = Prepared;
+
+// Query template with $name placeholders, parsed once. bind() fills in
+// the terms and returns a connection ready to search.
+function Prepared(conn, prepared) {
+  this._conn = conn;
+  this._prepared = prepared;
+}
+
+Prepared.prototype.bind = function (params) {
+  var clone = Object.create(this._conn);
+  clone._query = this._prepared.bind(params || {});
+  return clone;
+};
@@ -8,6 +8,21 @@ module.exports = ReadStream;
 
 util.inherits(ReadStream, Readable);
 
+// A page whose records are pushed as the target sends them
+function LivePage() {
+  this._records = [];
+  this._index = 0;
+  this.pending = true;
+}
+
+LivePage.prototype.hasNext = function () {
+  return this._index < this._records.length;
+};
+
+LivePage.prototype.next = function () {
+  return this._records[this._index++];
+};
+
 var stream = ReadStream.prototype;
 
 function ReadStream(conn, options) {
@@ -19,11 +34,18 @@ function ReadStream(conn, options) {
     conn: conn,
     index: 0,
     start: options.start | 0,
-    chunk: (options.chunk || 20) | 0,
+    chunk: options.chunk === 'auto' ? 0 : (options.chunk || 20) | 0,
     limit: options.limit | 0,
+    render: options.render ? [].concat(options.render) : [],
+    prefetch: options.prefetch | 0,
     total: 0,
+    end: 0,
+    next: 0,
     resultset: null,
     records: null,
+    pages: [],
+    async: /^(1|T)$/.test(conn.get('async')),
+    fetching: 0,
     waiting: false,
     destroyed: false
   };
@@ -46,12 +68,19 @@ stream._read = function () {
     return state.waiting = true;
   }
 
-  if (!(state.records && state.records.hasNext())) {
-    this._moreRecords();
-    return state.waiting = true;
+  while (!(state.records && state.records.hasNext())) {
+    if (state.records && state.records.pending) {
+      return state.waiting = true;
+    }
+    if (!state.pages.length) {
+      this._moreRecords();
+      return state.waiting = true;
+    }
+    state.records = state.pages.shift();
   }
 
   var record = state.records.next();
+  this._prefetch();
   this.push(record && new Record(record));
 
   state.index += 1;
@@ -65,6 +94,11 @@ stream._read = function () {
 
 stream.destroy = function () {
   var state = this._zoomState;
+
+  // Newer versions of node call this again once 'end' was emitted
+  if (!state) {
+    return;
+  }
   state.destroyed = true;
   delete this._zoomState;
   this.emit('close');
@@ -80,27 +114,102 @@ stream._getResultset = function () {
       this.destroy();
       return;
     }
+    // chunk: 'auto' sizes the presents of this result set only
+    if (!state.chunk) {
+      resultset.setOption('presentChunk', 'auto');
+    }
     state.resultset = resultset;
     state.total = resultset.size();
+    state.next = state.start;
+    state.end = state.limit
+      ? Math.min(state.total, state.start + state.limit)
+      : state.total;
     this._zoomReady();
   }.bind(this));
 };
 
+// Each page is one getRecords() call. With `prefetch: n` up to n calls are
+// kept outstanding: a new one is issued as soon as any page returns or is
+// taken by the consumer, as long as fewer than n pages wait ahead of the
+// one being read. Pages enter the queue when they are requested, so
+// records come out in order whichever call returns first. Nothing is
+// pushed beyond what _read() asks for, so highWaterMark still applies.
+// Unless records are rendered on the threadpool, async connections hand
+// out each record of a page as soon as it has been received. With
+// `chunk: 'auto'` a page is as large as the present chunk YAZ settled on
+// for the target so far.
 stream._moreRecords = function () {
   var state = this._zoomState;
+
+  if (state.next >= state.end) {
+    if (!state.fetching) {
+      this.push(null);
+      this.destroy();
+    }
+    return;
+  }
+
   var resultset = state.resultset;
-  var start = state.start + state.index;
-  var count = state.chunk;
+  var start = state.next;
+  var chunk = state.chunk
+    || resultset.getOption('presentChunkSize') | 0 || 20;
+  var count = Math.min(chunk, state.end - start);
+  var page = new LivePage();
+  var live = !state.render.length;
+
+  var progress = function (record) {
+    if (!state.destroyed) {
+      page._records.push(record);
+      this._zoomReady();
+    }
+  }.bind(this);
+
+  var done = function (err, records) {
+    if (state.destroyed) {
+      return;
+    }
+    state.fetching -= 1;
 
-  resultset.getRecords(start, count, function (err, records) {
     if (err) {
       this.emit('error', err);
       this.destroy();
       return;
     }
-    state.records = records;
+    while (records.hasNext()) {
+      page._records.push(records.next());
+    }
+    page.pending = false;
+    this._prefetch();
     this._zoomReady();
-  }.bind(this));
+  }.bind(this);
+
+  state.fetching += 1;
+  state.next = start + count;
+  state.pages.push(page);
+
+  if (live) {
+    resultset.getRecords(start, count, progress, done);
+  } else {
+    resultset.getRecords(start, count, state.render, done);
+  }
+};
+
+// Tops the window up. Calls on a threadpool connection would run on
+// several threads against the same ZOOM connection, so there the pages
+// read ahead are requested one after another instead.
+stream._prefetch = function () {
+  var state = this._zoomState;
+
+  if (!state || !state.prefetch) {
+    return;
+  }
+
+  var window = state.async ? state.prefetch : 1;
+
+  while (state.fetching < window && state.pages.length < state.prefetch
+    && state.next < state.end) {
+    this._moreRecords();
+  }
 };
 
 stream._zoomReady = function () {
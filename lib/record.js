@@ -11,8 +11,14 @@ Record.prototype = {
     return this._record.get(type);
   },
 
+  toObject: function (charset) {
+    return this._record.toObject(charset);
+  },
+
   get json() {
-    return JSON.parse(this.get('json'));
+    var obj = this.toObject();
+    return obj === undefined
+      ? JSON.parse(this.get('json; format=compact')) : obj;
   },
 
   get database() {
@@ -1,36 +1,76 @@
 'use strict';
 
 var noop = require('./noop');
+var Record = require('./record');
 var Records = require('./records');
 
 module.exports = ResultSet;
 
 function ResultSet(resultset) {
   this._resultset = resultset;
+  this._size = -1;
 }
 
 ResultSet.prototype = {
   set: function (key, val) {
-    this._resultset.set(key, val);
+    this._resultset.setOption(key, val);
     return this;
   },
 
   get: function (key) {
-    return this._resultset.get(key);
+    return this._resultset.getOption(key);
   },
 
+  // The hit count is fixed once the search is answered, so it is asked
+  // for only once; a new search comes with a new ResultSet
   get size() {
-    return this._resultset.size();
+    if (this._size < 0) {
+      this._size = this._resultset.size();
+    }
+    return this._size;
   },
 
-  getRecords: function (index, counts, cb) {
+  // true when the hit count came from zoom.cache without a search request
+  get cached() {
+    return this.get('cached') === '1';
+  },
+
+  getRecords: function (index, counts, opts, cb) {
+    if (typeof opts === 'function') {
+      cb = opts;
+      opts = null;
+    }
+
     cb || (cb = noop);
-    this._resultset.getRecords(index, counts, function (err, records) {
+    opts || (opts = {});
+
+    var done = function (err, records) {
       if (err) {
         cb(err);
         return;
       }
       cb(null, new Records(records));
-    });
+    };
+
+    var args = [index, counts];
+
+    if (opts.render && opts.render.length) {
+      args.push([].concat(opts.render));
+    }
+
+    // Records handed to onRecord are left out of the records passed to cb
+    if (opts.onRecord) {
+      args.push(function (record) {
+        opts.onRecord(new Record(record));
+      });
+    }
+
+    args.push(done);
+    this._resultset.getRecords.apply(this._resultset, args);
+  },
+
+  // ISO2709 records of a page as typed arrays over one Buffer
+  getColumns: function (index, counts, cb) {
+    this._resultset.getColumns(index, counts, cb || noop);
   }
 };
@@ -0,0 +1,58 @@
+#include "errors.h"
+#include "cache.h"
+
+using namespace v8;
+
+namespace node_zoom {
+
+void Cache::Init(Handle<Object> exports) {
+    NanScope();
+
+    Local<Object> cache = NanNew<Object>();
+    NODE_SET_METHOD(cache, "configure", Configure);
+    NODE_SET_METHOD(cache, "stats", Stats);
+
+    exports->Set(NanNew("Cache"), cache);
+}
+
+NAN_METHOD(Cache::Configure) {
+    NanScope();
+
+    if (args.Length() < 1) {
+        NanThrowError(ArgsSizeError("Configure", 1, args.Length()));
+        return;
+    }
+
+    if (!args[0]->IsNumber()) {
+        NanThrowError(ArgTypeError("first", "number"));
+        return;
+    }
+
+    if (args.Length() > 1 && !args[1]->IsNumber()) {
+        NanThrowError(ArgTypeError("second", "number"));
+        return;
+    }
+
+    ZOOM_cache_configure(static_cast<size_t>(args[0]->NumberValue()));
+
+    if (args.Length() > 1) {
+        ZOOM_cache_configure_search(args[1]->Int32Value());
+    }
+}
+
+NAN_METHOD(Cache::Stats) {
+    NanScope();
+
+    size_t entries, bytes, hits, misses;
+    Local<Object> stats = NanNew<Object>();
+
+    ZOOM_cache_stat(&entries, &bytes, &hits, &misses);
+    stats->Set(NanNew("entries"), NanNew<Number>(entries));
+    stats->Set(NanNew("bytes"), NanNew<Number>(bytes));
+    stats->Set(NanNew("hits"), NanNew<Number>(hits));
+    stats->Set(NanNew("misses"), NanNew<Number>(misses));
+
+    NanReturnValue(stats);
+}
+
+} // namespace node_zoom
@@ -0,0 +1,19 @@
+#pragma once
+#include <nan.h>
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+// Process-wide record and hit count cache shared by all connections
+// (ZOOM_cache_*)
+class Cache {
+    public:
+        static void Init(v8::Handle<v8::Object> exports);
+        static NAN_METHOD(Configure);
+        static NAN_METHOD(Stats);
+};
+
+} // namespace node_zoom
@@ -0,0 +1,90 @@
+#include <string.h>
+#include "columns.h"
+
+extern "C" {
+    #include <yaz/oid_db.h>
+    #include <yaz/proto.h>
+}
+
+using namespace v8;
+
+namespace node_zoom {
+
+MarcColumns::MarcColumns() : index_(yaz_marc_index_create()) {}
+
+MarcColumns::~MarcColumns() {
+    yaz_marc_index_destroy(index_);
+}
+
+// Records that are missing or not ISO2709 keep their position with an
+// offset of -1 and no fields.
+void MarcColumns::Add(ZOOM_record zrecord) {
+    Z_External *ext = zrecord ? (Z_External *)
+        ZOOM_record_get(zrecord, "ext", NULL) : NULL;
+    int offset = buffer_.size();
+    int len = 0;
+
+    if (ext && ext->which == Z_External_octet
+        && yaz_oid_is_iso2709(ext->direct_reference)) {
+        len = ext->u.octet_aligned->len;
+        buffer_.append((const char *) ext->u.octet_aligned->buf, len);
+    }
+
+    yaz_marc_index_iso2709(index_, buffer_.data(), offset, len);
+}
+
+// Typed arrays come from their JS constructors, which every Node version
+// NAN supports has, and are filled through their external array data
+static Local<Object> TypedColumn(const char *type, const void *data,
+    size_t length, size_t size) {
+    Local<Function> cons = NanGetCurrentContext()->Global()
+        ->Get(NanNew(type)).As<Function>();
+    Local<Value> argv[] = { NanNew<Number>(length) };
+    Local<Object> column = cons->NewInstance(1, argv);
+
+    if (length) {
+        memcpy(column->GetIndexedPropertiesExternalArrayData(), data,
+            length * size);
+    }
+    return column;
+}
+
+static Local<Object> Int32Column(const int *data, size_t length) {
+    return TypedColumn("Int32Array", data, length, sizeof(int32_t));
+}
+
+static Local<Object> Int16Column(const short *data, size_t length) {
+    return TypedColumn("Int16Array", data, length, sizeof(int16_t));
+}
+
+Local<Object> MarcColumns::ToObject() {
+    NanEscapableScope();
+
+    Local<Object> obj = NanNew<Object>();
+    int records = index_->num_records;
+    int fields = index_->num_fields;
+    int subfields = index_->num_subfields;
+
+    obj->Set(NanNew("buffer"),
+        NanNewBufferHandle(buffer_.data(), buffer_.size()));
+    obj->Set(NanNew("size"), NanNew<Number>(records));
+    obj->Set(NanNew("recordOffsets"),
+        Int32Column(index_->record_offset, records));
+    obj->Set(NanNew("recordFields"),
+        Int32Column(index_->record_field, records + 1));
+    obj->Set(NanNew("tags"), Int16Column(index_->field_tag, fields));
+    obj->Set(NanNew("fieldOffsets"),
+        Int32Column(index_->field_offset, fields));
+    obj->Set(NanNew("fieldLengths"),
+        Int32Column(index_->field_length, fields));
+    obj->Set(NanNew("fieldSubfields"),
+        Int32Column(index_->field_subfield, fields + 1));
+    obj->Set(NanNew("subfieldOffsets"),
+        Int32Column(index_->subfield_offset, subfields));
+    obj->Set(NanNew("subfieldLengths"),
+        Int32Column(index_->subfield_length, subfields));
+
+    return NanEscapeScope(obj);
+}
+
+} // namespace node_zoom
@@ -0,0 +1,28 @@
+#pragma once
+#include <nan.h>
+#include <string>
+
+extern "C" {
+    #include <yaz/zoom.h>
+    #include <yaz/marcdisp.h>
+}
+
+namespace node_zoom {
+
+// A page of ISO2709 records indexed into flat arrays (yaz_marc_index)
+// over one copy of their bytes. Built on the threadpool; handed to JS as
+// a Buffer and typed arrays so no object is created per field.
+class MarcColumns {
+    public:
+        MarcColumns();
+        ~MarcColumns();
+
+        void Add(ZOOM_record zrecord);
+        v8::Local<v8::Object> ToObject();
+
+    protected:
+        std::string buffer_;
+        yaz_marc_index_t index_;
+};
+
+} // namespace node_zoom
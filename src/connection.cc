@@ -1,4 +1,5 @@
 #include <uv.h>
+#include <string.h>
 #include <sstream>
 #include "errors.h"
 #include "query.h"
@@ -22,18 +23,143 @@ void Connection::Init(Handle<Object> exports) {
     // Prototype
     NODE_SET_PROTOTYPE_METHOD(tpl, "connect", Connect);
     NODE_SET_PROTOTYPE_METHOD(tpl, "destory", Destory);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "release", Release);
     NODE_SET_PROTOTYPE_METHOD(tpl, "search", Search);
 
     NanAssignPersistent(constructor, tpl->GetFunction());
     exports->Set(NanNew("Connection"), tpl->GetFunction());
 }
 
-Connection::Connection(Options *opts) {
-    zconn_ = ZOOM_connection_create(opts->zoom_options());
+Connection::Connection(Options *opts, Pool *pool) :
+    zopts_(opts->zoom_options()), driver_(NULL), pool_(pool),
+    pending_(NULL), pooled_(false) {
+    zconn_ = ZOOM_connection_create(zopts_);
+
+    if (pool_) {
+        pool_->Attach();
+    }
 }
 
+// Result sets may outlive us, so a collected connection is never pooled
 Connection::~Connection() {
-    ZOOM_connection_destroy(zconn_);
+    Close(false);
+
+    if (pool_) {
+        pool_->Detach();
+    }
+}
+
+// Everything ZOOM_connection_connect reads. A pooled session is already
+// connected, so connect returns early and never looks at these again:
+// sessions are only shared between connections that agree on all of them.
+static std::string PoolKey(ZOOM_connection zconn, const char *host, int port) {
+    static const char *keys[] = {
+        "databaseName", "user", "group", "password", "pass",
+        "authenticationMode", "proxy", "tproxy", "charset", "lang",
+        "sru", "sru_version", "cookie", "clientIP", "async", "pipeline",
+        "preferredMessageSize", "maximumRecordSize",
+        "implementationId", "implementationName", "implementationVersion",
+        NULL
+    };
+    std::ostringstream ss;
+
+    ss << host << ":" << port;
+
+    for (int i = 0; keys[i]; i++) {
+        const char *value = ZOOM_connection_option_get(zconn, keys[i]);
+        ss << '\0' << (value ? value : "");
+    }
+
+    return ss.str();
+}
+
+// Called once the pool has a connection for us: zconn is an established
+// session to reuse, or NULL to connect our own.
+void Connection::Resume(ZOOM_connection zconn) {
+    ConnectWorker *worker = pending_;
+
+    pending_ = NULL;
+    pooled_ = true;
+
+    if (zconn) {
+        ZOOM_connection_set_options_parent(zconn, zopts_);
+        ZOOM_connection_destroy(zconn_);
+        zconn_ = zconn;
+    }
+
+    worker->Bind(zconn_);
+    Dispatch(worker);
+}
+
+// Hands the connection back to the pool (when reuse is set) or destroys it.
+// While followers of a search we led still use its result set, the session
+// goes to the driver instead, which destroys it once they are done.
+void Connection::Close(bool reuse) {
+    bool adopted = false;
+
+    if (driver_) {
+        if (driver_->Pinned()) {
+            driver_->Adopt();
+            adopted = true;
+        } else {
+            driver_->Close();
+        }
+        driver_ = NULL;
+    }
+
+    if (pending_) {
+        pool_->Cancel(key_, this);
+        pending_->Abort("Connection destroyed");
+        pending_->WorkComplete();
+        pending_->Destroy();
+        pending_ = NULL;
+    }
+
+    if (adopted) {
+        if (pooled_) {
+            pool_->Release(key_, NULL);
+        }
+    } else if (pooled_ && reuse) {
+        pool_->Release(key_, zconn_);
+    } else {
+        ZOOM_connection_destroy(zconn_);
+
+        if (pooled_) {
+            pool_->Release(key_, NULL);
+        }
+    }
+
+    zconn_ = NULL;
+    pooled_ = false;
+}
+
+// Connections with the "async" option are driven from the main loop,
+// everything else blocks a threadpool thread per operation.
+Driver *Connection::driver() {
+    if (!driver_) {
+        const char *async = ZOOM_connection_option_get(zconn_, "async");
+
+        if (async && (!strcmp(async, "1") || !strcmp(async, "T"))) {
+            driver_ = new Driver(zconn_);
+        }
+    }
+    return driver_;
+}
+
+// Searches are only coalesced on async connections, where the shared
+// result set is never used from two threads; "coalesce" 0 turns it off.
+bool Connection::coalesce() {
+    const char *coalesce = ZOOM_connection_option_get(zconn_, "coalesce");
+
+    return driver() && !(coalesce && !strcmp(coalesce, "0"));
+}
+
+void Connection::Dispatch(ZoomWorker *worker) {
+    if (driver()) {
+        driver_->Queue(worker);
+    } else {
+        NanAsyncQueueWorker(worker);
+    }
 }
 
 NAN_METHOD(Connection::New) {
@@ -45,12 +171,18 @@ NAN_METHOD(Connection::New) {
             return;
         }
         Options* opts = node::ObjectWrap::Unwrap<Options>(args[0]->ToObject());
-        Connection* obj = new Connection(opts);
+        Pool* pool = NULL;
+
+        if (args.Length() > 1 && args[1]->IsObject()) {
+            pool = node::ObjectWrap::Unwrap<Pool>(args[1]->ToObject());
+        }
+
+        Connection* obj = new Connection(opts, pool);
         obj->Wrap(args.This());
         NanReturnValue(args.This());
     } else {
-        const int argc = 1;
-        Local<Value> argv[argc] = { args[0] };
+        const int argc = 2;
+        Local<Value> argv[argc] = { args[0], args[1] };
         Local<Function> cons = NanNew<Function>(constructor);
         NanReturnValue(cons->NewInstance(argc, argv));
     }
@@ -87,14 +219,34 @@ NAN_METHOD(Connection::Connect) {
     ConnectWorker *worker = new ConnectWorker(
         callback, connection->zconn_, host, port);
 
-    NanAsyncQueueWorker(worker);
+    if (!connection->pool_ || connection->pooled_ || connection->pending_) {
+        connection->Dispatch(worker);
+        return;
+    }
+
+    ZOOM_connection zconn;
+
+    connection->key_ = PoolKey(connection->zconn_, **host, port);
+    connection->pending_ = worker;
+
+    if (connection->pool_->Acquire(connection->key_, connection, &zconn)) {
+        connection->Resume(zconn);
+    }
 }
 
 NAN_METHOD(Connection::Destory) {
     NanScope();
 
     Connection* connection = node::ObjectWrap::Unwrap<Connection>(args.This());
-    ZOOM_connection_destroy(connection->zconn_);
+    connection->Close(false);
+}
+
+// Like destory, but a pooled connection goes back to its pool
+NAN_METHOD(Connection::Release) {
+    NanScope();
+
+    Connection* connection = node::ObjectWrap::Unwrap<Connection>(args.This());
+    connection->Close(true);
 }
 
 NAN_METHOD(Connection::Search) {
@@ -120,55 +272,156 @@ NAN_METHOD(Connection::Search) {
     
     NanCallback *callback = new NanCallback(args[1].As<Function>());
     SearchWorker *worker = new SearchWorker(
-        callback, connection->zconn_, query->zoom_query());
+        callback, connection->zconn_, query->zoom_query(),
+        connection->driver());
 
-    NanAsyncQueueWorker(worker);
+    if (connection->coalesce() && worker->Join()) {
+        return;
+    }
+
+    connection->Dispatch(worker);
 }
 
 ConnectWorker::~ConnectWorker() {
     delete host_;
 }
 
-void ConnectWorker::Execute() {
+void ConnectWorker::Bind(ZOOM_connection zconn) {
+    zconn_ = zconn;
+}
+
+void ConnectWorker::Start() {
     ZOOM_connection_connect(zconn_, **host_, port_);
+}
 
-    int error = 0;
-    const char *errmsg, *addinfo;
+void ConnectWorker::Finish() {
+    CheckError(zconn_);
+}
 
-    if ((error = ZOOM_connection_error(zconn_, &errmsg, &addinfo))) {
-        std::ostringstream ss;
+std::map<std::string, SearchWorker *> SearchWorker::leaders_;
+
+// Everything that decides what the Search request (and a piggybacked
+// present) carries
+static std::string SearchKey(ZOOM_connection zconn, ZOOM_query zquery) {
+    static const char *keys[] = {
+        "databaseName", "user", "group", "password", "setname",
+        "preferredRecordSyntax", "elementSetName", "schema",
+        "start", "count", "presentChunk", "piggyback",
+        "smallSetUpperBound", "largeSetLowerBound", "mediumSetPresentNumber",
+        "facets", "rpnCharset", "charset", "lang", "pipeline", NULL
+    };
+    std::ostringstream ss;
 
-        ss << "error: "
-            << errmsg
-            << "(" << error << ") "
-            << addinfo;
+    ss << ZOOM_connection_option_get(zconn, "host");
 
-        SetErrorMessage(ss.str().c_str());
+    for (int i = 0; keys[i]; i++) {
+        const char *value = ZOOM_connection_option_get(zconn, keys[i]);
+        ss << '\0' << (value ? value : "");
     }
+
+    ss << '\0' << ZOOM_query_get_key(zquery);
+
+    return ss.str();
 }
 
-void SearchWorker::Execute() {
-    zresultset_ = ZOOM_connection_search(zconn_, zquery_);
+SearchWorker::SearchWorker(NanCallback *callback, ZOOM_connection zconn,
+    ZOOM_query query, Driver *driver) :
+    ZoomWorker(callback), zconn_(zconn), zquery_(query), zresultset_(NULL),
+    driver_(driver), shared_(NULL), pinned_(false), searched_(false) {
+    if (driver_) {
+        driver_->Attach();
+    }
+}
+
+SearchWorker::~SearchWorker() {
+    Leave();
+
+    if (driver_) {
+        if (pinned_) {
+            driver_->Unpin();
+        } else {
+            driver_->Detach();
+        }
+    }
+
+    if (shared_) {
+        shared_->Detach();
+    }
+}
+
+// Follows an identical search already in flight, or becomes the leader
+// for later ones. Returns true if the worker must not be dispatched.
+bool SearchWorker::Join() {
+    if (key_.empty()) {
+        if (!ZOOM_connection_option_get(zconn_, "host")) {
+            return false;
+        }
+        key_ = SearchKey(zconn_, zquery_);
+    }
+
+    std::map<std::string, SearchWorker *>::iterator it = leaders_.find(key_);
+
+    if (it != leaders_.end()) {
+        it->second->followers_.push_back(this);
+        return true;
+    }
 
-    int error = 0;
-    const char *errmsg, *addinfo;
+    leaders_[key_] = this;
+    return false;
+}
 
-    if ((error = ZOOM_connection_error(zconn_, &errmsg, &addinfo))) {
-        std::ostringstream ss;
+void SearchWorker::Leave() {
+    std::map<std::string, SearchWorker *>::iterator it = leaders_.find(key_);
 
-        ss << "error: "
-            << errmsg
-            << "(" << error << ") "
-            << addinfo;
+    if (it != leaders_.end() && it->second == this) {
+        leaders_.erase(it);
+    }
+}
 
-        SetErrorMessage(ss.str().c_str());
+// Takes the leader's result set, which lives on the leader's connection
+void SearchWorker::Share(ZOOM_resultset zresultset, Driver *driver,
+    SharedOptions *shared) {
+    ZOOM_resultset_addref(zresultset);
+    zresultset_ = zresultset;
+
+    driver->Pin();
+    if (driver_) {
+        driver_->Detach();
     }
+    driver_ = driver;
+    pinned_ = true;
+
+    shared->Attach();
+    shared_ = shared;
+}
+
+void SearchWorker::Start() {
+    zresultset_ = ZOOM_connection_search(zconn_, zquery_);
+}
+
+void SearchWorker::Finish() {
+    searched_ = true;
+    CheckError(zconn_);
 }
 
 void SearchWorker::HandleOKCallback() {
     NanScope();
 
-    ResultSet* resultset = new ResultSet(zresultset_);
+    std::vector<SearchWorker *> followers;
+
+    Leave();
+    followers.swap(followers_);
+
+    if (!followers.empty() && !shared_) {
+        shared_ = new SharedOptions();
+    }
+
+    for (size_t i = 0; i < followers.size(); i++) {
+        followers[i]->Share(zresultset_, driver_, shared_);
+    }
+
+    ResultSet* resultset = new ResultSet(zresultset_, driver_, shared_,
+        pinned_);
     Local<Object> wrapper = NanNew(ResultSet::constructor)->NewInstance();
     NanSetInternalFieldPointer(wrapper, 0, resultset);
 
@@ -178,6 +431,34 @@ void SearchWorker::HandleOKCallback() {
     };
 
     callback->Call(2, argv);
+
+    for (size_t i = 0; i < followers.size(); i++) {
+        followers[i]->WorkComplete();
+        followers[i]->Destroy();
+    }
+}
+
+void SearchWorker::HandleErrorCallback() {
+    std::vector<SearchWorker *> followers;
+
+    Leave();
+    followers.swap(followers_);
+
+    for (size_t i = 0; i < followers.size(); i++) {
+        SearchWorker *follower = followers[i];
+
+        if (searched_) {
+            follower->Abort(ErrorMessage());
+            follower->WorkComplete();
+            follower->Destroy();
+        } else if (!follower->Join()) {
+            // Our connection went away before the search was answered:
+            // the first follower searches on its own and leads the rest
+            follower->driver_->Queue(follower);
+        }
+    }
+
+    ZoomWorker::HandleErrorCallback();
 }
 
 } // namespace node_zoom
@@ -1,6 +1,13 @@
 #pragma once
 #include <nan.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "driver.h"
+#include "worker.h"
 #include "options.h"
+#include "pool.h"
+#include "resultset.h"
 
 extern "C" {
     #include <yaz/zoom.h>
@@ -8,30 +15,47 @@ extern "C" {
 
 namespace node_zoom {
 
+class ConnectWorker;
+
 class Connection : public node::ObjectWrap {
     public:
-        explicit Connection(Options *opts);
+        Connection(Options *opts, Pool *pool);
         ~Connection();
 
         static void Init(v8::Handle<v8::Object> exports);
         static NAN_METHOD(New);
         static NAN_METHOD(Connect);
         static NAN_METHOD(Destory);
+        static NAN_METHOD(Release);
         static NAN_METHOD(Search);
+        void Dispatch(ZoomWorker *worker);
+        void Resume(ZOOM_connection zconn);
+        Driver *driver();
+        bool coalesce();
 
     protected:
+        void Close(bool reuse);
+
         ZOOM_connection zconn_;
+        ZOOM_options zopts_;
+        Driver *driver_;
+        Pool *pool_;
+        std::string key_;
+        ConnectWorker *pending_;
+        bool pooled_;
         static v8::Persistent<v8::Function> constructor;
 };
 
-class ConnectWorker : public NanAsyncWorker {
+class ConnectWorker : public ZoomWorker {
     public:
         ConnectWorker(NanCallback *callback, ZOOM_connection zconn,
             NanUtf8String *host, int port) :
-            NanAsyncWorker(callback), zconn_(zconn),
+            ZoomWorker(callback), zconn_(zconn),
             host_(host), port_(port) {};
         ~ConnectWorker();
-        void Execute();
+        void Bind(ZOOM_connection zconn);
+        void Start();
+        void Finish();
 
     protected:
         ZOOM_connection zconn_;
@@ -39,19 +63,39 @@ class ConnectWorker : public NanAsyncWorker {
         int port_;
 };
 
-class SearchWorker : public NanAsyncWorker {
+// Identical searches in flight at the same time on async connections are
+// coalesced: the first one (the leader) is sent, the others follow it and
+// get their own ResultSet on the leader's result set once it completes.
+// Followers pin the leader's session, so it stays open for them after the
+// leader's connection is released, and keep result set options of their
+// own (SharedOptions).
+class SearchWorker : public ZoomWorker {
     public:
         SearchWorker(NanCallback *callback, ZOOM_connection zconn,
-            ZOOM_query query) :
-            NanAsyncWorker(callback), zconn_(zconn), zquery_(query) {};
-        ~SearchWorker() {};
-        void Execute();
+            ZOOM_query query, Driver *driver);
+        ~SearchWorker();
+        bool Join();
+        void Start();
+        void Finish();
         void HandleOKCallback();
+        void HandleErrorCallback();
 
     protected:
+        void Leave();
+        void Share(ZOOM_resultset zresultset, Driver *driver,
+            SharedOptions *shared);
+
         ZOOM_connection zconn_;
         ZOOM_query zquery_;
         ZOOM_resultset zresultset_;
+        Driver *driver_;
+        SharedOptions *shared_;
+        bool pinned_;
+        std::string key_;
+        std::vector<SearchWorker *> followers_;
+        bool searched_;
+
+        static std::map<std::string, SearchWorker *> leaders_;
 };
 
 } // namespace node_zoom
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include "driver.h"
+
+namespace node_zoom {
+
+static void AbortWorker(ZoomWorker *worker) {
+    worker->Abort("Connection destroyed");
+    worker->WorkComplete();
+    worker->Destroy();
+}
+
+Driver::Driver(ZOOM_connection zconn) :
+    zconn_(zconn), current_(NULL), poll_(NULL), depth_(0), refs_(1),
+    pins_(0), owner_(false), closing_(false), progressing_(false) {
+    timer_ = static_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+    uv_timer_init(uv_default_loop(), timer_);
+    timer_->data = this;
+}
+
+Driver::~Driver() {
+    Unwatch();
+    uv_close(reinterpret_cast<uv_handle_t *>(timer_), OnClose);
+
+    if (owner_) {
+        ZOOM_connection_destroy(zconn_);
+    }
+}
+
+void Driver::Queue(ZoomWorker *worker) {
+    if (closing_) {
+        AbortWorker(worker);
+        return;
+    }
+
+    queue_.push_back(worker);
+
+    if (!depth_) {
+        Run();
+    }
+}
+
+// Drops the connection's reference; workers still queued are aborted
+void Driver::Close() {
+    closing_ = true;
+    depth_++;
+    Unwatch();
+
+    // A worker in Progress() is aborted by Run() once it returned
+    if (current_ && !progressing_) {
+        queue_.push_front(current_);
+        current_ = NULL;
+    }
+
+    while (!queue_.empty()) {
+        ZoomWorker *worker = queue_.front();
+        queue_.pop_front();
+        AbortWorker(worker);
+    }
+
+    depth_--;
+    Detach();
+}
+
+// Drops the connection's reference like Close(), but queued workers keep
+// running and the session is destroyed with the driver
+void Driver::Adopt() {
+    owner_ = true;
+    Detach();
+}
+
+void Driver::Attach() {
+    refs_++;
+}
+
+void Driver::Detach() {
+    if (!--refs_ && !depth_) {
+        delete this;
+    }
+}
+
+void Driver::Pin() {
+    pins_++;
+    Attach();
+}
+
+void Driver::Unpin() {
+    pins_--;
+    Detach();
+}
+
+bool Driver::Pinned() {
+    return pins_ > 0;
+}
+
+// Start queued workers and drain ZOOM events until the connection either
+// waits for socket IO or has nothing left to do.
+void Driver::Run() {
+    depth_++;
+
+    while (!closing_) {
+        if (!current_) {
+            if (queue_.empty()) {
+                break;
+            }
+            current_ = queue_.front();
+            queue_.pop_front();
+            current_->Start();
+        }
+
+        while (ZOOM_event_nonblock(1, &zconn_))
+            ;
+
+        if (!ZOOM_connection_is_idle(zconn_)
+            && ZOOM_connection_get_mask(zconn_)) {
+            progressing_ = true;
+            current_->Progress();
+            progressing_ = false;
+
+            // Progress may have run JS that closed the connection
+            if (closing_) {
+                AbortWorker(current_);
+                current_ = NULL;
+            } else {
+                Watch();
+            }
+            break;
+        }
+
+        Complete();
+    }
+
+    depth_--;
+
+    if (!refs_ && !depth_) {
+        delete this;
+    }
+}
+
+// A fresh poll handle is used for every wait: ZOOM may close and reopen
+// the socket (reconnects, resolver pipe) and the descriptor number can be
+// reused, so a handle must never outlive the IO it was started for.
+void Driver::Watch() {
+    int fd = ZOOM_connection_get_socket(zconn_);
+    int mask = ZOOM_connection_get_mask(zconn_);
+    int events = 0;
+
+    if (mask & ZOOM_SELECT_READ) {
+        events |= UV_READABLE;
+    }
+    if (mask & ZOOM_SELECT_WRITE) {
+        events |= UV_WRITABLE;
+    }
+    if (!events) {
+        events = UV_READABLE;
+    }
+
+    poll_ = static_cast<uv_poll_t *>(malloc(sizeof(uv_poll_t)));
+    uv_poll_init(uv_default_loop(), poll_, fd);
+    poll_->data = this;
+    uv_poll_start(poll_, events, OnPoll);
+
+    uint64_t timeout = ZOOM_connection_get_timeout(zconn_);
+    uv_timer_start(timer_, OnTimeout, timeout * 1000, 0);
+}
+
+void Driver::Unwatch() {
+    if (poll_) {
+        uv_close(reinterpret_cast<uv_handle_t *>(poll_), OnClose);
+        poll_ = NULL;
+    }
+    uv_timer_stop(timer_);
+}
+
+void Driver::Complete() {
+    ZoomWorker *worker = current_;
+    current_ = NULL;
+
+    worker->Finish();
+
+    if (worker->HasProcess()) {
+        worker->QueueProcess();
+        return;
+    }
+
+    worker->WorkComplete();
+    worker->Destroy();
+}
+
+void Driver::OnPoll(uv_poll_t *handle, int status, int events) {
+    Driver *driver = static_cast<Driver *>(handle->data);
+    int mask = 0;
+
+    if (status < 0) {
+        mask |= ZOOM_SELECT_EXCEPT;
+    } else {
+        if (events & UV_READABLE) {
+            mask |= ZOOM_SELECT_READ;
+        }
+        if (events & UV_WRITABLE) {
+            mask |= ZOOM_SELECT_WRITE;
+        }
+    }
+
+    driver->Unwatch();
+    ZOOM_connection_fire_event_socket(driver->zconn_, mask);
+    driver->Run();
+}
+
+DRIVER_TIMER_CB(Driver::OnTimeout) {
+    Driver *driver = static_cast<Driver *>(handle->data);
+
+    driver->Unwatch();
+    ZOOM_connection_fire_event_timeout(driver->zconn_);
+    driver->Run();
+}
+
+void Driver::OnClose(uv_handle_t *handle) {
+    free(handle);
+}
+
+} // namespace node_zoom
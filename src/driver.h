@@ -0,0 +1,66 @@
+#pragma once
+#include <uv.h>
+#include <deque>
+#include "worker.h"
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+#if UV_VERSION_MAJOR == 0
+#define DRIVER_TIMER_CB(name) void name(uv_timer_t *handle, int status)
+#else
+#define DRIVER_TIMER_CB(name) void name(uv_timer_t *handle)
+#endif
+
+namespace node_zoom {
+
+// Runs the ZOOM operations of an "async" connection on the main loop.
+// Workers are started one at a time; the socket is watched with uv_poll
+// and the ZOOM timeout with uv_timer until the task queue is idle again.
+// The driver is reference counted: result sets and workers that may queue
+// on it later attach to it, and it is deleted once Close() was called and
+// the last of them detached.
+// Followers of a coalesced search pin the driver of the leader's
+// connection instead. Closing that connection while pinned hands the
+// session over to the driver (Adopt), which keeps it running for them and
+// destroys it along with itself.
+class Driver {
+    public:
+        explicit Driver(ZOOM_connection zconn);
+
+        void Queue(ZoomWorker *worker);
+        void Close();
+        void Adopt();
+        void Attach();
+        void Detach();
+        void Pin();
+        void Unpin();
+        bool Pinned();
+
+    protected:
+        ~Driver();
+
+        void Run();
+        void Watch();
+        void Unwatch();
+        void Complete();
+
+        static void OnPoll(uv_poll_t *handle, int status, int events);
+        static DRIVER_TIMER_CB(OnTimeout);
+        static void OnClose(uv_handle_t *handle);
+
+        ZOOM_connection zconn_;
+        std::deque<ZoomWorker *> queue_;
+        ZoomWorker *current_;
+        uv_poll_t *poll_;
+        uv_timer_t *timer_;
+        int depth_;
+        int refs_;
+        int pins_;
+        bool owner_;
+        bool closing_;
+        bool progressing_;
+};
+
+} // namespace node_zoom
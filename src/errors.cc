@@ -38,4 +38,16 @@ v8::Local<v8::Value> ArgTypeError(const char *arg, const char *expect) {
     return NanTypeError(ss.str().c_str());
 }
 
+// For a $name placeholder of a prepared query
+v8::Local<v8::Value> ParamTypeError(const char *name, const char *problem) {
+    std::ostringstream ss;
+
+    ss << "Parameter $"
+        << name
+        << " "
+        << problem;
+
+    return NanTypeError(ss.str().c_str());
+}
+
 } // namespace node_zoom
@@ -5,5 +5,6 @@ namespace node_zoom {
 
 v8::Local<v8::Value> ArgsSizeError(const char *fnname, int expect, int actual);
 v8::Local<v8::Value> ArgTypeError(const char *arg, const char *expect);
+v8::Local<v8::Value> ParamTypeError(const char *name, const char *problem);
 
 } // namespace node_zoom
@@ -0,0 +1,347 @@
+#include <stdlib.h>
+#include <sstream>
+#include "errors.h"
+#include "query.h"
+#include "record.h"
+#include "options.h"
+#include "federation.h"
+
+using namespace v8;
+
+namespace node_zoom {
+
+Persistent<Function> Federation::constructor;
+
+void Federation::Init(Handle<Object> exports) {
+    NanScope();
+
+    // Prepare constructor template
+    Local<FunctionTemplate> tpl = NanNew<FunctionTemplate>(New);
+    tpl->SetClassName(NanNew("Federation"));
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+    // Prototype
+    NODE_SET_PROTOTYPE_METHOD(tpl, "add", Add);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "start", Start);
+
+    NanAssignPersistent(constructor, tpl->GetFunction());
+    exports->Set(NanNew("Federation"), tpl->GetFunction());
+}
+
+Federation::Federation(ZOOM_query query, NanCallback *emit) :
+    zquery_(query), emit_(emit), active_(0) {
+    ZOOM_query_addref(zquery_);
+}
+
+Federation::~Federation() {
+    for (size_t i = 0; i < targets_.size(); i++) {
+        Target *target = targets_[i];
+
+        Unwatch(target);
+        uv_close(reinterpret_cast<uv_handle_t *>(target->timer), OnClose);
+        ZOOM_resultset_destroy(target->zset);
+        ZOOM_connection_destroy(target->zconn);
+        delete target;
+    }
+    ZOOM_query_destroy(zquery_);
+    delete emit_;
+}
+
+NAN_METHOD(Federation::New) {
+    NanScope();
+
+    if (args.IsConstructCall()) {
+        if (args.Length() < 2) {
+            NanThrowError(ArgsSizeError("Constructor", 2, args.Length()));
+            return;
+        }
+
+        if (!args[0]->IsObject()) {
+            NanThrowError(ArgTypeError("first", "object"));
+            return;
+        }
+
+        if (!args[1]->IsFunction()) {
+            NanThrowError(ArgTypeError("second", "function"));
+            return;
+        }
+
+        Query* query = node::ObjectWrap::Unwrap<Query>(args[0]->ToObject());
+        NanCallback *emit = new NanCallback(args[1].As<Function>());
+        Federation* obj = new Federation(query->zoom_query(), emit);
+        obj->Wrap(args.This());
+        NanReturnValue(args.This());
+    } else {
+        const int argc = 2;
+        Local<Value> argv[argc] = { args[0], args[1] };
+        Local<Function> cons = NanNew<Function>(constructor);
+        NanReturnValue(cons->NewInstance(argc, argv));
+    }
+}
+
+NAN_METHOD(Federation::Add) {
+    NanScope();
+
+    if (args.Length() < 3) {
+        NanThrowError(ArgsSizeError("Add", 3, args.Length()));
+        return;
+    }
+
+    if (!args[0]->IsObject()) {
+        NanThrowError(ArgTypeError("first", "object"));
+        return;
+    }
+
+    if (!args[1]->IsString()) {
+        NanThrowError(ArgTypeError("second", "string"));
+        return;
+    }
+
+    if (!args[2]->IsNumber()) {
+        NanThrowError(ArgTypeError("third", "number"));
+        return;
+    }
+
+    Federation* federation = node::ObjectWrap::Unwrap<Federation>(args.This());
+    Options* opts = node::ObjectWrap::Unwrap<Options>(args[0]->ToObject());
+    NanUtf8String host(args[1]);
+
+    Target *target = new Target;
+    target->federation = federation;
+    target->index = federation->targets_.size();
+    target->host = *host;
+    target->port = args[2]->Uint32Value();
+    target->zconn = ZOOM_connection_create(opts->zoom_options());
+    target->zset = NULL;
+    target->poll = NULL;
+    target->timer = static_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+    target->next = 0;
+    target->done = false;
+
+    uv_timer_init(uv_default_loop(), target->timer);
+    target->timer->data = target;
+    ZOOM_connection_option_set(target->zconn, "async", "1");
+
+    federation->targets_.push_back(target);
+    federation->zconns_.push_back(target->zconn);
+
+    NanReturnValue(NanNew<Number>(target->index));
+}
+
+NAN_METHOD(Federation::Start) {
+    NanScope();
+
+    Federation* federation = node::ObjectWrap::Unwrap<Federation>(args.This());
+
+    if (federation->active_) {
+        NanReturnValue(args.This());
+    }
+
+    if (federation->targets_.empty()) {
+        // Nothing to search, but callers still wait for "done"; report it
+        // from the loop so it arrives after start() returns
+        uv_timer_t *timer =
+            static_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+
+        uv_timer_init(uv_default_loop(), timer);
+        timer->data = federation;
+        federation->Ref();
+        uv_timer_start(timer, OnEmpty, 0, 0);
+        NanReturnValue(args.This());
+    }
+
+    for (size_t i = 0; i < federation->targets_.size(); i++) {
+        Target *target = federation->targets_[i];
+        const char *start = ZOOM_connection_option_get(target->zconn, "start");
+
+        target->next = start ? atoi(start) : 0;
+        ZOOM_connection_connect(
+            target->zconn, target->host.c_str(), target->port);
+        target->zset = ZOOM_connection_search(
+            target->zconn, federation->zquery_);
+        federation->active_++;
+    }
+
+    // Keep the JS object alive until every target has finished
+    federation->Ref();
+    federation->Run();
+
+    NanReturnValue(args.This());
+}
+
+// Dispatch every pending ZOOM event to JS, then wait for socket IO on
+// the targets that are still busy.
+void Federation::Run() {
+    NanScope();
+    int i;
+
+    while ((i = ZOOM_event_nonblock(zconns_.size(), &zconns_[0]))) {
+        Target *target = targets_[i - 1];
+
+        switch (ZOOM_connection_last_event(target->zconn)) {
+            case ZOOM_EVENT_RECV_SEARCH: {
+                Local<Value> argv[] = {
+                    NanNew("search"),
+                    NanNew<Number>(target->index),
+                    NanNew<Number>(ZOOM_resultset_size(target->zset))
+                };
+                emit_->Call(3, argv);
+                break;
+            }
+            case ZOOM_EVENT_RECV_RECORD:
+                EmitRecords(target);
+                break;
+            case ZOOM_EVENT_END:
+                Finish(target);
+                break;
+        }
+    }
+
+    for (size_t j = 0; j < targets_.size(); j++) {
+        Target *target = targets_[j];
+
+        if (target->done || target->poll) {
+            continue;
+        }
+
+        if (!ZOOM_connection_is_idle(target->zconn)
+            && ZOOM_connection_get_mask(target->zconn)) {
+            Watch(target);
+        } else {
+            Finish(target);
+        }
+    }
+}
+
+void Federation::EmitRecords(Target *target) {
+    ZOOM_record zrecord;
+
+    while ((zrecord = ZOOM_resultset_record_ref(
+        target->zset, target->next))) {
+        Local<Value> argv[] = {
+            NanNew("record"),
+            NanNew<Number>(target->index),
+            Record::NewInstance(zrecord)
+        };
+
+        target->next++;
+        emit_->Call(3, argv);
+    }
+}
+
+void Federation::Finish(Target *target) {
+    if (target->done) {
+        return;
+    }
+
+    int error = 0;
+    const char *errmsg, *addinfo;
+    Local<Value> err = NanNull();
+
+    target->done = true;
+    zconns_[target->index] = NULL;
+    Unwatch(target);
+    EmitRecords(target);
+
+    if ((error = ZOOM_connection_error(target->zconn, &errmsg, &addinfo))) {
+        std::ostringstream ss;
+
+        ss << "error: "
+            << errmsg
+            << "(" << error << ") "
+            << addinfo;
+
+        err = NanError(ss.str().c_str());
+    }
+
+    Local<Value> argv[] = {
+        NanNew("end"),
+        NanNew<Number>(target->index),
+        err
+    };
+    emit_->Call(3, argv);
+
+    if (--active_ == 0) {
+        Local<Value> argv[] = { NanNew("done") };
+        emit_->Call(1, argv);
+        Unref();
+    }
+}
+
+// Like Driver::Watch, a new poll handle per wait since ZOOM may reopen
+// the socket under the same descriptor number.
+void Federation::Watch(Target *target) {
+    int fd = ZOOM_connection_get_socket(target->zconn);
+    int mask = ZOOM_connection_get_mask(target->zconn);
+    int events = 0;
+
+    if (mask & ZOOM_SELECT_READ) {
+        events |= UV_READABLE;
+    }
+    if (mask & ZOOM_SELECT_WRITE) {
+        events |= UV_WRITABLE;
+    }
+    if (!events) {
+        events = UV_READABLE;
+    }
+
+    target->poll = static_cast<uv_poll_t *>(malloc(sizeof(uv_poll_t)));
+    uv_poll_init(uv_default_loop(), target->poll, fd);
+    target->poll->data = target;
+    uv_poll_start(target->poll, events, OnPoll);
+
+    uint64_t timeout = ZOOM_connection_get_timeout(target->zconn);
+    uv_timer_start(target->timer, OnTimeout, timeout * 1000, 0);
+}
+
+void Federation::Unwatch(Target *target) {
+    if (target->poll) {
+        uv_close(reinterpret_cast<uv_handle_t *>(target->poll), OnClose);
+        target->poll = NULL;
+    }
+    uv_timer_stop(target->timer);
+}
+
+void Federation::OnPoll(uv_poll_t *handle, int status, int events) {
+    Target *target = static_cast<Target *>(handle->data);
+    int mask = 0;
+
+    if (status < 0) {
+        mask |= ZOOM_SELECT_EXCEPT;
+    } else {
+        if (events & UV_READABLE) {
+            mask |= ZOOM_SELECT_READ;
+        }
+        if (events & UV_WRITABLE) {
+            mask |= ZOOM_SELECT_WRITE;
+        }
+    }
+
+    target->federation->Unwatch(target);
+    ZOOM_connection_fire_event_socket(target->zconn, mask);
+    target->federation->Run();
+}
+
+DRIVER_TIMER_CB(Federation::OnTimeout) {
+    Target *target = static_cast<Target *>(handle->data);
+
+    target->federation->Unwatch(target);
+    ZOOM_connection_fire_event_timeout(target->zconn);
+    target->federation->Run();
+}
+
+DRIVER_TIMER_CB(Federation::OnEmpty) {
+    NanScope();
+    Federation *federation = static_cast<Federation *>(handle->data);
+    Local<Value> argv[] = { NanNew("done") };
+
+    uv_close(reinterpret_cast<uv_handle_t *>(handle), OnClose);
+    federation->emit_->Call(1, argv);
+    federation->Unref();
+}
+
+void Federation::OnClose(uv_handle_t *handle) {
+    free(handle);
+}
+
+} // namespace node_zoom
@@ -0,0 +1,62 @@
+#pragma once
+#include <nan.h>
+#include <uv.h>
+#include <string>
+#include <vector>
+#include "driver.h"
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+class Federation;
+
+struct Target {
+    Federation *federation;
+    size_t index;
+    std::string host;
+    int port;
+    ZOOM_connection zconn;
+    ZOOM_resultset zset;
+    uv_poll_t *poll;
+    uv_timer_t *timer;
+    size_t next;
+    bool done;
+};
+
+// Runs one query against many targets at once. All connections are in
+// async mode and multiplexed with ZOOM_event_nonblock; progress is
+// reported per target through the emit callback as it happens.
+class Federation : public node::ObjectWrap {
+    public:
+        Federation(ZOOM_query query, NanCallback *emit);
+        ~Federation();
+
+        static void Init(v8::Handle<v8::Object> exports);
+        static NAN_METHOD(New);
+        static NAN_METHOD(Add);
+        static NAN_METHOD(Start);
+
+    protected:
+        void Run();
+        void Watch(Target *target);
+        void Unwatch(Target *target);
+        void EmitRecords(Target *target);
+        void Finish(Target *target);
+
+        static void OnPoll(uv_poll_t *handle, int status, int events);
+        static DRIVER_TIMER_CB(OnTimeout);
+        static DRIVER_TIMER_CB(OnEmpty);
+        static void OnClose(uv_handle_t *handle);
+
+        ZOOM_query zquery_;
+        NanCallback *emit_;
+        std::vector<Target *> targets_;
+        std::vector<ZOOM_connection> zconns_;
+        size_t active_;
+        static v8::Persistent<v8::Function> constructor;
+};
+
+} // namespace node_zoom
@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <poll.h>
+#include "errors.h"
+#include "connection.h"
+#include "pool.h"
+
+using namespace v8;
+
+namespace node_zoom {
+
+Persistent<Function> Pool::constructor;
+
+void Pool::Init(Handle<Object> exports) {
+    NanScope();
+
+    // Prepare constructor template
+    Local<FunctionTemplate> tpl = NanNew<FunctionTemplate>(New);
+    tpl->SetClassName(NanNew("Pool"));
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+    // Prototype
+    NODE_SET_PROTOTYPE_METHOD(tpl, "drain", Drain);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "size", Size);
+
+    NanAssignPersistent(constructor, tpl->GetFunction());
+    exports->Set(NanNew("Pool"), tpl->GetFunction());
+}
+
+Pool::Pool(size_t max, uint64_t idle_timeout) :
+    max_(max), idle_timeout_(idle_timeout), idle_(0) {
+    timer_ = static_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+    uv_timer_init(uv_default_loop(), timer_);
+    uv_unref(reinterpret_cast<uv_handle_t *>(timer_));
+    timer_->data = this;
+
+    handoff_ = static_cast<uv_timer_t *>(malloc(sizeof(uv_timer_t)));
+    uv_timer_init(uv_default_loop(), handoff_);
+    handoff_->data = this;
+}
+
+Pool::~Pool() {
+    std::map<std::string, Target>::iterator it;
+
+    for (it = targets_.begin(); it != targets_.end(); ++it) {
+        while (!it->second.idle.empty()) {
+            ZOOM_connection_destroy(it->second.idle.front().zconn);
+            it->second.idle.pop_front();
+        }
+    }
+    uv_close(reinterpret_cast<uv_handle_t *>(timer_), OnClose);
+    uv_close(reinterpret_cast<uv_handle_t *>(handoff_), OnClose);
+}
+
+NAN_METHOD(Pool::New) {
+    NanScope();
+
+    if (args.IsConstructCall()) {
+        if (args.Length() < 2) {
+            NanThrowError(ArgsSizeError("Constructor", 2, args.Length()));
+            return;
+        }
+
+        if (!args[0]->IsNumber()) {
+            NanThrowError(ArgTypeError("first", "number"));
+            return;
+        }
+
+        if (!args[1]->IsNumber()) {
+            NanThrowError(ArgTypeError("second", "number"));
+            return;
+        }
+
+        Pool* obj = new Pool(args[0]->Uint32Value(), args[1]->Uint32Value());
+        obj->Wrap(args.This());
+        NanReturnValue(args.This());
+    } else {
+        const int argc = 2;
+        Local<Value> argv[argc] = { args[0], args[1] };
+        Local<Function> cons = NanNew<Function>(constructor);
+        NanReturnValue(cons->NewInstance(argc, argv));
+    }
+}
+
+NAN_METHOD(Pool::Drain) {
+    NanScope();
+
+    Pool* pool = node::ObjectWrap::Unwrap<Pool>(args.This());
+    std::map<std::string, Target>::iterator it;
+
+    for (it = pool->targets_.begin(); it != pool->targets_.end(); ++it) {
+        while (!it->second.idle.empty()) {
+            ZOOM_connection zconn = it->second.idle.front().zconn;
+            it->second.idle.pop_front();
+            pool->idle_--;
+            pool->Close(it->second, zconn);
+        }
+    }
+    uv_timer_stop(pool->timer_);
+
+    NanReturnValue(args.This());
+}
+
+NAN_METHOD(Pool::Size) {
+    NanScope();
+    Pool* pool = node::ObjectWrap::Unwrap<Pool>(args.This());
+    NanReturnValue(NanNew<Number>(pool->idle_));
+}
+
+// Connections using the pool keep it alive
+void Pool::Attach() {
+    Ref();
+}
+
+void Pool::Detach() {
+    Unref();
+}
+
+// Returns false when the target is at its limit; conn is then resumed by
+// Release() once a connection or slot frees up. Otherwise zconn is set to
+// an idle connection, or NULL when the caller should open a new one.
+bool Pool::Acquire(const std::string &key, Connection *conn,
+    ZOOM_connection *zconn) {
+    Target &target = targets_[key];
+
+    while (!target.idle.empty()) {
+        ZOOM_connection idle = target.idle.back().zconn;
+        target.idle.pop_back();
+        idle_--;
+
+        if (Healthy(idle)) {
+            *zconn = idle;
+            return true;
+        }
+        Close(target, idle);
+    }
+
+    if (target.open >= max_) {
+        target.waiters.push_back(conn);
+        return false;
+    }
+
+    target.open++;
+    *zconn = NULL;
+    return true;
+}
+
+void Pool::Cancel(const std::string &key, Connection *conn) {
+    std::deque<Connection *> &waiters = targets_[key].waiters;
+
+    for (size_t i = 0; i < waiters.size(); i++) {
+        if (waiters[i] == conn) {
+            waiters.erase(waiters.begin() + i);
+            return;
+        }
+    }
+
+    // Already picked to take over a connection; pass it on
+    for (size_t i = 0; i < handoffs_.size(); i++) {
+        if (handoffs_[i].conn == conn) {
+            ZOOM_connection zconn = handoffs_[i].zconn;
+            handoffs_.erase(handoffs_.begin() + i);
+            Release(key, zconn);
+            return;
+        }
+    }
+}
+
+// Takes back a connection handed out by Acquire(); NULL when the caller
+// destroyed it. Only idle sessions that still look alive are kept, cut
+// loose from the result sets of the previous user.
+void Pool::Release(const std::string &key, ZOOM_connection zconn) {
+    Target &target = targets_[key];
+
+    if (zconn && !(ZOOM_connection_is_idle(zconn) && Healthy(zconn))) {
+        Close(target, zconn);
+        zconn = NULL;
+    } else if (!zconn) {
+        target.open--;
+    } else {
+        ZOOM_connection_release_resultsets(zconn);
+    }
+
+    // Waiters are resumed from the loop: Release() may run while a
+    // Connection is being garbage collected.
+    if (!target.waiters.empty()) {
+        Handoff handoff = { target.waiters.front(), zconn };
+        target.waiters.pop_front();
+
+        if (!zconn) {
+            target.open++;
+        }
+        handoffs_.push_back(handoff);
+        uv_timer_start(handoff_, OnHandoff, 0, 0);
+        return;
+    }
+
+    if (zconn) {
+        Idle entry = { zconn, uv_now(uv_default_loop()) };
+        target.idle.push_back(entry);
+
+        if (idle_++ == 0 && idle_timeout_) {
+            uint64_t interval = idle_timeout_ / 2;
+            uv_timer_start(timer_, OnSweep, interval, interval ? interval : 1);
+        }
+    }
+}
+
+// An idle Z39.50 session has nothing to say: a readable socket means the
+// target closed it or sent a Close PDU. Sessions the target drops between
+// two checks are still recovered by ZOOM_test_reconnect, as connecting an
+// open connection only marks it for reconnection.
+bool Pool::Healthy(ZOOM_connection zconn) {
+    struct pollfd pfd;
+
+    pfd.fd = ZOOM_connection_get_socket(zconn);
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (pfd.fd < 0) {
+        return false;
+    }
+    return poll(&pfd, 1, 0) == 0;
+}
+
+void Pool::Close(Target &target, ZOOM_connection zconn) {
+    ZOOM_connection_destroy(zconn);
+    target.open--;
+}
+
+void Pool::Sweep() {
+    uint64_t now = uv_now(uv_default_loop());
+    std::map<std::string, Target>::iterator it;
+
+    for (it = targets_.begin(); it != targets_.end(); ++it) {
+        std::deque<Idle> &idle = it->second.idle;
+
+        for (size_t i = 0; i < idle.size(); ) {
+            if (now - idle[i].since >= idle_timeout_
+                || !Healthy(idle[i].zconn)) {
+                ZOOM_connection zconn = idle[i].zconn;
+                idle.erase(idle.begin() + i);
+                idle_--;
+                Close(it->second, zconn);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    if (!idle_) {
+        uv_timer_stop(timer_);
+    }
+}
+
+DRIVER_TIMER_CB(Pool::OnSweep) {
+    static_cast<Pool *>(handle->data)->Sweep();
+}
+
+DRIVER_TIMER_CB(Pool::OnHandoff) {
+    Pool *pool = static_cast<Pool *>(handle->data);
+
+    while (!pool->handoffs_.empty()) {
+        Handoff handoff = pool->handoffs_.front();
+        pool->handoffs_.pop_front();
+        handoff.conn->Resume(handoff.zconn);
+    }
+}
+
+void Pool::OnClose(uv_handle_t *handle) {
+    free(handle);
+}
+
+} // namespace node_zoom
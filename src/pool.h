@@ -0,0 +1,75 @@
+#pragma once
+#include <nan.h>
+#include <uv.h>
+#include <map>
+#include <deque>
+#include <string>
+#include "driver.h"
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+class Connection;
+
+// Keeps established ZOOM connections open per target (host, database
+// and authentication) so later Connection objects skip the TCP connect
+// and Init round trip. At most max_ connections are open per target;
+// further connects wait until one is released.
+class Pool : public node::ObjectWrap {
+    public:
+        Pool(size_t max, uint64_t idle_timeout);
+        ~Pool();
+
+        static void Init(v8::Handle<v8::Object> exports);
+        static NAN_METHOD(New);
+        static NAN_METHOD(Drain);
+        static NAN_METHOD(Size);
+
+        void Attach();
+        void Detach();
+
+        bool Acquire(const std::string &key, Connection *conn,
+            ZOOM_connection *zconn);
+        void Cancel(const std::string &key, Connection *conn);
+        void Release(const std::string &key, ZOOM_connection zconn);
+
+    protected:
+        struct Idle {
+            ZOOM_connection zconn;
+            uint64_t since;
+        };
+
+        struct Handoff {
+            Connection *conn;
+            ZOOM_connection zconn;
+        };
+
+        struct Target {
+            Target() : open(0) {};
+            std::deque<Idle> idle;
+            std::deque<Connection *> waiters;
+            size_t open;
+        };
+
+        static bool Healthy(ZOOM_connection zconn);
+        void Close(Target &target, ZOOM_connection zconn);
+        void Sweep();
+
+        static DRIVER_TIMER_CB(OnSweep);
+        static DRIVER_TIMER_CB(OnHandoff);
+        static void OnClose(uv_handle_t *handle);
+
+        std::map<std::string, Target> targets_;
+        std::deque<Handoff> handoffs_;
+        size_t max_;
+        uint64_t idle_timeout_;
+        size_t idle_;
+        uv_timer_t *timer_;
+        uv_timer_t *handoff_;
+        static v8::Persistent<v8::Function> constructor;
+};
+
+} // namespace node_zoom
@@ -0,0 +1,113 @@
+#include <string>
+#include <vector>
+#include "errors.h"
+#include "query.h"
+#include "prepared.h"
+
+using namespace v8;
+
+namespace node_zoom {
+
+Persistent<Function> Prepared::constructor;
+
+void Prepared::Init(Handle<Object> exports) {
+    NanScope();
+
+    // Prepare constructor template
+    Local<FunctionTemplate> tpl = NanNew<FunctionTemplate>(New);
+    tpl->SetClassName(NanNew("Prepared"));
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+    // Prototype
+    NODE_SET_PROTOTYPE_METHOD(tpl, "bind", Bind);
+
+    NanAssignPersistent(constructor, tpl->GetFunction());
+    exports->Set(NanNew("Prepared"), tpl->GetFunction());
+}
+
+Prepared::Prepared(ZOOM_prepared zprepared) : zprepared_(zprepared) {
+}
+
+Prepared::~Prepared() {
+    ZOOM_prepared_destroy(zprepared_);
+}
+
+NAN_METHOD(Prepared::New) {
+    NanScope();
+
+    if (args.IsConstructCall()) {
+        if (args.Length() < 2) {
+            NanThrowError(ArgsSizeError("Constructor", 2, args.Length()));
+            return;
+        }
+
+        NanUtf8String type(args[0]);
+        NanUtf8String query_str(args[1]);
+        ZOOM_prepared zprepared = ZOOM_prepared_create(*type, *query_str);
+
+        if (!zprepared) {
+            NanThrowError("Query Error");
+            return;
+        }
+
+        Prepared* obj = new Prepared(zprepared);
+        obj->Wrap(args.This());
+        NanReturnValue(args.This());
+    } else {
+        const int argc = 2;
+        Local<Value> argv[argc] = { args[0], args[1] };
+        Local<Function> cons = NanNew<Function>(constructor);
+        NanReturnValue(cons->NewInstance(argc, argv));
+    }
+}
+
+NAN_METHOD(Prepared::Bind) {
+    NanScope();
+
+    if (args.Length() < 1) {
+        NanThrowError(ArgsSizeError("Bind", 1, args.Length()));
+        return;
+    }
+
+    if (!args[0]->IsObject()) {
+        NanThrowError(ArgTypeError("first", "object"));
+        return;
+    }
+
+    Prepared* prepared = node::ObjectWrap::Unwrap<Prepared>(args.This());
+    Local<Object> params = args[0]->ToObject();
+    int num = ZOOM_prepared_num_params(prepared->zprepared_);
+    std::vector<std::string> names, values;
+    std::vector<const char *> name_ptrs, value_ptrs;
+
+    // Every placeholder needs a string; other properties are ignored
+    for (int i = 0; i < num; i++) {
+        const char *name = ZOOM_prepared_param_name(prepared->zprepared_, i);
+        Local<Value> value = params->Get(NanNew(name));
+
+        if (value->IsUndefined()) {
+            NanThrowError(ParamTypeError(name, "is not bound"));
+            return;
+        }
+        if (!value->IsString()) {
+            NanThrowError(ParamTypeError(name, "must be a string"));
+            return;
+        }
+        names.push_back(name);
+        values.push_back(*NanUtf8String(value));
+    }
+
+    for (size_t i = 0; i < names.size(); i++) {
+        name_ptrs.push_back(names[i].c_str());
+        value_ptrs.push_back(values[i].c_str());
+    }
+
+    ZOOM_query zquery = ZOOM_prepared_bind(prepared->zprepared_,
+        names.empty() ? NULL : &name_ptrs[0],
+        values.empty() ? NULL : &value_ptrs[0],
+        static_cast<int>(names.size()));
+
+    NanReturnValue(Query::NewInstance(zquery));
+}
+
+} // namespace node_zoom
@@ -0,0 +1,26 @@
+#pragma once
+#include <nan.h>
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+// Query template parsed once; Bind() creates Query objects from it
+// without parsing again (ZOOM_prepared_*)
+class Prepared : public node::ObjectWrap {
+    public:
+        explicit Prepared(ZOOM_prepared zprepared);
+        ~Prepared();
+
+        static void Init(v8::Handle<v8::Object> exports);
+        static NAN_METHOD(New);
+        static NAN_METHOD(Bind);
+
+    protected:
+        ZOOM_prepared zprepared_;
+        static v8::Persistent<v8::Function> constructor;
+};
+
+} // namespace node_zoom
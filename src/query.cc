@@ -1,5 +1,7 @@
+#include <sstream>
 #include "errors.h"
 #include "query.h"
+#include "transform.h"
 
 using namespace v8;
 
@@ -24,7 +26,9 @@ void Query::Init(Handle<Object> exports) {
     // Prototype
     NODE_SET_PROTOTYPE_METHOD(tpl, "prefix", Prefix);
     NODE_SET_PROTOTYPE_METHOD(tpl, "cql", CQL);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "cql2rpn", CQL2RPN);
     NODE_SET_PROTOTYPE_METHOD(tpl, "sortBy", SortBy);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "key", Key);
 
     NanAssignPersistent(constructor, tpl->GetFunction());
     exports->Set(NanNew("Query"), tpl->GetFunction());
@@ -53,6 +57,19 @@ NAN_METHOD(Query::New) {
     }
 }
 
+// Wraps a query made elsewhere, such as by Prepared::Bind
+Local<Object> Query::NewInstance(ZOOM_query zquery) {
+    NanEscapableScope();
+
+    Local<Object> wrapper = NanNew(constructor)->NewInstance();
+    Query* query = node::ObjectWrap::Unwrap<Query>(wrapper);
+
+    ZOOM_query_destroy(query->zquery_);
+    query->zquery_ = zquery;
+
+    return NanEscapeScope(wrapper);
+}
+
 NAN_METHOD(Query::Prefix) {
     NanScope();
     Query* query = node::ObjectWrap::Unwrap<Query>(args.This());
@@ -71,6 +88,49 @@ NAN_METHOD(Query::CQL) {
     NanReturnValue(args.This());
 }
 
+// CQL translated to RPN here, with a transform from zoom.cqlTransform()
+NAN_METHOD(Query::CQL2RPN) {
+    NanScope();
+
+    if (args.Length() < 2) {
+        NanThrowError(ArgsSizeError("CQL2RPN", 2, args.Length()));
+        return;
+    }
+
+    if (!args[1]->IsObject()) {
+        NanThrowError(ArgTypeError("second", "object"));
+        return;
+    }
+
+    Query* query = node::ObjectWrap::Unwrap<Query>(args.This());
+    Transform* transform =
+        node::ObjectWrap::Unwrap<Transform>(args[1]->ToObject());
+    NanUtf8String query_str(args[0]);
+
+    // The connection only collects diagnostics
+    ZOOM_connection zconn = ZOOM_connection_create(0);
+    int ret = ZOOM_query_cql2rpn_transform(query->zquery_, *query_str,
+        transform->zoom_transform(), zconn);
+
+    if (ret == -1) {
+        const char *errmsg, *addinfo;
+        int error = ZOOM_connection_error(zconn, &errmsg, &addinfo);
+        std::ostringstream ss;
+
+        ss << "error: "
+            << errmsg
+            << "(" << error << ") "
+            << (addinfo ? addinfo : "");
+
+        ZOOM_connection_destroy(zconn);
+        NanThrowError(ss.str().c_str());
+        return;
+    }
+
+    ZOOM_connection_destroy(zconn);
+    NanReturnValue(args.This());
+}
+
 NAN_METHOD(Query::SortBy) {
     NanScope();
 
@@ -96,6 +156,13 @@ NAN_METHOD(Query::SortBy) {
     NanReturnValue(args.This());
 }
 
+// Identifies query and sort criteria, as used by the search cache
+NAN_METHOD(Query::Key) {
+    NanScope();
+    Query* query = node::ObjectWrap::Unwrap<Query>(args.This());
+    NanReturnValue(NanNew(ZOOM_query_get_key(query->zquery_)));
+}
+
 ZOOM_query Query::zoom_query() {
     return zquery_;
 }
@@ -16,7 +16,10 @@ class Query : public node::ObjectWrap {
         static NAN_METHOD(New);
         static NAN_METHOD(Prefix);
         static NAN_METHOD(CQL);
+        static NAN_METHOD(CQL2RPN);
         static NAN_METHOD(SortBy);
+        static NAN_METHOD(Key);
+        static v8::Local<v8::Object> NewInstance(ZOOM_query zquery);
         ZOOM_query zoom_query();
 
     protected:
@@ -1,12 +1,28 @@
 #include "errors.h"
 #include "record.h"
 
+extern "C" {
+    #include <yaz/marcdisp.h>
+    #include <yaz/oid_db.h>
+    #include <yaz/proto.h>
+}
+
 using namespace v8;
 
 namespace node_zoom {
 
 Persistent<Function> Record::constructor;
 
+// Object keys of toObject() are the same for every record, so each one is
+// created once and kept in a persistent handle. Tags and subfield codes
+// are looked up in tables filled as they are first seen.
+static Persistent<String> leader_key;
+static Persistent<String> fields_key;
+static Persistent<String> subfields_key;
+static Persistent<String> ind_keys[9];
+static Persistent<String> tag_keys[1000];
+static Persistent<String> code_keys[256];
+
 void Record::Init() {
     NanScope();
 
@@ -17,12 +33,50 @@ void Record::Init() {
     
     // Prototype
     NODE_SET_PROTOTYPE_METHOD(tpl, "get", Get);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "toObject", ToObject);
 
     NanAssignPersistent(constructor, tpl->GetFunction());
+
+    char ind[] = "ind0";
+
+    NanAssignPersistent(leader_key, NanNew("leader"));
+    NanAssignPersistent(fields_key, NanNew("fields"));
+    NanAssignPersistent(subfields_key, NanNew("subfields"));
+    for (int i = 0; i < 9; i++) {
+        ind[3] = '1' + i;
+        NanAssignPersistent(ind_keys[i], NanNew(ind));
+    }
 }
 
 Record::Record(ZOOM_record record) : zrecord_(record) {}
 
+// Takes ownership of the record; the wrapper releases it once collected.
+Local<Object> Record::NewInstance(ZOOM_record record) {
+    return NewInstance(new Record(record));
+}
+
+Local<Object> Record::NewInstance(Record *record) {
+    NanEscapableScope();
+
+    Local<Object> wrapper = NanNew(constructor)->NewInstance();
+    record->Wrap(wrapper);
+
+    return NanEscapeScope(wrapper);
+}
+
+// Renders ahead of Get(); does not touch V8 so it may run on a worker
+// thread before the record is handed to JS.
+void Record::Render(const std::vector<std::string> &types) {
+    for (size_t i = 0; i < types.size(); i++) {
+        int len;
+        const char *value = ZOOM_record_get(zrecord_, types[i].c_str(), &len);
+
+        if (value && len >= 0) {
+            rendered_[types[i]] = std::string(value, len);
+        }
+    }
+}
+
 Record::~Record() {
     ZOOM_record_destroy(zrecord_);
 }
@@ -40,6 +94,13 @@ NAN_METHOD(Record::Get) {
     }
 
     NanUtf8String type(args[0]);
+    std::map<std::string, std::string>::iterator it =
+        record->rendered_.find(*type);
+
+    if (it != record->rendered_.end()) {
+        NanReturnValue(NanNew(it->second.data(), it->second.size()));
+    }
+
     const char *value = ZOOM_record_get(record->zrecord_, *type, NULL);
 
     if (value) {
@@ -47,4 +108,136 @@ NAN_METHOD(Record::Get) {
     }
 }
 
+// Builds the same shape as JSON.parse(record.get('json')) straight from
+// the parsed MARC nodes.
+struct MarcBuilder {
+    Local<Object> root;
+    Local<Array> fields;
+    Local<Array> subfields;
+};
+
+static Local<String> TableKey(Persistent<String> &key,
+    const char *str, size_t len) {
+    if (key.IsEmpty()) {
+        NanAssignPersistent(key, NanNew(str, len));
+    }
+    return NanNew(key);
+}
+
+static Local<String> TagKey(const char *tag) {
+    if (tag[0] >= '0' && tag[0] <= '9' && tag[1] >= '0' && tag[1] <= '9'
+        && tag[2] >= '0' && tag[2] <= '9' && !tag[3]) {
+        int i = (tag[0] - '0') * 100 + (tag[1] - '0') * 10 + (tag[2] - '0');
+        return TableKey(tag_keys[i], tag, 3);
+    }
+    return NanNew(tag);
+}
+
+static Local<String> CodeKey(const char *code, size_t code_len) {
+    if (code_len == 1) {
+        return TableKey(code_keys[(unsigned char) *code], code, 1);
+    }
+    return NanNew(code, code_len);
+}
+
+static void OnLeader(void *data, const char *leader) {
+    MarcBuilder *builder = static_cast<MarcBuilder *>(data);
+    builder->root->Set(NanNew(leader_key), NanNew(leader));
+}
+
+static void OnControlField(void *data, const char *tag,
+    const char *value, size_t value_len) {
+    MarcBuilder *builder = static_cast<MarcBuilder *>(data);
+    Local<Object> field = NanNew<Object>();
+
+    field->Set(TagKey(tag), NanNew(value, value_len));
+    builder->fields->Set(builder->fields->Length(), field);
+}
+
+static void OnDataField(void *data, const char *tag, const char *indicator) {
+    MarcBuilder *builder = static_cast<MarcBuilder *>(data);
+    Local<Object> field = NanNew<Object>();
+    Local<Object> content = NanNew<Object>();
+
+    builder->subfields = NanNew<Array>();
+    content->Set(NanNew(subfields_key), builder->subfields);
+
+    for (int i = 0; indicator && indicator[i] && i < 9; i++) {
+        content->Set(NanNew(ind_keys[i]), NanNew(indicator + i, 1));
+    }
+
+    field->Set(TagKey(tag), content);
+    builder->fields->Set(builder->fields->Length(), field);
+}
+
+static void OnSubfield(void *data, const char *code, size_t code_len,
+    const char *value, size_t value_len) {
+    MarcBuilder *builder = static_cast<MarcBuilder *>(data);
+    Local<Object> subfield = NanNew<Object>();
+
+    subfield->Set(CodeKey(code, code_len), NanNew(value, value_len));
+    builder->subfields->Set(builder->subfields->Length(), subfield);
+}
+
+static const struct yaz_marc_visitor marc_visitor = {
+    OnLeader, OnControlField, OnDataField, OnSubfield
+};
+
+NAN_METHOD(Record::ToObject) {
+    NanScope();
+
+    Record* record = node::ObjectWrap::Unwrap<Record>(args.This());
+    Z_External *ext = (Z_External *)
+        ZOOM_record_get(record->zrecord_, "ext", NULL);
+
+    // Only plain ISO2709 is handled here; anything else (OPAC, XML, ...)
+    // returns undefined and is left to the rendered JSON.
+    if (!ext || ext->which != Z_External_octet
+        || !yaz_oid_is_iso2709(ext->direct_reference)) {
+        return;
+    }
+
+    const char *buf = (const char *) ext->u.octet_aligned->buf;
+    int len = ext->u.octet_aligned->len;
+    yaz_iconv_t cd = NULL;
+
+    if (args.Length() > 0 && args[0]->IsString()) {
+        NanUtf8String charset(args[0]);
+
+        if (!yaz_marc_check_marc21_coding(*charset, buf, len)) {
+            cd = yaz_iconv_open("utf-8", *charset);
+
+            if (!cd) {
+                NanThrowError("Unknown charset");
+                return;
+            }
+        }
+    }
+
+    yaz_marc_t mt = yaz_marc_create();
+    MarcBuilder builder;
+    int ret = -1;
+
+    if (cd) {
+        yaz_marc_iconv(mt, cd);
+    }
+
+    if (yaz_marc_read_iso2709(mt, buf, len) > 0) {
+        builder.root = NanNew<Object>();
+        builder.fields = NanNew<Array>();
+        ret = yaz_marc_visit(mt, &marc_visitor, &builder);
+        builder.root->Set(NanNew(fields_key), builder.fields);
+    }
+
+    yaz_marc_destroy(mt);
+
+    if (cd) {
+        yaz_iconv_close(cd);
+    }
+
+    if (ret == 0) {
+        NanReturnValue(builder.root);
+    }
+}
+
 } // namespace node_zoom
@@ -1,5 +1,8 @@
 #pragma once
 #include <nan.h>
+#include <map>
+#include <string>
+#include <vector>
 
 extern "C" {
     #include <yaz/zoom.h>
@@ -12,13 +15,20 @@ class Record : public node::ObjectWrap {
         explicit Record(ZOOM_record record);
         ~Record();
 
+        void Render(const std::vector<std::string> &types);
+        ZOOM_record zoom_record() { return zrecord_; };
+
         static void Init();
+        static v8::Local<v8::Object> NewInstance(ZOOM_record record);
+        static v8::Local<v8::Object> NewInstance(Record *record);
         static NAN_METHOD(New);
         static NAN_METHOD(Get);
+        static NAN_METHOD(ToObject);
         static v8::Persistent<v8::Function> constructor;
 
     protected:
         ZOOM_record zrecord_;
+        std::map<std::string, std::string> rendered_;
 };
 
 } // namespace node_zoom
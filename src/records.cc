@@ -23,8 +23,22 @@ void Records::Init() {
     NanAssignPersistent(constructor, tpl->GetFunction());
 }
 
+// Records not handed out by Next() are released here
 Records::~Records() {
-    delete[] zrecords_;
+    for (size_t i = index_; i < counts_; i++) {
+        delete records_[i];
+    }
+    delete[] records_;
+}
+
+Local<Object> Records::NewInstance(Record **records, size_t counts) {
+    NanEscapableScope();
+
+    Records* obj = new Records(records, counts);
+    Local<Object> wrapper = NanNew(constructor)->NewInstance();
+    obj->Wrap(wrapper);
+
+    return NanEscapeScope(wrapper);
 }
 
 NAN_METHOD(Records::New) {}
@@ -36,15 +50,15 @@ NAN_METHOD(Records::Next) {
     if (resset->index_ >= resset->counts_) {
         NanThrowRangeError("Out of range");
     } else {
-        ZOOM_record zrecord = resset->zrecords_[resset->index_++];
+        Record *record = resset->records_[resset->index_];
+
+        // The Record now belongs to its wrapper
+        resset->records_[resset->index_++] = NULL;
 
-        if (zrecord == NULL) {
+        if (record == NULL) {
             NanReturnNull();
         } else {
-            Record* record = new Record(ZOOM_record_clone(zrecord));
-            Local<Object> wrapper = NanNew(Record::constructor)->NewInstance();
-            NanSetInternalFieldPointer(wrapper, 0, record);
-            NanReturnValue(wrapper);
+            NanReturnValue(Record::NewInstance(record));
         }
     }
 }
@@ -7,20 +7,24 @@ extern "C" {
 
 namespace node_zoom {
 
+class Record;
+
 class Records : public node::ObjectWrap {
     public:
-        explicit Records(ZOOM_record *records, size_t counts) :
-            zrecords_(records), counts_(counts), index_(0) {};
+        explicit Records(Record **records, size_t counts) :
+            records_(records), counts_(counts), index_(0) {};
         ~Records();
 
         static void Init();
+        static v8::Local<v8::Object> NewInstance(
+            Record **records, size_t counts);
         static NAN_METHOD(New);
         static NAN_METHOD(Next);
         static NAN_METHOD(HasNext);
         static v8::Persistent<v8::Function> constructor;
 
     protected:
-        ZOOM_record *zrecords_;
+        Record **records_;
         size_t index_;
         size_t counts_;
 };
@@ -21,14 +21,86 @@ void ResultSet::Init() {
     NODE_SET_PROTOTYPE_METHOD(tpl, "getOption", GetOption);
     NODE_SET_PROTOTYPE_METHOD(tpl, "size", Size);
     NODE_SET_PROTOTYPE_METHOD(tpl, "getRecords", GetRecords);
+    NODE_SET_PROTOTYPE_METHOD(tpl, "getColumns", GetColumns);
 
     NanAssignPersistent(constructor, tpl->GetFunction());
 }
 
-ResultSet::ResultSet(ZOOM_resultset resultset) : zset_(resultset) {}
+void SharedOptions::Apply(ZOOM_resultset zset, const OptionMap &options) {
+    if (options == applied_) {
+        return;
+    }
+
+    OptionMap::const_iterator it;
+
+    // Back to the values from before any caller set them
+    for (it = applied_.begin(); it != applied_.end(); ++it) {
+        if (!options.count(it->first)) {
+            std::pair<bool, std::string> &base = base_[it->first];
+
+            ZOOM_resultset_option_set(zset, it->first.c_str(),
+                base.first ? base.second.c_str() : NULL);
+        }
+    }
+
+    for (it = options.begin(); it != options.end(); ++it) {
+        const char *value = ZOOM_resultset_option_get(zset, it->first.c_str());
+
+        if (!base_.count(it->first)) {
+            base_[it->first] = std::make_pair(value != NULL,
+                std::string(value ? value : ""));
+        }
+        if (!value || it->second != value) {
+            ZOOM_resultset_option_set(zset, it->first.c_str(),
+                it->second.c_str());
+        }
+    }
+
+    applied_ = options;
+}
+
+void SharedOptions::Attach() {
+    refs_++;
+}
+
+void SharedOptions::Detach() {
+    if (!--refs_) {
+        delete this;
+    }
+}
+
+// A pinned result set is shared with the search that led, and keeps that
+// search's session open until it is collected
+ResultSet::ResultSet(ZOOM_resultset resultset, Driver *driver,
+    SharedOptions *shared, bool pinned) :
+    zset_(resultset), driver_(driver), shared_(shared), pinned_(pinned) {
+    if (driver_) {
+        if (pinned_) {
+            driver_->Pin();
+        } else {
+            driver_->Attach();
+        }
+    }
+
+    if (shared_) {
+        shared_->Attach();
+    }
+}
 
 ResultSet::~ResultSet() {
     ZOOM_resultset_destroy(zset_);
+
+    if (driver_) {
+        if (pinned_) {
+            driver_->Unpin();
+        } else {
+            driver_->Detach();
+        }
+    }
+
+    if (shared_) {
+        shared_->Detach();
+    }
 }
 
 NAN_METHOD(ResultSet::New) {}
@@ -42,7 +114,19 @@ NAN_METHOD(ResultSet::GetOption) {
     }
 
     NanUtf8String key(args[0]);
-    const char *value = ZOOM_resultset_option_get(resset->zset_, *key);
+    const char *value = NULL;
+
+    if (resset->shared_) {
+        OptionMap::const_iterator it = resset->options_.find(*key);
+
+        if (it != resset->options_.end()) {
+            value = it->second.c_str();
+        }
+    }
+
+    if (!value) {
+        value = ZOOM_resultset_option_get(resset->zset_, *key);
+    }
 
     if (value) {
         NanReturnValue(NanNew(value));
@@ -59,7 +143,13 @@ NAN_METHOD(ResultSet::SetOption) {
 
     NanUtf8String key(args[0]);
     NanUtf8String value(args[1]);
-    ZOOM_resultset_option_set(resset->zset_, *key, *value);
+
+    // Others reading a shared result set must not see our options
+    if (resset->shared_) {
+        resset->options_[*key] = *value;
+    } else {
+        ZOOM_resultset_option_set(resset->zset_, *key, *value);
+    }
 
     NanReturnValue(args.This());
 }
@@ -72,15 +162,76 @@ NAN_METHOD(ResultSet::GetRecords) {
         return;
     }
 
+    ResultSet* resset = node::ObjectWrap::Unwrap<ResultSet>(args.This());
+    size_t index = args[0]->Uint32Value();
+    size_t counts = args[1]->Uint32Value();
+    std::vector<std::string> render;
+
+    NanCallback *progress = NULL;
+
+    // Optional list of ZOOM_record_get() types rendered on the threadpool
+    // and optional function called with each record as it arrives
+    for (int i = 2; i < args.Length() - 1; i++) {
+        if (args[i]->IsArray()) {
+            Local<Array> types = args[i].As<Array>();
+
+            for (uint32_t j = 0; j < types->Length(); j++) {
+                NanUtf8String type(types->Get(j));
+                render.push_back(*type);
+            }
+        } else if (args[i]->IsFunction() && !progress) {
+            progress = new NanCallback(args[i].As<Function>());
+        } else {
+            delete progress;
+            NanThrowError(ArgTypeError(i == 2 ? "third" : "fourth",
+                "array or function"));
+            return;
+        }
+    }
+
+    NanCallback *callback = new NanCallback(
+        args[args.Length() - 1].As<Function>());
+    GetRecordsWorker *worker = new GetRecordsWorker(
+        callback, resset->zset_, index, counts, render, progress,
+        NULL, resset->shared_, resset->options_);
+
+    if (resset->driver_) {
+        resset->driver_->Queue(worker);
+    } else {
+        NanAsyncQueueWorker(worker);
+    }
+}
+
+// Like getRecords, but the page is indexed on the threadpool and passed
+// to the callback as MarcColumns
+NAN_METHOD(ResultSet::GetColumns) {
+    NanScope();
+
+    if (args.Length() < 3) {
+        NanThrowError(ArgsSizeError("Columns", 3, args.Length()));
+        return;
+    }
+
+    if (!args[2]->IsFunction()) {
+        NanThrowError(ArgTypeError("third", "function"));
+        return;
+    }
+
     ResultSet* resset = node::ObjectWrap::Unwrap<ResultSet>(args.This());
     size_t index = args[0]->Uint32Value();
     size_t counts = args[1]->Uint32Value();
 
     NanCallback *callback = new NanCallback(args[2].As<Function>());
     GetRecordsWorker *worker = new GetRecordsWorker(
-        callback, resset->zset_, index, counts);
+        callback, resset->zset_, index, counts,
+        std::vector<std::string>(), NULL, new MarcColumns(),
+        resset->shared_, resset->options_);
 
-    NanAsyncQueueWorker(worker);
+    if (resset->driver_) {
+        resset->driver_->Queue(worker);
+    } else {
+        NanAsyncQueueWorker(worker);
+    }
 }
 
 NAN_METHOD(ResultSet::Size) {
@@ -89,23 +240,125 @@ NAN_METHOD(ResultSet::Size) {
     NanReturnValue(NanNew<Number>(ZOOM_resultset_size(resset->zset_)));
 }
 
-void GetRecordsWorker::Execute() {
-    zrecords_ = new ZOOM_record[counts_];
-    ZOOM_resultset_records(zresultset_, zrecords_, index_, counts_);
+GetRecordsWorker::GetRecordsWorker(NanCallback *callback,
+    ZOOM_resultset resultset, size_t index, size_t counts,
+    const std::vector<std::string> &render, NanCallback *progress,
+    MarcColumns *columns, SharedOptions *shared, const OptionMap &options) :
+    ZoomWorker(callback), zresultset_(resultset), records_(NULL),
+    index_(index), counts_(counts), render_(render),
+    progress_(progress), columns_(columns), shared_(shared),
+    options_(options) {
+    if (shared_) {
+        shared_->Attach();
+    }
+}
+
+// Records are only left here when the callback failed
+GetRecordsWorker::~GetRecordsWorker() {
+    if (records_) {
+        for (size_t i = 0; i < counts_; i++) {
+            delete records_[i];
+        }
+        delete[] records_;
+    }
+
+    delete progress_;
+    delete columns_;
+
+    if (shared_) {
+        shared_->Detach();
+    }
+}
+
+// Only queue the present here; with a synchronous connection it has
+// already completed, with an async one the driver runs it before Finish().
+// Shared result sets are only ever used from their driver, one worker at
+// a time, so our options stay in place until the next one starts.
+void GetRecordsWorker::Start() {
+    if (shared_) {
+        shared_->Apply(zresultset_, options_);
+    }
+    ZOOM_resultset_records(zresultset_, NULL, index_, counts_);
+}
+
+void GetRecordsWorker::Finish() {
+    if (ZOOM_resultset_is_released(zresultset_)) {
+        SetErrorMessage("Result set released from its connection");
+        return;
+    }
+
+    records_ = new Record*[counts_];
+
+    for (size_t i = 0; i < counts_; i++) {
+        ZOOM_record zrecord = ZOOM_resultset_record_ref(
+            zresultset_, index_ + i);
+        records_[i] = zrecord ? new Record(zrecord) : NULL;
+    }
+}
+
+void GetRecordsWorker::Process() {
+    if (columns_) {
+        for (size_t i = 0; i < counts_; i++) {
+            columns_->Add(records_[i] ? records_[i]->zoom_record() : NULL);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < counts_; i++) {
+        if (records_[i]) {
+            records_[i]->Render(render_);
+        }
+    }
+}
+
+bool GetRecordsWorker::HasProcess() {
+    return columns_ || !render_.empty();
+}
+
+// Hands out the records of a present still being received, in order, as
+// they are decoded. The window shrinks by each one, so Finish() only
+// collects the rest. Records to be rendered wait for Process().
+void GetRecordsWorker::Progress() {
+    if (!progress_ || HasProcess()) {
+        return;
+    }
+
+    NanScope();
+
+    ZOOM_record zrecord;
+
+    while (counts_ && (zrecord = ZOOM_resultset_record_ref(
+            zresultset_, index_))) {
+        Local<Value> argv[] = {
+            Record::NewInstance(new Record(zrecord))
+        };
+
+        index_++;
+        counts_--;
+        progress_->Call(1, argv);
+    }
 }
 
 void GetRecordsWorker::HandleOKCallback() {
     NanScope();
 
-    Records* records = new Records(zrecords_, counts_);
-    Local<Object> wrapper = NanNew(Records::constructor)->NewInstance();
-    NanSetInternalFieldPointer(wrapper, 0, records);
+    if (columns_) {
+        Local<Value> argv[] = {
+            NanNull(),
+            columns_->ToObject()
+        };
+
+        callback->Call(2, argv);
+        return;
+    }
 
     Local<Value> argv[] = {
         NanNull(),
-        wrapper
+        Records::NewInstance(records_, counts_)
     };
 
+    records_ = NULL;
+
     callback->Call(2, argv);
 }
 
@@ -1,5 +1,12 @@
 #pragma once
 #include <nan.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "columns.h"
+#include "driver.h"
+#include "record.h"
+#include "worker.h"
 
 extern "C"{
     #include <yaz/zoom.h>
@@ -7,9 +14,33 @@ extern "C"{
 
 namespace node_zoom {
 
+typedef std::map<std::string, std::string> OptionMap;
+
+// A ZOOM_resultset shared by coalesced searches. Each ResultSet on it keeps
+// the options set through it; Apply() puts them on the ZOOM_resultset
+// before each of its presents, and those nobody set back as they were.
+// Values already in place are left alone, so a presentChunk of "auto"
+// keeps what it learned while the same caller goes on reading.
+class SharedOptions {
+    public:
+        SharedOptions() : refs_(1) {};
+
+        void Apply(ZOOM_resultset zset, const OptionMap &options);
+        void Attach();
+        void Detach();
+
+    protected:
+        ~SharedOptions() {};
+
+        OptionMap applied_;
+        std::map<std::string, std::pair<bool, std::string> > base_;
+        int refs_;
+};
+
 class ResultSet : public node::ObjectWrap {
     public:
-        explicit ResultSet(ZOOM_resultset resultset);
+        ResultSet(ZOOM_resultset resultset, Driver *driver,
+            SharedOptions *shared = NULL, bool pinned = false);
         ~ResultSet();
 
         static void Init();
@@ -17,28 +48,43 @@ class ResultSet : public node::ObjectWrap {
         static NAN_METHOD(GetOption);
         static NAN_METHOD(SetOption);
         static NAN_METHOD(GetRecords);
+        static NAN_METHOD(GetColumns);
         static NAN_METHOD(Size);
         static v8::Persistent<v8::Function> constructor;
 
     protected:
         ZOOM_resultset zset_;
+        Driver *driver_;
+        SharedOptions *shared_;
+        OptionMap options_;
+        bool pinned_;
 };
 
-class GetRecordsWorker : public NanAsyncWorker {
+class GetRecordsWorker : public ZoomWorker {
     public:
         GetRecordsWorker(NanCallback *callback, ZOOM_resultset resultset,
-            size_t index, size_t counts) :
-            NanAsyncWorker(callback), zresultset_(resultset),
-            index_(index), counts_(counts) {};
-        ~GetRecordsWorker() {};
-        void Execute();
+            size_t index, size_t counts,
+            const std::vector<std::string> &render, NanCallback *progress,
+            MarcColumns *columns = NULL, SharedOptions *shared = NULL,
+            const OptionMap &options = OptionMap());
+        ~GetRecordsWorker();
+        void Start();
+        void Finish();
+        void Process();
+        bool HasProcess();
+        void Progress();
         void HandleOKCallback();
 
     protected:
         ZOOM_resultset zresultset_;
-        ZOOM_record *zrecords_;
+        Record **records_;
         size_t counts_;
         size_t index_;
+        std::vector<std::string> render_;
+        NanCallback *progress_;
+        MarcColumns *columns_;
+        SharedOptions *shared_;
+        OptionMap options_;
 };
 
 } // namespace node_zoom
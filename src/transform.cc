@@ -0,0 +1,75 @@
+#include <errno.h>
+#include <string.h>
+#include <sstream>
+#include "errors.h"
+#include "transform.h"
+
+using namespace v8;
+
+namespace node_zoom {
+
+Persistent<Function> Transform::constructor;
+
+void Transform::Init(Handle<Object> exports) {
+    NanScope();
+
+    // Prepare constructor template
+    Local<FunctionTemplate> tpl = NanNew<FunctionTemplate>(New);
+    tpl->SetClassName(NanNew("Transform"));
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+    NanAssignPersistent(constructor, tpl->GetFunction());
+    exports->Set(NanNew("Transform"), tpl->GetFunction());
+}
+
+Transform::Transform(ZOOM_cql_transform ztrans) : ztrans_(ztrans) {
+}
+
+Transform::~Transform() {
+    ZOOM_cql_transform_destroy(ztrans_);
+}
+
+NAN_METHOD(Transform::New) {
+    NanScope();
+
+    if (args.IsConstructCall()) {
+        if (args.Length() < 1) {
+            NanThrowError(ArgsSizeError("Constructor", 1, args.Length()));
+            return;
+        }
+
+        if (!args[0]->IsString()) {
+            NanThrowError(ArgTypeError("first", "string"));
+            return;
+        }
+
+        NanUtf8String fname(args[0]);
+        ZOOM_cql_transform ztrans = ZOOM_cql_transform_open(*fname);
+
+        if (!ztrans) {
+            std::ostringstream ss;
+
+            ss << "can't open CQL transform file '"
+                << *fname << "': "
+                << strerror(errno);
+
+            NanThrowError(ss.str().c_str());
+            return;
+        }
+
+        Transform* obj = new Transform(ztrans);
+        obj->Wrap(args.This());
+        NanReturnValue(args.This());
+    } else {
+        const int argc = 1;
+        Local<Value> argv[argc] = { args[0] };
+        Local<Function> cons = NanNew<Function>(constructor);
+        NanReturnValue(cons->NewInstance(argc, argv));
+    }
+}
+
+ZOOM_cql_transform Transform::zoom_transform() {
+    return ztrans_;
+}
+
+} // namespace node_zoom
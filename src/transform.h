@@ -0,0 +1,26 @@
+#pragma once
+#include <nan.h>
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+// Compiled CQL transform file, shared with every other handle and
+// connection using the same file (ZOOM_cql_transform_open)
+class Transform : public node::ObjectWrap {
+    public:
+        explicit Transform(ZOOM_cql_transform ztrans);
+        ~Transform();
+
+        static void Init(v8::Handle<v8::Object> exports);
+        static NAN_METHOD(New);
+        ZOOM_cql_transform zoom_transform();
+
+    protected:
+        ZOOM_cql_transform ztrans_;
+        static v8::Persistent<v8::Function> constructor;
+};
+
+} // namespace node_zoom
@@ -0,0 +1,40 @@
+#include <sstream>
+#include "worker.h"
+
+namespace node_zoom {
+
+void ZoomWorker::Execute() {
+    if (!finished_) {
+        Start();
+        Finish();
+    }
+    Process();
+}
+
+// Called by a Driver once Finish() ran on the main thread
+void ZoomWorker::QueueProcess() {
+    finished_ = true;
+    NanAsyncQueueWorker(this);
+}
+
+void ZoomWorker::Abort(const char *errmsg) {
+    SetErrorMessage(errmsg);
+}
+
+void ZoomWorker::CheckError(ZOOM_connection zconn) {
+    int error = 0;
+    const char *errmsg, *addinfo;
+
+    if ((error = ZOOM_connection_error(zconn, &errmsg, &addinfo))) {
+        std::ostringstream ss;
+
+        ss << "error: "
+            << errmsg
+            << "(" << error << ") "
+            << addinfo;
+
+        SetErrorMessage(ss.str().c_str());
+    }
+}
+
+} // namespace node_zoom
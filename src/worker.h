@@ -0,0 +1,36 @@
+#pragma once
+#include <nan.h>
+
+extern "C" {
+    #include <yaz/zoom.h>
+}
+
+namespace node_zoom {
+
+// A ZOOM operation split in two halves: Start() issues the ZOOM call and
+// Finish() collects its outcome. On the threadpool both halves run inside
+// Execute(); on a Driver they run on the main thread around the socket IO.
+// Process() is CPU work on the outcome that never touches the connection
+// and therefore always runs on the threadpool. A Driver calls Progress()
+// whenever data arrived but the operation is not complete yet.
+class ZoomWorker : public NanAsyncWorker {
+    public:
+        explicit ZoomWorker(NanCallback *callback) :
+            NanAsyncWorker(callback), finished_(false) {};
+        virtual ~ZoomWorker() {};
+        void Execute();
+        void Abort(const char *errmsg);
+        void QueueProcess();
+        virtual void Start() = 0;
+        virtual void Finish() {};
+        virtual void Process() {};
+        virtual bool HasProcess() { return false; };
+        virtual void Progress() {};
+
+    protected:
+        void CheckError(ZOOM_connection zconn);
+
+        bool finished_;
+};
+
+} // namespace node_zoom
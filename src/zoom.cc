@@ -1,17 +1,27 @@
 #include <nan.h>
+#include "cache.h"
 #include "query.h"
 #include "record.h"
 #include "records.h"
 #include "options.h"
 #include "resultset.h"
 #include "connection.h"
+#include "federation.h"
+#include "pool.h"
+#include "transform.h"
+#include "prepared.h"
 
 using namespace v8;
 
 void InitAll(Handle<Object> exports) {
     node_zoom::Query::Init(exports);
+    node_zoom::Transform::Init(exports);
+    node_zoom::Prepared::Init(exports);
     node_zoom::Options::Init(exports);
     node_zoom::Connection::Init(exports);
+    node_zoom::Federation::Init(exports);
+    node_zoom::Pool::Init(exports);
+    node_zoom::Cache::Init(exports);
 
     node_zoom::Record::Init();
     node_zoom::Records::Init();
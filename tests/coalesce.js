@@ -0,0 +1,167 @@
+'use strict';
+
+var net = require('net');
+var expect = require('chai').expect;
+var zoom = require('..');
+
+// A target that accepts every Init, finds 3 records for every search and
+// answers every present with one SUTRS record, "fish"
+var INIT_RESPONSE = new Buffer(
+  'b513830200e0840200c085027800860278008c0101', 'hex');
+var SEARCH_RESPONSE = new Buffer('b70c970103980100990100960101', 'hex');
+var PRESENT_RESPONSE = new Buffer(
+  'b9249801019901029b0100bc193017a115a113281106072a8648ce130565a0061b04' +
+  '66697368', 'hex');
+
+// First byte of the Init, Search and Present request PDUs
+var INIT = 0xb4;
+var SEARCH = 0xb6;
+var PRESENT = 0xb8;
+
+describe('Search coalescing', function () {
+  var server;
+  var host;
+  var searches = 0;
+  var presents = [];
+  var onSearch = null;
+
+  before(function (done) {
+    server = net.createServer(function (socket) {
+      socket.on('data', function (data) {
+        switch (data[0]) {
+          case INIT:
+            socket.write(INIT_RESPONSE);
+            break;
+          case SEARCH:
+            searches++;
+            onSearch && onSearch();
+            // Answered late, so identical searches overlap
+            setTimeout(function () {
+              socket.write(SEARCH_RESPONSE);
+            }, 100);
+            break;
+          case PRESENT:
+            presents.push(data.toString('binary'));
+            socket.write(PRESENT_RESPONSE);
+            break;
+        }
+      });
+      socket.on('error', function () {});
+    });
+    server.listen(0, '127.0.0.1', function () {
+      host = '127.0.0.1:' + server.address().port + '/Default';
+      done();
+    });
+  });
+
+  after(function () {
+    server.close();
+  });
+
+  beforeEach(function () {
+    searches = 0;
+    presents = [];
+    onSearch = null;
+  });
+
+  function connection() {
+    return zoom.connection(host)
+      .set('async', 1)
+      .query('@attr 1=4 fish');
+  }
+
+  // Searches with a, and with b once a's search reached the target, so
+  // that a leads; cb gets both result sets
+  function coalesced(a, b, cb) {
+    var resultsets = {};
+
+    function got(name) {
+      return function (err, resultset) {
+        expect(err).to.not.exist;
+        resultsets[name] = resultset;
+
+        if (resultsets.a && resultsets.b) {
+          cb(resultsets.a, resultsets.b);
+        }
+      };
+    }
+
+    onSearch = function () {
+      onSearch = null;
+      b.search(got('b'));
+    };
+    a.search(got('a'));
+  }
+
+  it('should send identical searches once', function (done) {
+    var a = connection();
+    var b = connection();
+
+    coalesced(a, b, function (resultsetA, resultsetB) {
+      expect(searches).to.equal(1);
+      expect(resultsetA.size).to.equal(3);
+      expect(resultsetB.size).to.equal(3);
+      a.release();
+      b.release();
+      done();
+    });
+  });
+
+  it('should not share searches with coalesce set to 0', function (done) {
+    var a = connection().set('coalesce', 0);
+    var b = connection().set('coalesce', 0);
+
+    coalesced(a, b, function () {
+      expect(searches).to.equal(2);
+      a.release();
+      b.release();
+      done();
+    });
+  });
+
+  it('should keep the session for followers when the leader is released',
+    function (done) {
+      var a = connection();
+      var b = connection();
+
+      coalesced(a, b, function (resultsetA, resultsetB) {
+        a.release();
+
+        resultsetB.getRecords(0, 1, function (err, records) {
+          expect(err).to.not.exist;
+          expect(records.hasNext()).to.be.true;
+          expect(records.next().render).to.contain('fish');
+          b.release();
+          done();
+        });
+      });
+    });
+
+  it('should keep result set options per caller', function (done) {
+    var a = connection();
+    var b = connection();
+
+    coalesced(a, b, function (resultsetA, resultsetB) {
+      resultsetA.set('presentChunk', 'auto');
+      resultsetA.set('elementSetName', 'esn-a');
+      expect(resultsetA.get('presentChunk')).to.equal('auto');
+      expect(resultsetB.get('presentChunk')).to.not.exist;
+      expect(resultsetB.get('elementSetName')).to.not.exist;
+
+      resultsetA.getRecords(0, 1, function (err) {
+        expect(err).to.not.exist;
+
+        resultsetB.getRecords(0, 1, function (err) {
+          expect(err).to.not.exist;
+          expect(presents).to.have.length(2);
+          expect(presents[0]).to.contain('esn-a');
+          expect(presents[1]).to.not.contain('esn-a');
+          a.release();
+          b.release();
+          done();
+        });
+      });
+    });
+  });
+
+});
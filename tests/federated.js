@@ -0,0 +1,39 @@
+'use strict';
+
+var expect = require('chai').expect;
+var zoom = require('..');
+
+describe('Federated', function () {
+
+  describe('with no targets', function () {
+    it('should still emit end', function (done) {
+      var searched = false;
+
+      zoom.federated([], '@attr 1=4 fish')
+        .on('search', function () {
+          searched = true;
+        })
+        .on('end', function (targets) {
+          expect(searched).to.equal(false);
+          expect(targets).to.deep.equal([]);
+          done();
+        });
+    });
+
+    it('should emit end after start() returns', function (done) {
+      var federation = new zoom.binding.Federation(
+        zoom.binding.Query().prefix('@attr 1=4 fish'), emit);
+      var started = false;
+
+      function emit(type) {
+        expect(type).to.equal('done');
+        expect(started).to.equal(true);
+        done();
+      }
+
+      federation.start();
+      started = true;
+    });
+  });
+
+});
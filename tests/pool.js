@@ -0,0 +1,104 @@
+'use strict';
+
+var net = require('net');
+var expect = require('chai').expect;
+var zoom = require('..');
+
+// A target that accepts every Init and nothing else
+var INIT_RESPONSE = new Buffer(
+  'b513830200e0840200c085027800860278008c0101', 'hex');
+
+describe('Pool', function () {
+  var server;
+  var host;
+  var accepted = 0;
+
+  before(function (done) {
+    server = net.createServer(function (socket) {
+      accepted++;
+      socket.on('data', function () {
+        socket.write(INIT_RESPONSE);
+      });
+      socket.on('error', function () {});
+    });
+    server.listen(0, '127.0.0.1', function () {
+      host = '127.0.0.1:' + server.address().port + '/Default';
+      done();
+    });
+  });
+
+  after(function () {
+    server.close();
+  });
+
+  // Connects, releases and reports how many sessions the target saw
+  function session(pool, options, cb) {
+    var conn = pool.connection(host);
+    var before = accepted;
+
+    Object.keys(options).forEach(function (key) {
+      conn.set(key, options[key]);
+    });
+
+    conn.connect(function (err) {
+      expect(err).to.not.exist;
+      conn.release();
+      cb(accepted - before);
+    });
+  }
+
+  describe('#connection(host)', function () {
+    it('should reuse a released session', function (done) {
+      var pool = zoom.pool();
+
+      session(pool, { async: 1 }, function (opened) {
+        expect(opened).to.equal(1);
+        expect(pool.size).to.equal(1);
+
+        session(pool, { async: 1 }, function (opened) {
+          expect(opened).to.equal(0);
+          expect(pool.size).to.equal(1);
+          pool.drain();
+          done();
+        });
+      });
+    });
+
+    it('should not share a session between async and sync connections',
+      function (done) {
+        var pool = zoom.pool();
+
+        session(pool, { async: 1 }, function (opened) {
+          expect(opened).to.equal(1);
+
+          session(pool, {}, function (opened) {
+            expect(opened).to.equal(1);
+            expect(pool.size).to.equal(2);
+            pool.drain();
+            done();
+          });
+        });
+      });
+
+    it('should not share a session between pipeline settings',
+      function (done) {
+        var pool = zoom.pool();
+
+        session(pool, { async: 1, pipeline: 4 }, function (opened) {
+          expect(opened).to.equal(1);
+
+          session(pool, { async: 1 }, function (opened) {
+            expect(opened).to.equal(1);
+
+            session(pool, { async: 1, pipeline: 4 }, function (opened) {
+              expect(opened).to.equal(0);
+              expect(pool.size).to.equal(2);
+              pool.drain();
+              done();
+            });
+          });
+        });
+      });
+  });
+
+});
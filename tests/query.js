@@ -1,7 +1,14 @@
 'use strict';
 
+var path = require('path');
 var expect = require('chai').expect;
-var Query = require('..').binding.Query;
+var binding = require('..').binding;
+var Query = binding.Query;
+var Prepared = binding.Prepared;
+var Transform = binding.Transform;
+
+var PQF_PROPERTIES = path.join(__dirname,
+  '../deps/yaz/yaz-5.8.1/etc/pqf.properties');
 
 describe('Query', function () {
 
@@ -25,4 +32,120 @@ describe('Query', function () {
     });
   });
 
+  describe('#cql2rpn()', function () {
+    it('should convert with a transform file', function () {
+      var transform = new Transform(PQF_PROPERTIES);
+
+      expect(Query().cql2rpn('dc.title = fish', transform).key())
+        .to.contain('@attr 1=4 "fish"');
+    });
+
+    it('should throw on CQL the transform does not cover', function () {
+      var transform = new Transform(PQF_PROPERTIES);
+
+      expect(function () {
+        Query().cql2rpn('foo.bar = fish', transform);
+      }).to.throw(/CQL transformation error/);
+    });
+
+    it('should throw without a transform', function () {
+      expect(function () {
+        Query().cql2rpn('dc.title = fish', 'pqf.properties');
+      }).to.throw(/second/);
+    });
+  });
+
+  describe('Transform', function () {
+    it('should throw on a missing file', function () {
+      expect(function () {
+        new Transform(path.join(__dirname, 'missing.properties'));
+      }).to.throw(/can't open CQL transform file/);
+    });
+  });
+
+  describe('#key()', function () {
+    it('should tell queries apart', function () {
+      expect(Query().prefix('@attr 1=4 fish').key())
+        .to.equal(Query().prefix('@attr 1=4 fish').key());
+      expect(Query().prefix('@attr 1=4 fish').key())
+        .to.not.equal(Query().cql('fish').key());
+    });
+  });
+
+});
+
+describe('Prepared', function () {
+
+  describe('constructor(type, query)', function () {
+    it('should work', function () {
+      new Prepared('prefix', '@attr 1=4 $title');
+      Prepared('cql', 'dc.title = $title');
+    });
+
+    it('should throw on a bad query', function () {
+      expect(function () {
+        new Prepared('prefix', '@and $title');
+      }).to.throw(/Query Error/);
+      expect(function () {
+        new Prepared('cql', 'dc.title = ');
+      }).to.throw(/Query Error/);
+    });
+  });
+
+  describe('#bind(params)', function () {
+    it('should substitute placeholders', function () {
+      var prepared = Prepared('prefix', '@and @attr 1=4 $title @attr 1=1003 $author');
+
+      expect(prepared.bind({ title: 'fish', author: 'cod' }).key())
+        .to.equal(Query().prefix('@and @attr 1=4 "fish" @attr 1=1003 "cod"').key());
+      expect(prepared.bind({ title: 'squirrel', author: 'cod' }).key())
+        .to.equal(Query().prefix('@and @attr 1=4 "squirrel" @attr 1=1003 "cod"').key());
+    });
+
+    it('should quote values', function () {
+      expect(Prepared('cql', 'dc.title = $title').bind({ title: 'a "b" \\c' }).key())
+        .to.equal(Query().cql('dc.title = "a \\"b\\" \\\\c"').key());
+    });
+
+    it('should throw TypeError on unbound placeholders', function () {
+      var prepared = Prepared('cql', 'dc.title = $title');
+
+      expect(function () {
+        prepared.bind({ other: 'fish' });
+      }).to.throw(TypeError, /\$title is not bound/);
+      expect(function () {
+        prepared.bind({});
+      }).to.throw(TypeError, /\$title is not bound/);
+    });
+
+    it('should throw TypeError on values that are not strings', function () {
+      var prepared = Prepared('prefix', '@attr 1=4 $title');
+
+      expect(function () {
+        prepared.bind({ title: 42 });
+      }).to.throw(TypeError, /\$title must be a string/);
+      expect(function () {
+        prepared.bind({ title: null });
+      }).to.throw(TypeError, /\$title must be a string/);
+      expect(function () {
+        prepared.bind('fish');
+      }).to.throw(TypeError, /first/);
+    });
+
+    it('should ignore params without placeholders', function () {
+      expect(Prepared('prefix', '@attr 1=4 $title')
+        .bind({ title: 'fish', other: 42 }).key())
+        .to.equal(Query().prefix('@attr 1=4 "fish"').key());
+    });
+
+    it('should leave quoted strings alone', function () {
+      expect(Prepared('cql', 'dc.title = $title and note = "costs $title"')
+        .bind({ title: 'fish' }).key())
+        .to.equal(Query().cql('dc.title = "fish" and note = "costs $title"').key());
+      expect(Prepared('prefix', '@or @attr 1=4 $title @attr 1=4 "$title"')
+        .bind({ title: 'fish' }).key())
+        .to.equal(Query().prefix('@or @attr 1=4 "fish" @attr 1=4 "$title"').key());
+    });
+  });
+
 });
@@ -0,0 +1,167 @@
+'use strict';
+
+var expect = require('chai').expect;
+var ReadStream = require('../lib/read-stream');
+
+// Stands in for the native ResultSet: records are numbers, and each
+// getRecords() call is answered when the test says so
+function FakeResultSet(size) {
+  this._size = size;
+  this.calls = [];
+  this.requested = 0;
+  this.outstanding = 0;
+  this.maxOutstanding = 0;
+}
+
+FakeResultSet.prototype.size = function () {
+  return this._size;
+};
+
+FakeResultSet.prototype.getOption = function () {};
+
+FakeResultSet.prototype.setOption = function () {};
+
+FakeResultSet.prototype.getRecords = function (start, count) {
+  var done = arguments[arguments.length - 1];
+  var self = this;
+
+  this.requested = Math.max(this.requested, start + count);
+  this.outstanding += 1;
+  this.maxOutstanding = Math.max(this.maxOutstanding, this.outstanding);
+  this.calls.push({
+    start: start,
+    count: count,
+    answer: function () {
+      var i = 0;
+
+      self.outstanding -= 1;
+      done(null, {
+        hasNext: function () {
+          return i < count;
+        },
+        next: function () {
+          return { get: function () {}, n: start + i++ };
+        }
+      });
+    }
+  });
+};
+
+function fakeConnection(resultset, options) {
+  options || (options = {});
+
+  return {
+    _connected: true,
+    _query: null,
+    _conn: {
+      search: function (query, cb) {
+        setImmediate(cb, null, resultset);
+      }
+    },
+    get: function (key) {
+      return options[key];
+    }
+  };
+}
+
+// Reads the whole stream, answering calls with `answer` as they queue up
+function readAll(resultset, conn, options, answer, cb) {
+  var stream = new ReadStream(conn, options);
+  var got = [];
+  var timer = setInterval(function () {
+    answer(resultset.calls);
+  }, 1);
+
+  stream.on('data', function (record) {
+    got.push(record._record.n);
+  });
+  stream.on('end', function () {
+    clearInterval(timer);
+    cb(got);
+  });
+}
+
+function inOrder(calls) {
+  calls.length && calls.shift().answer();
+}
+
+function range(n) {
+  var list = [];
+
+  for (var i = 0; i < n; i++) {
+    list.push(i);
+  }
+  return list;
+}
+
+describe('ReadStream', function () {
+
+  describe('without prefetch', function () {
+    it('should have one getRecords() outstanding', function (done) {
+      var resultset = new FakeResultSet(100);
+
+      readAll(resultset, fakeConnection(resultset, { async: '1' }),
+        { chunk: 10, limit: 100 }, inOrder, function (got) {
+          expect(got).to.deep.equal(range(100));
+          expect(resultset.maxOutstanding).to.equal(1);
+          done();
+        });
+    });
+  });
+
+  describe('with prefetch: n', function () {
+    it('should keep n getRecords() outstanding', function (done) {
+      var resultset = new FakeResultSet(100);
+      var answer = function (calls) {
+        // Hold answers back until the window is full
+        if (calls.length >= 3 || resultset.outstanding < 3) {
+          inOrder(calls);
+        }
+      };
+
+      readAll(resultset, fakeConnection(resultset, { async: '1' }),
+        { chunk: 10, limit: 100, prefetch: 3 }, answer, function (got) {
+          expect(got).to.deep.equal(range(100));
+          expect(resultset.maxOutstanding).to.equal(3);
+          done();
+        });
+    });
+
+    it('should keep records in order when pages return out of order',
+      function (done) {
+        var resultset = new FakeResultSet(95);
+
+        readAll(resultset, fakeConnection(resultset, { async: '1' }),
+          { chunk: 10, limit: 95, prefetch: 4 }, function (calls) {
+            calls.length && calls.pop().answer();
+          }, function (got) {
+            expect(got).to.deep.equal(range(95));
+            done();
+          });
+      });
+
+    it('should request pages one at a time on threadpool connections',
+      function (done) {
+        var resultset = new FakeResultSet(100);
+
+        readAll(resultset, fakeConnection(resultset),
+          { chunk: 10, limit: 100, prefetch: 3 }, inOrder, function (got) {
+            expect(got).to.deep.equal(range(100));
+            expect(resultset.maxOutstanding).to.equal(1);
+            done();
+          });
+      });
+
+    it('should not request past the limit', function (done) {
+      var resultset = new FakeResultSet(1000);
+
+      readAll(resultset, fakeConnection(resultset, { async: '1' }),
+        { chunk: 10, limit: 35, prefetch: 3 }, inOrder, function (got) {
+          expect(got).to.deep.equal(range(35));
+          expect(resultset.requested).to.equal(35);
+          done();
+        });
+    });
+  });
+
+});
@@ -0,0 +1,104 @@
+'use strict';
+
+var expect = require('chai').expect;
+var ResultSet = require('../lib/resultset');
+var Connection = require('../lib/connection');
+
+// Stands in for the native ResultSet, which only a search can create
+function NativeResultSet(options, size) {
+  this._options = options || {};
+  this._size = size | 0;
+  this.sizeCalls = 0;
+}
+
+NativeResultSet.prototype.size = function () {
+  this.sizeCalls++;
+  return this._size;
+};
+
+NativeResultSet.prototype.getOption = function (key) {
+  return this._options[key];
+};
+
+NativeResultSet.prototype.setOption = function (key, val) {
+  this._options[key] = String(val);
+};
+
+describe('ResultSet', function () {
+
+  describe('#set(key, val)', function () {
+    it('should set a result set option', function () {
+      var resultset = new ResultSet(new NativeResultSet());
+      expect(resultset.set('presentChunkSize', 20)).to.equal(resultset);
+      expect(resultset.get('presentChunkSize')).to.equal('20');
+    });
+  });
+
+  describe('.size', function () {
+    it('should ask the native result set only once', function () {
+      var native = new NativeResultSet(null, 42);
+      var resultset = new ResultSet(native);
+
+      expect(resultset.size).to.equal(42);
+      expect(resultset.size).to.equal(42);
+      expect(resultset.size).to.equal(42);
+      expect(native.sizeCalls).to.equal(1);
+    });
+
+    it('should not ask before it is read', function () {
+      var native = new NativeResultSet(null, 42);
+
+      new ResultSet(native);
+      expect(native.sizeCalls).to.equal(0);
+    });
+
+    it('should be counted again for a new search', function (done) {
+      var natives = [
+        new NativeResultSet({ cached: '0' }, 10),
+        new NativeResultSet({ cached: '1' }, 10),
+        new NativeResultSet({ cached: '0' }, 12)
+      ];
+      var conn = Object.create(Connection.prototype);
+
+      conn._connected = true;
+      conn._query = {};
+      conn._conn = {
+        search: function (query, cb) {
+          setImmediate(cb, null, natives.shift());
+        }
+      };
+
+      conn.search(function (err, first) {
+        expect(first.size).to.equal(10);
+        expect(first.cached).to.equal(false);
+
+        conn.search(function (err, second) {
+          expect(second.size).to.equal(10);
+          expect(second.cached).to.equal(true);
+
+          conn.search(function (err, third) {
+            expect(third.size).to.equal(12);
+            expect(third.cached).to.equal(false);
+            expect(first.size).to.equal(10);
+            expect(first._resultset.sizeCalls).to.equal(1);
+            done();
+          });
+        });
+      });
+    });
+  });
+
+  describe('.cached', function () {
+    it('should be true when the search was answered from the cache', function () {
+      expect(new ResultSet(new NativeResultSet({ cached: '1' })).cached)
+        .to.equal(true);
+    });
+
+    it('should be false otherwise', function () {
+      expect(new ResultSet(new NativeResultSet()).cached).to.equal(false);
+      expect(new ResultSet(new NativeResultSet({ cached: '0' })).cached)
+        .to.equal(false);
+    });
+  });
+
+});